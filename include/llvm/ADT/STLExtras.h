@@ -107,11 +107,20 @@ public:
   function_ref() = default;
   function_ref(std::nullptr_t) {}
 
+  // The constructor only participates in overload resolution for callables
+  // that can actually be invoked with Params and return something convertible
+  // to Ret, so that overloads taking both a function_ref and a plain value
+  // (e.g. a StringRef) are not ambiguous.
   template <typename Callable>
-  function_ref(Callable &&callable,
-               typename std::enable_if<
-                   !std::is_same<typename std::remove_reference<Callable>::type,
-                                 function_ref>::value>::type * = nullptr)
+  function_ref(
+      Callable &&callable,
+      typename std::enable_if<
+          !std::is_same<typename std::remove_reference<Callable>::type,
+                        function_ref>::value &&
+          (std::is_void<Ret>::value ||
+           std::is_convertible<decltype(std::declval<Callable &>()(
+                                   std::declval<Params>()...)),
+                               Ret>::value)>::type * = nullptr)
       : callback(callback_fn<typename std::remove_reference<Callable>::type>),
         callable(reinterpret_cast<intptr_t>(&callable)) {}
 
@@ -170,6 +170,8 @@ class Module;
   Expected<BitcodeLTOInfo> getBitcodeLTOInfo(MemoryBufferRef Buffer);
 
   /// Parse the specified bitcode buffer, returning the module summary index.
+  /// The buffer may also hold a summary index image (see
+  /// ModuleSummaryIndexImage.h), which is materialized into an index.
   Expected<std::unique_ptr<ModuleSummaryIndex>>
   getModuleSummaryIndex(MemoryBufferRef Buffer);
 
@@ -14,10 +14,12 @@
 #ifndef LLVM_BITCODE_BITCODEWRITER_H
 #define LLVM_BITCODE_BITCODEWRITER_H
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/MC/StringTableBuilder.h"
 #include "llvm/Support/Allocator.h"
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -26,9 +28,78 @@
 namespace llvm {
 
 class BitstreamWriter;
+class Function;
 class Module;
 class raw_ostream;
 
+  /// Function blocks kept from one write of a module to the next, so that
+  /// functions that have not changed are copied into the new bitcode rather
+  /// than encoded again.
+  ///
+  /// A function block can only be copied if the module-level tables that
+  /// precede it (types, attributes, globals, constants and metadata) encode
+  /// exactly as before, since the block refers to their entries by number.
+  /// The writer checks this itself by hashing those tables; when they differ,
+  /// every function is encoded again. In particular, a change that adds or
+  /// removes module-level metadata, such as debug locations, invalidates all
+  /// kept blocks.
+  ///
+  /// Whether a function changed is decided by comparing keys. By default the
+  /// key is a hash of the function's textual IR, which costs about as much as
+  /// encoding it; clients that track changes themselves (for example, an
+  /// editor that knows which function was edited) can supply a cheaper key.
+  class BitcodeIncrementalState {
+  public:
+    /// Returns a key for the body of \p F. Two functions with the same name
+    /// and key must have the same body, attachments and value names.
+    using FunctionKeyFn = std::function<std::string(const Function &F)>;
+
+    /// Create an empty state. If \p KeyFn is empty, functions are keyed by a
+    /// hash of their textual IR.
+    explicit BitcodeIncrementalState(FunctionKeyFn KeyFn = nullptr)
+        : KeyFn(std::move(KeyFn)) {}
+
+    /// Drop every kept function block.
+    void clear();
+
+    /// The number of function blocks copied and encoded by the last write.
+    unsigned getNumFunctionsReused() const { return NumReused; }
+    unsigned getNumFunctionsEncoded() const { return NumEncoded; }
+
+    // The rest of the interface is used by the bitcode writer.
+
+    /// Start a write whose module-level tables hash to \p ContextHash. Kept
+    /// blocks are dropped if it differs from the last write's. An empty hash
+    /// disables reuse for this write.
+    void beginModule(StringRef ContextHash);
+
+    /// Drop the blocks of functions that were not written since beginModule.
+    void endModule();
+
+    const FunctionKeyFn &getKeyFn() const { return KeyFn; }
+
+    /// Returns the kept block contents for function \p Name if its key was
+    /// \p Key, or an empty string.
+    StringRef lookup(StringRef Name, StringRef Key);
+
+    /// Keep \p Contents as the block contents of function \p Name with key
+    /// \p Key.
+    void insert(StringRef Name, std::string Key, StringRef Contents);
+
+  private:
+    struct Entry {
+      std::string Key;
+      std::string Contents;
+      bool Written = false;
+    };
+
+    FunctionKeyFn KeyFn;
+    std::string ContextHash;
+    StringMap<Entry> Functions;
+    unsigned NumReused = 0;
+    unsigned NumEncoded = 0;
+  };
+
   class BitcodeWriter {
     SmallVectorImpl<char> &Buffer;
     std::unique_ptr<BitstreamWriter> Stream;
@@ -86,9 +157,15 @@ class raw_ostream;
     /// Can be used to produce the same module hash for a minimized bitcode
     /// used just for the thin link as in the regular full bitcode that will
     /// be used in the backend.
+    ///
+    /// If \p Incremental is non-null, function blocks kept from a previous
+    /// write of the module are copied where possible, and the blocks written
+    /// now are kept for the next write. It is not used when
+    /// \c ShouldPreserveUseListOrder is set.
     void writeModule(const Module &M, bool ShouldPreserveUseListOrder = false,
                      const ModuleSummaryIndex *Index = nullptr,
-                     bool GenerateHash = false, ModuleHash *ModHash = nullptr);
+                     bool GenerateHash = false, ModuleHash *ModHash = nullptr,
+                     BitcodeIncrementalState *Incremental = nullptr);
 
     /// Write the specified thin link bitcode file (i.e., the minimized bitcode
     /// file) to the buffer specified at construction time. The thin link
@@ -126,11 +203,15 @@ class raw_ostream;
   /// Can be used to produce the same module hash for a minimized bitcode
   /// used just for the thin link as in the regular full bitcode that will
   /// be used in the backend.
+  ///
+  /// If \p Incremental is non-null, unchanged function blocks are copied from
+  /// the previous write (see BitcodeIncrementalState).
   void WriteBitcodeToFile(const Module &M, raw_ostream &Out,
                           bool ShouldPreserveUseListOrder = false,
                           const ModuleSummaryIndex *Index = nullptr,
                           bool GenerateHash = false,
-                          ModuleHash *ModHash = nullptr);
+                          ModuleHash *ModHash = nullptr,
+                          BitcodeIncrementalState *Incremental = nullptr);
 
   /// Write the specified thin link bitcode file (i.e., the minimized bitcode
   /// file) to the given raw output stream, where it will be written in a new
@@ -248,6 +248,23 @@ public:
     BlockScope.pop_back();
   }
 
+  /// Emit a complete block whose contents were encoded earlier.
+  ///
+  /// \p Contents is everything that followed the block size word of a block
+  /// with the same \p BlockID and \p CodeLen, up to and including the padding
+  /// after its END_BLOCK. It must not depend on the position of the block in
+  /// the stream or on abbreviations defined outside BLOCKINFO.
+  void EmitEncodedBlock(unsigned BlockID, unsigned CodeLen,
+                        ArrayRef<char> Contents) {
+    assert((Contents.size() & 3) == 0 && "Block contents not 32-bit aligned");
+    EmitCode(bitc::ENTER_SUBBLOCK);
+    EmitVBR(BlockID, bitc::BlockIDWidth);
+    EmitVBR(CodeLen, bitc::CodeLenWidth);
+    FlushToWord();
+    WriteWord(Contents.size() / 4);
+    Out.append(Contents.begin(), Contents.end());
+  }
+
   //===--------------------------------------------------------------------===//
   // Record Emission
   //===--------------------------------------------------------------------===//
@@ -37,7 +37,9 @@
 #include "llvm/MC/MCContext.h"
 #include "llvm/MC/MCSymbol.h"
 #include "llvm/Pass.h"
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 
@@ -123,18 +125,21 @@ class MachineModuleInfo : public ImmutablePass {
   /// required under the large code model on x86. This is used to emit
   /// a definition of a symbol, __morestack_addr, containing the address. See
   /// comments in lib/Target/X86/X86FrameLowering.cpp for more details.
-  bool UsesMorestackAddr;
+  std::atomic<bool> UsesMorestackAddr;
 
   /// True if the module contains split-stack functions. This is used to
   /// emit .note.GNU-split-stack section as required by the linker for
   /// special handling split-stack function calling no-split-stack function.
-  bool HasSplitStack;
+  std::atomic<bool> HasSplitStack;
 
   /// True if the module contains no-split-stack functions. This is used to
   /// emit .note.GNU-no-split-stack section when it also contains split-stack
   /// functions.
-  bool HasNosplitStack;
+  std::atomic<bool> HasNosplitStack;
 
+  /// Guards MachineFunctions and the lookup cache. Machine function passes
+  /// may run on several functions of the module at once.
+  mutable std::mutex MachineFunctionsMutex;
   /// Maps IR Functions to their corresponding MachineFunctions.
   DenseMap<const Function*, std::unique_ptr<MachineFunction>> MachineFunctions;
   /// Next unique number available for a MachineFunction.
@@ -142,6 +147,10 @@ class MachineModuleInfo : public ImmutablePass {
   const Function *LastRequest = nullptr; ///< Used for shortcut/cache.
   MachineFunction *LastResult = nullptr; ///< Used for shortcut/cache.
 
+  /// Serializes the changes that machine function passes make to the IR and
+  /// its LLVMContext.
+  std::mutex IRMutex;
+
 public:
   static char ID; // Pass identification, replacement for typeid
 
@@ -169,6 +178,11 @@ public:
   /// Machine Function map.
   void deleteMachineFunctionFor(Function &F);
 
+  /// Return the mutex a machine function pass must hold while it changes the
+  /// IR or creates constants and types, as passes may run on several functions
+  /// at once.
+  std::mutex &getIRMutex() { return IRMutex; }
+
   /// Keep track of various per-function pieces of information for backends
   /// that would like to do so.
   template<typename Ty>
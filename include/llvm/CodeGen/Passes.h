@@ -140,6 +140,9 @@ namespace llvm {
   /// Basic register allocator.
   extern char &RABasicID;
 
+  /// Linear scan register allocator.
+  extern char &RALinearScanID;
+
   /// VirtRegRewriter pass. Rewrite virtual registers to physical registers as
   /// assigned in VirtRegMap.
   extern char &VirtRegRewriterID;
@@ -167,6 +170,13 @@ namespace llvm {
   ///
   FunctionPass *createBasicRegisterAllocator();
 
+  /// LinearScanRegisterAllocation Pass - This pass implements a global
+  /// register allocator that assigns live intervals in order of their start
+  /// point, for clients that need better code than the fast allocator at a
+  /// lower compile time than the greedy one.
+  ///
+  FunctionPass *createLinearScanRegisterAllocator();
+
   /// Greedy register allocation pass - This pass implements a global register
   /// allocator for optimized builds.
   ///
@@ -417,6 +427,11 @@ namespace llvm {
   /// This pass frees the memory occupied by the MachineFunction.
   FunctionPass *createFreeMachineFunctionPass();
 
+  /// This pass runs the passes of TargetPassConfig::addMachinePasses() over
+  /// the functions of the module on TargetOptions::MachineFunctionThreads
+  /// threads.
+  ModulePass *createParallelMachinePassesPass(bool DisableVerify);
+
   /// This pass performs outlining on machine instructions directly before
   /// printing assembly.
   ModulePass *createMachineOutlinerPass();
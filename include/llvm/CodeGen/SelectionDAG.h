@@ -22,6 +22,7 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/ilist.h"
@@ -236,6 +237,19 @@ class SelectionDAG {
   /// whenever manipulating the DAG.
   OptimizationRemarkEmitter *ORE;
 
+public:
+  /// Worklist state of the DAG combiner. A fresh DAGCombiner is built for
+  /// every combine, so the storage lives here instead and keeps the capacity
+  /// grown by earlier blocks and functions.
+  struct CombinerWorklist {
+    SmallVector<SDNode *, 64> Nodes;
+    DenseMap<SDNode *, unsigned> Positions;
+    SmallPtrSet<SDNode *, 32> Combined;
+  };
+
+private:
+  CombinerWorklist CombinerState;
+
   /// The starting token.
   SDNode EntryNode;
 
@@ -403,6 +417,7 @@ public:
   const SelectionDAGTargetInfo &getSelectionDAGInfo() const { return *TSI; }
   LLVMContext *getContext() const {return Context; }
   OptimizationRemarkEmitter &getORE() const { return *ORE; }
+  CombinerWorklist &getCombinerWorklist() { return CombinerState; }
 
   /// Pop up a GraphViz/gv window with the DAG rendered using 'dot'.
   void viewGraph(const std::string &Title);
@@ -166,6 +166,10 @@ public:
     return !hasLimitedCodeGenPipeline() || (!StopAfter && !StopBefore);
   }
 
+  /// Return true if the passes added by addMachinePasses() may run on
+  /// several functions at once, see TargetOptions::MachineFunctionThreads.
+  bool canRunMachinePassesConcurrently() const;
+
   void setDisableVerify(bool Disable) { setOpt(DisableVerify, Disable); }
 
   bool getEnableTailMerge() const { return EnableTailMerge; }
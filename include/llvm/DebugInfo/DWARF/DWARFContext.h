@@ -41,6 +41,7 @@
 #include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 
 namespace llvm {
 
@@ -94,6 +95,11 @@ class DWARFContext : public DIContext {
 
   std::unique_ptr<MCRegisterInfo> RegInfo;
 
+  /// Guards the lazily constructed members above, so that a context can be
+  /// queried from several threads at once. Recursive because constructing one
+  /// member often requires another (e.g. the aranges need the units).
+  std::recursive_mutex Mutex;
+
   /// Read compile units from the debug_info section (if necessary)
   /// and store them in CUs.
   void parseCompileUnits();
@@ -14,6 +14,7 @@
 #include "llvm/Support/DataExtractor.h"
 #include <cstdint>
 #include <map>
+#include <mutex>
 #include <vector>
 
 namespace llvm {
@@ -59,6 +60,9 @@ class DWARFDebugAbbrev {
   mutable DWARFAbbreviationDeclarationSetMap AbbrDeclSets;
   mutable DWARFAbbreviationDeclarationSetMap::const_iterator PrevAbbrOffsetPos;
   mutable Optional<DataExtractor> Data;
+  /// Guards the lazily parsed members above; units of one context share a
+  /// DWARFDebugAbbrev and may be extracted concurrently.
+  mutable std::mutex Mutex;
 
 public:
   DWARFDebugAbbrev();
@@ -26,11 +26,13 @@
 #include "llvm/DebugInfo/DWARF/DWARFUnitIndex.h"
 #include "llvm/Support/DataExtractor.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 
@@ -277,22 +279,62 @@ class DWARFUnit {
   /// A table of range lists (DWARF v5 and later).
   Optional<DWARFDebugRnglistTable> RngListTable;
 
-  mutable const DWARFAbbreviationDeclarationSet *Abbrevs;
+  mutable std::atomic<const DWARFAbbreviationDeclarationSet *> Abbrevs{
+      nullptr};
   llvm::Optional<BaseAddress> BaseAddr;
+  std::mutex BaseAddrMutex;
   /// The compile unit debug information entry items.
   std::vector<DWARFDebugInfoEntry> DieArray;
 
+  /// How much of the unit has been extracted into DieArray. DIEs are
+  /// extracted at most once while holding ExtractMutex, and DieArray is not
+  /// modified again once all of them have been extracted, so readers that
+  /// observe AllDIEsExtracted may use it without locking.
+  enum ExtractionState : uint8_t {
+    NothingExtracted,
+    UnitDIEExtracted,
+    AllDIEsExtracted
+  };
+  std::atomic<uint8_t> Extracted{NothingExtracted};
+  std::mutex ExtractMutex;
+
+  /// The unit DIE. It points into DieArray, or into RetiredDieArrays if the
+  /// unit DIE was handed out before the rest of the unit was extracted.
+  std::atomic<const DWARFDebugInfoEntry *> UnitDIEEntry{nullptr};
+
+  /// Arrays that held only the unit DIE and were replaced when the whole
+  /// unit was extracted. They are kept alive because other threads may still
+  /// hold the unit DIE.
+  std::vector<std::vector<DWARFDebugInfoEntry>> RetiredDieArrays;
+
   /// Map from range's start address to end address and corresponding DIE.
   /// IntervalMap does not support range removal, as a result, we use the
   /// std::map::upper_bound for address range lookup.
   std::map<uint64_t, std::pair<uint64_t, DWARFDie>> AddrDieMap;
+  std::mutex AddrDieMapMutex;
 
   using die_iterator_range =
       iterator_range<std::vector<DWARFDebugInfoEntry>::iterator>;
 
   std::shared_ptr<DWARFUnit> DWO;
+  /// Set once DIEs of DWO have been handed out, after which it must not be
+  /// dropped.
+  bool DWOInUse = false;
+  std::mutex DWOMutex;
+
+  /// Returns true if DieArray holds the whole unit. Until then the array
+  /// may still be replaced by another thread, so code that walks it must
+  /// check this first. The acquire pairs with the release in
+  /// extractDIEsIfNeeded().
+  bool allDIEsExtracted() const {
+    return Extracted.load(std::memory_order_acquire) == AllDIEsExtracted;
+  }
 
   uint32_t getDIEIndex(const DWARFDebugInfoEntry *Die) {
+    // The unit DIE is always first, but may live in a retired array.
+    if (Die->getDepth() == 0)
+      return 0;
+    assert(allDIEsExtracted() && "DIE below the unit DIE before extraction");
     auto First = DieArray.data();
     assert(Die >= First && Die < First + DieArray.size());
     return Die - First;
@@ -434,11 +476,17 @@ public:
 
   llvm::Optional<BaseAddress> getBaseAddress();
 
+  /// Returns the unit DIE, extracting it if necessary. Unless
+  /// \p ExtractUnitDIEOnly is false, the rest of the unit is not extracted,
+  /// and the DIE's children cannot be visited.
+  ///
+  /// Like the other DIE accessors, this may be called from several threads
+  /// at once.
   DWARFDie getUnitDIE(bool ExtractUnitDIEOnly = true) {
     extractDIEsIfNeeded(ExtractUnitDIEOnly);
-    if (DieArray.empty())
-      return DWARFDie();
-    return DWARFDie(this, &DieArray[0]);
+    if (const DWARFDebugInfoEntry *Entry = UnitDIEEntry.load())
+      return DWARFDie(this, Entry);
+    return DWARFDie();
   }
 
   const char *getCompilationDir();
@@ -498,7 +546,7 @@ public:
 
   /// Return the DIE object at the given index.
   DWARFDie getDIEAtIndex(unsigned Index) {
-    assert(Index < DieArray.size());
+    assert(allDIEsExtracted() && Index < DieArray.size());
     return DWARFDie(this, &DieArray[Index]);
   }
 
@@ -543,8 +591,13 @@ private:
 
   /// extractDIEsIfNeeded - Parses a compile unit and indexes its DIEs if it
   /// hasn't already been done. Returns the number of DIEs parsed at this call.
+  /// Thread-safe.
   size_t extractDIEsIfNeeded(bool CUDieOnly);
 
+  /// Copies attribute values the unit depends on out of the unit DIE. Called
+  /// once, with ExtractMutex held, right after the unit DIE is extracted.
+  void initFromUnitDIE(DWARFDie UnitDie);
+
   /// extractDIEsToVector - Appends all parsed DIEs to a vector.
   void extractDIEsToVector(bool AppendCUDie, bool AppendNonCUDIEs,
                            std::vector<DWARFDebugInfoEntry> &DIEs) const;
@@ -553,8 +606,14 @@ private:
   void clearDIEs(bool KeepCUDie);
 
   /// parseDWO - Parses .dwo file for current compile unit. Returns true if
-  /// it was actually constructed.
+  /// it was actually constructed. Thread-safe.
   bool parseDWO();
+
+  /// Returns the unit from the .dwo file, if it has been parsed.
+  std::shared_ptr<DWARFUnit> getDWO() {
+    std::lock_guard<std::mutex> Lock(DWOMutex);
+    return DWO;
+  }
 };
 
 } // end namespace llvm
@@ -15,6 +15,7 @@
 #define LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZE_H
 
 #include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
+#include "llvm/DebugInfo/Symbolize/SymbolizeCache.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/Error.h"
@@ -42,6 +43,9 @@ public:
     bool RelativeAddresses : 1;
     std::string DefaultArch;
     std::vector<std::string> DsymHints;
+    /// If non-empty, code symbolization results for binaries with a build-id
+    /// are persisted in this directory and reused by later symbolizers.
+    std::string CacheDirectory;
 
     Options(FunctionNameKind PrintFunctions = FunctionNameKind::LinkageName,
             bool UseSymbolTable = true, bool Demangle = true,
@@ -83,6 +87,16 @@ private:
   Expected<SymbolizableModule *>
   getOrCreateModuleInfo(const std::string &ModuleName, StringRef DWPName = "");
 
+  /// Returns the persistent result cache for a module, or nullptr if caching
+  /// is disabled or the module has no build-id. Like getOrCreateModuleInfo(),
+  /// an error opening the module is only reported once.
+  Expected<SymbolizeCache *> getOrCreateCache(const std::string &ModuleName,
+                                              StringRef DWPName);
+
+  /// Splits a "path[:arch]" module name into its binary path and arch name.
+  std::pair<std::string, std::string>
+  getBinaryAndArchName(const std::string &ModuleName) const;
+
   ObjectFile *lookUpDsymFile(const std::string &Path,
                              const MachOObjectFile *ExeObj,
                              const std::string &ArchName);
@@ -102,6 +116,9 @@ private:
 
   std::map<std::string, std::unique_ptr<SymbolizableModule>> Modules;
 
+  /// Persistent result caches, keyed by module name.
+  std::map<std::string, std::unique_ptr<SymbolizeCache>> Caches;
+
   /// Contains cached results of getOrCreateObjectPair().
   std::map<std::pair<std::string, std::string>, ObjectPair>
       ObjectPairForPathArch;
@@ -0,0 +1,91 @@
+//===- SymbolizeCache.h -----------------------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Persistent on-disk cache of symbolization results.
+//
+// Each cache file holds the results computed for one binary, identified by its
+// build-id (the GNU build-id note on ELF, the LC_UUID on Mach-O), and for one
+// set of symbolizer options. The file is memory-mapped and searched in place,
+// so answering a query that is already in the cache requires neither parsing
+// the debug info nor reading the symbol table of the binary.
+//
+// Cache files are named "llvmcache-symbolizer-*" so that the cache directory
+// can be pruned with llvm::pruneCache().
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZECACHE_H
+#define LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZECACHE_H
+
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/DebugInfo/DIContext.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace llvm {
+
+namespace object {
+class ObjectFile;
+} // end namespace object
+
+namespace symbolize {
+
+class SymbolizeCache {
+public:
+  /// Returns a hex string uniquely identifying the contents of \p Obj, or an
+  /// empty string if the object file does not carry a build-id.
+  static std::string getBuildID(const object::ObjectFile &Obj);
+
+  /// Opens the cache stored in directory \p CacheDir under \p Key, which
+  /// should contain the build-id of the binary and anything else that affects
+  /// the symbolization results. A missing or malformed cache file is treated
+  /// as an empty cache.
+  SymbolizeCache(StringRef CacheDir, StringRef Key);
+
+  Optional<DILineInfo> lookupCode(uint64_t Address) const;
+  Optional<DIInliningInfo> lookupInlinedCode(uint64_t Address) const;
+
+  void insertCode(uint64_t Address, const DILineInfo &Info);
+  void insertInlinedCode(uint64_t Address, const DIInliningInfo &Info);
+
+  /// Writes the cache file back if any results were inserted since it was
+  /// opened. The file is replaced atomically, so concurrent readers see
+  /// either the old or the new contents.
+  Error flush();
+
+  /// Returns the path of the cache file.
+  StringRef getPath() const { return Path; }
+
+private:
+  enum EntryKind : uint32_t { CodeEntry = 0, InlinedCodeEntry = 1 };
+  using EntryKey = std::pair<uint64_t, uint32_t>;
+
+  Optional<DIInliningInfo> lookup(uint64_t Address, EntryKind Kind) const;
+  Optional<DIInliningInfo> lookupOnDisk(uint64_t Address,
+                                        EntryKind Kind) const;
+
+  std::string Path;
+
+  /// Contents of the cache file, or null if it did not exist or was invalid.
+  std::unique_ptr<MemoryBuffer> Buffer;
+
+  /// Results computed by this process, not yet written to the cache file.
+  std::map<EntryKey, DIInliningInfo> NewEntries;
+};
+
+} // end namespace symbolize
+} // end namespace llvm
+
+#endif // LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZECACHE_H
@@ -27,25 +27,31 @@
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/Constant.h"
+#include "llvm/IR/CallSite.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalAlias.h"
 #include "llvm/IR/GlobalValue.h"
 #include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Mangler.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Support/Casting.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <functional>
 #include <iterator>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <utility>
@@ -64,6 +70,10 @@ namespace orc {
 /// added to the layer below. When a stub is called it triggers the extraction
 /// of the function body from the original module. The extracted body is then
 /// compiled and executed.
+///
+///   Optionally, the layer can speculate on which functions will be called
+/// next and compile them on background threads before their stubs are hit
+/// (see enableSpeculation).
 template <typename BaseLayerT,
           typename CompileCallbackMgrT = JITCompileCallbackManager,
           typename IndirectStubsMgrT = IndirectStubsManager>
@@ -209,6 +219,10 @@ public:
   using SymbolResolverSetter =
       std::function<void(VModuleKey K, std::shared_ptr<SymbolResolver> R)>;
 
+  /// Decides whether a function that is called directly by a function being
+  /// compiled is worth compiling speculatively.
+  using SpeculationPredicate = std::function<bool(Function &Callee)>;
+
   /// Construct a compile-on-demand layer instance.
   CompileOnDemandLayer(ExecutionSession &ES, BaseLayerT &BaseLayer,
                        SymbolResolverGetter GetSymbolResolver,
@@ -225,13 +239,60 @@ public:
         CloneStubsIntoPartitions(CloneStubsIntoPartitions) {}
 
   ~CompileOnDemandLayer() {
+    stopSpeculation();
     // FIXME: Report error on log.
     while (!LogicalDylibs.empty())
       consumeError(removeModule(LogicalDylibs.begin()->first));
   }
 
+  /// Enable speculative compilation.
+  ///
+  ///   Whenever a partition is compiled, the functions it calls directly, and
+  /// the functions those call, up to \p Depth calls away, are compiled on
+  /// \p NumThreads background threads and their stubs are pointed at the
+  /// compiled bodies, so that the first call to them does not wait for the
+  /// compiler. Only callees accepted by \p ShouldSpeculate are speculated on.
+  ///
+  ///   Compilation within the layer is serialized, but it may now happen on a
+  /// background thread: the LLVMContext of the added modules, the layer below
+  /// and the symbol resolvers must not be used concurrently other than
+  /// through this layer.
+  void enableSpeculation(unsigned NumThreads, unsigned Depth = 1,
+                         SpeculationPredicate ShouldSpeculate =
+                             isLikelySpeculationTarget) {
+#if LLVM_ENABLE_THREADS
+    std::lock_guard<std::recursive_mutex> Lock(CODLayerMutex);
+    assert(!SpeculationPool && "Speculation already enabled");
+    SpeculationPool = llvm::make_unique<ThreadPool>(NumThreads);
+    SpeculationDepth = Depth;
+    this->ShouldSpeculate = std::move(ShouldSpeculate);
+#endif
+  }
+
+  /// The default speculation predicate: rejects callees that are marked cold
+  /// or that profile data says are never executed.
+  static bool isLikelySpeculationTarget(Function &Callee) {
+    if (Callee.hasFnAttribute(Attribute::Cold))
+      return false;
+    auto EntryCount = Callee.getEntryCount();
+    return !EntryCount.hasValue() || EntryCount.getCount() != 0;
+  }
+
+  /// Returns the number of functions that were compiled speculatively.
+  unsigned getNumSpeculativelyCompiled() const {
+    return NumSpeculativelyCompiled;
+  }
+
+  /// Wait until the pending speculative compiles, and those they queue in
+  /// turn, have finished.
+  void waitForSpeculation() {
+    if (SpeculationPool)
+      SpeculationPool->wait();
+  }
+
   /// Add a module to the compile-on-demand layer.
   Error addModule(VModuleKey K, std::unique_ptr<Module> M) {
+    std::lock_guard<std::recursive_mutex> Lock(CODLayerMutex);
 
     assert(!LogicalDylibs.count(K) && "VModuleKey K already in use");
     auto I = LogicalDylibs.insert(
@@ -244,6 +305,7 @@ public:
 
   /// Add extra modules to an existing logical module.
   Error addExtraModule(VModuleKey K, std::unique_ptr<Module> M) {
+    std::lock_guard<std::recursive_mutex> Lock(CODLayerMutex);
     return addLogicalModule(LogicalDylibs[K], std::move(M));
   }
 
@@ -252,6 +314,9 @@ public:
   ///   This will remove all modules in the layers below that were derived from
   /// the module represented by K.
   Error removeModule(VModuleKey K) {
+    // Pending speculative compiles may refer to the module; drop them.
+    stopSpeculation();
+    std::lock_guard<std::recursive_mutex> Lock(CODLayerMutex);
     auto I = LogicalDylibs.find(K);
     assert(I != LogicalDylibs.end() && "VModuleKey K not valid here");
     auto Err = I->second.removeModulesFromBaseLayer(BaseLayer);
@@ -264,6 +329,7 @@ public:
   /// @param ExportedSymbolsOnly If true, search only for exported symbols.
   /// @return A handle for the given named symbol, if it exists.
   JITSymbol findSymbol(StringRef Name, bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(CODLayerMutex);
     for (auto &KV : LogicalDylibs) {
       if (auto Sym = KV.second.StubsMgr->findStub(Name, ExportedSymbolsOnly))
         return Sym;
@@ -279,6 +345,7 @@ public:
   ///        below this one.
   JITSymbol findSymbolIn(VModuleKey K, const std::string &Name,
                          bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(CODLayerMutex);
     assert(LogicalDylibs.count(K) && "VModuleKey K is not valid here");
     return LogicalDylibs[K].findSymbol(BaseLayer, Name, ExportedSymbolsOnly);
   }
@@ -292,6 +359,7 @@ public:
   //        callbacks, uncompiled IR, and no-longer-needed/reachable function
   //        implementations).
   Error updatePointer(std::string FuncName, JITTargetAddress FnBodyAddr) {
+    std::lock_guard<std::recursive_mutex> Lock(CODLayerMutex);
     //Find out which logical dylib contains our symbol
     auto LDI = LogicalDylibs.begin();
     for (auto LDE = LogicalDylibs.end(); LDI != LDE; ++LDI) {
@@ -355,7 +423,8 @@ private:
             std::make_pair(CCInfo.getAddress(),
                            JITSymbolFlags::fromGlobalValue(F));
           CCInfo.setCompileAction([this, &LD, LMId, &F]() -> JITTargetAddress {
-              if (auto FnImplAddrOrErr = this->extractAndCompile(LD, LMId, F))
+              if (auto FnImplAddrOrErr =
+                      this->extractAndCompile(LD, LMId, F, SpeculationDepth))
                 return *FnImplAddrOrErr;
               else {
                 // FIXME: Report error, return to 'abort' or something similar.
@@ -520,18 +589,32 @@ private:
   Expected<JITTargetAddress>
   extractAndCompile(LogicalDylib &LD,
                     typename LogicalDylib::SourceModuleHandle LMId,
-                    Function &F) {
+                    Function &F, unsigned SpeculateDepth = 0) {
+    std::lock_guard<std::recursive_mutex> Lock(CODLayerMutex);
     Module &SrcM = LD.getSourceModule(LMId);
 
-    // If F is a declaration we must already have compiled it.
-    if (F.isDeclaration())
-      return 0;
-
     // Grab the name of the function being called here.
     std::string CalledFnName = mangle(F.getName(), SrcM.getDataLayout());
 
+    // If F is a declaration we must already have compiled it, possibly
+    // speculatively while its stub was being hit. Return its body.
+    if (F.isDeclaration()) {
+      for (auto BLK : LD.BaseLayerVModuleKeys)
+        if (auto Sym = BaseLayer.findSymbolIn(BLK, CalledFnName, false))
+          return Sym.getAddress();
+        else if (auto Err = Sym.takeError())
+          return std::move(Err);
+      return 0;
+    }
+
     JITTargetAddress CalledAddr = 0;
     auto Part = Partition(F);
+
+    // Pick the callees to speculate on while the bodies are still in SrcM.
+    std::vector<Function *> Callees;
+    if (SpeculationPool && SpeculateDepth > 0)
+      Callees = getSpeculationCandidates(LD, Part);
+
     if (auto PartKeyOrErr = emitPartition(LD, LMId, Part)) {
       auto &PartKey = *PartKeyOrErr;
       for (auto *SubF : Part) {
@@ -561,9 +644,68 @@ private:
     } else
       return PartKeyOrErr.takeError();
 
+    for (auto *Callee : Callees)
+      speculate(LD, LMId, *Callee, SpeculateDepth - 1);
+
     return CalledAddr;
   }
 
+  /// Returns the functions called directly from \p Part that have stubs, have
+  /// not been compiled yet and are accepted by the speculation predicate.
+  template <typename PartitionT>
+  std::vector<Function *> getSpeculationCandidates(LogicalDylib &LD,
+                                                   const PartitionT &Part) {
+    std::vector<Function *> Callees;
+    std::set<Function *> Seen;
+    for (auto *F : Part)
+      for (auto &I : instructions(*F)) {
+        CallSite CS(&I);
+        if (!CS || CS.hasFnAttr(Attribute::Cold))
+          continue;
+        Function *Callee = CS.getCalledFunction();
+        if (!Callee || Callee->isDeclaration() || Part.count(Callee) ||
+            !Seen.insert(Callee).second || !ShouldSpeculate(*Callee))
+          continue;
+        // Weak definitions that were already provided elsewhere have no stub
+        // and must not be compiled.
+        std::string Name = mangle(Callee->getName(),
+                                  F->getParent()->getDataLayout());
+        if (auto Stub = LD.StubsMgr->findStub(Name, false))
+          Callees.push_back(Callee);
+        else
+          consumeError(Stub.takeError());
+      }
+    return Callees;
+  }
+
+  void speculate(LogicalDylib &LD,
+                 typename LogicalDylib::SourceModuleHandle LMId, Function &F,
+                 unsigned SpeculateDepth) {
+    SpeculationPool->async([this, &LD, LMId, &F, SpeculateDepth]() {
+      if (SpeculationStopped)
+        return;
+      std::lock_guard<std::recursive_mutex> Lock(CODLayerMutex);
+      // The stub may have been hit while this task was queued.
+      if (F.isDeclaration())
+        return;
+      if (auto AddrOrErr = extractAndCompile(LD, LMId, F, SpeculateDepth))
+        ++NumSpeculativelyCompiled;
+      else
+        // FIXME: Report error on log. The function will be compiled again,
+        //        and the error reported, when its stub is hit.
+        consumeError(AddrOrErr.takeError());
+    });
+  }
+
+  /// Drop the pending speculative compiles and wait for the running ones.
+  void stopSpeculation() {
+    if (!SpeculationPool)
+      return;
+    SpeculationStopped = true;
+    SpeculationPool->wait();
+    SpeculationStopped = false;
+  }
+
   template <typename PartitionT>
   Expected<VModuleKey>
   emitPartition(LogicalDylib &LD,
@@ -673,6 +815,16 @@ private:
 
   std::map<VModuleKey, LogicalDylib> LogicalDylibs;
   bool CloneStubsIntoPartitions;
+
+  /// Serializes compilation, which may happen on the speculation threads, with
+  /// the other uses of the layer. Recursive because compiling resolves symbols,
+  /// which may call back into the layer.
+  std::recursive_mutex CODLayerMutex;
+  std::unique_ptr<ThreadPool> SpeculationPool;
+  unsigned SpeculationDepth = 0;
+  SpeculationPredicate ShouldSpeculate;
+  std::atomic<bool> SpeculationStopped{false};
+  std::atomic<unsigned> NumSpeculativelyCompiled{0};
 };
 
 } // end namespace orc
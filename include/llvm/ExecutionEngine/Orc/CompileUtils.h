@@ -17,6 +17,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/Error.h"
@@ -26,7 +27,10 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 #include <algorithm>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 namespace llvm {
 
@@ -114,6 +118,66 @@ private:
   ObjectCache *ObjCache = nullptr;
 };
 
+/// Compile functor that can be called from several threads at once, e.g. by
+/// an IRCompileLayer2 whose ExecutionSession dispatches materialization to a
+/// thread pool.
+///
+/// TargetMachines are not thread-safe, so every concurrent compile uses its
+/// own. They are created on demand by the given builder and reused by later
+/// compiles, so there are never more TargetMachines than compiles running at
+/// once. Copies of the functor share the same TargetMachines.
+class ConcurrentIRCompiler {
+public:
+  using TargetMachineBuilder =
+      std::function<Expected<std::unique_ptr<TargetMachine>>()>;
+
+  ConcurrentIRCompiler(TargetMachineBuilder BuildTM)
+      : S(std::make_shared<State>(std::move(BuildTM))) {}
+
+  /// Compile a Module to an ObjectFile. Modules compiled concurrently must
+  /// belong to different LLVMContexts.
+  Expected<std::unique_ptr<MemoryBuffer>> operator()(Module &M) {
+    std::unique_ptr<TargetMachine> TM;
+    {
+      std::lock_guard<std::mutex> Lock(S->Mutex);
+      if (!S->FreeTMs.empty()) {
+        TM = std::move(S->FreeTMs.back());
+        S->FreeTMs.pop_back();
+      }
+    }
+    if (!TM) {
+      auto TMOrErr = S->BuildTM();
+      if (!TMOrErr)
+        return TMOrErr.takeError();
+      TM = std::move(*TMOrErr);
+    }
+
+    auto Obj = SimpleCompiler(*TM)(M);
+
+    {
+      std::lock_guard<std::mutex> Lock(S->Mutex);
+      S->FreeTMs.push_back(std::move(TM));
+    }
+
+    if (!Obj)
+      return make_error<StringError>("Could not compile module " +
+                                         M.getModuleIdentifier(),
+                                     inconvertibleErrorCode());
+    return std::move(Obj);
+  }
+
+private:
+  struct State {
+    State(TargetMachineBuilder BuildTM) : BuildTM(std::move(BuildTM)) {}
+
+    TargetMachineBuilder BuildTM;
+    std::mutex Mutex;
+    std::vector<std::unique_ptr<TargetMachine>> FreeTMs;
+  };
+
+  std::shared_ptr<State> S;
+};
+
 } // end namespace orc
 
 } // end namespace llvm
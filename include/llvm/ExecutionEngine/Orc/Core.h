@@ -18,6 +18,7 @@
 #include "llvm/ExecutionEngine/Orc/SymbolStringPool.h"
 #include "llvm/IR/Module.h"
 
+#include <deque>
 #include <list>
 #include <map>
 #include <memory>
@@ -25,6 +26,9 @@
 #include <vector>
 
 namespace llvm {
+
+class ThreadPool;
+
 namespace orc {
 
 // Forward declare some classes.
@@ -276,6 +280,23 @@ public:
     return *this;
   }
 
+  /// Dispatch materialization to the threads of \p Pool, so that independent
+  /// units (e.g. the modules of an IRCompileLayer2) are compiled and linked
+  /// in parallel, and several threads can wait in lookup at once.
+  ///
+  /// A pool thread that blocks in lookup while materializing a unit (e.g. a
+  /// linker resolving external symbols) runs the units still queued for the
+  /// pool meanwhile, since the one it waits for may be queued behind it.
+  /// Materializers that block in lookup therefore can not starve the pool.
+  ///
+  /// The pool must outlive the session; wait on it before destroying the
+  /// session. Without LLVM_ENABLE_THREADS every unit is materialized inline.
+  ExecutionSessionBase &setDispatchMaterializationToThreadPool(ThreadPool &Pool);
+
+  /// Materialize one of the units dispatched to the thread pool that no thread
+  /// has started yet. Returns false if there was none.
+  bool runQueuedMaterialization();
+
   /// Report a error for this execution session.
   ///
   /// Unhandled errors can be sent here to log them.
@@ -313,6 +334,12 @@ private:
   }
 
   mutable std::recursive_mutex SessionMutex;
+
+  /// Units dispatched to a thread pool that no thread has started yet.
+  std::mutex QueuedMaterializationsMutex;
+  std::deque<std::pair<VSO *, std::unique_ptr<MaterializationUnit>>>
+      QueuedMaterializations;
+
   std::shared_ptr<SymbolStringPool> SSP;
   VModuleKey LastKey = 0;
   ErrorReporter ReportError = logErrorsToStdErr;
@@ -527,6 +554,16 @@ public:
   SymbolNameSet lookup(std::shared_ptr<AsynchronousSymbolQuery> Q,
                        SymbolNameSet Names);
 
+  /// Search the given VSO for the symbols in Names that are already
+  ///        resolved and finalized, without building a query.
+  ///
+  /// Every symbol found is removed from Names. Ready symbols are added to
+  /// Result; symbols that are found but still lazy or materializing are added
+  /// to Pending and must be looked up with a query. The session lock is taken
+  /// once for the whole set, and no materialization is triggered.
+  void lookupReady(SymbolMap &Result, SymbolNameSet &Names,
+                   SymbolNameSet &Pending);
+
   /// Dump current VSO state to OS.
   void dump(raw_ostream &OS);
 
@@ -610,6 +647,11 @@ private:
 /// VSOs will be searched in order and no VSO pointer may be null.
 /// All symbols must be found within the given VSOs or an error
 /// will be returned.
+///
+/// Symbols that are already finalized are answered directly, one VSO at a
+/// time, so a lookup whose symbols are all ready costs one session lock per
+/// VSO and no query. Only the remaining symbols go through an
+/// AsynchronousSymbolQuery.
 Expected<SymbolMap> lookup(const std::vector<VSO *> &VSOs, SymbolNameSet Names);
 
 /// Look up a symbol by searching a list of VSOs.
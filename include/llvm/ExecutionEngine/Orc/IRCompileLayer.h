@@ -28,6 +28,14 @@ class Module;
 
 namespace orc {
 
+/// Eager IR compiling layer for the ExecutionSession based APIs.
+///
+/// emit may be called from several threads at once, when the ExecutionSession
+/// dispatches materialization to a thread pool (see
+/// ExecutionSessionBase::setDispatchMaterializationToThreadPool). Independent
+/// modules are then compiled in parallel, provided that the compile function
+/// is thread-safe (e.g. ConcurrentIRCompiler) and that the modules belong to
+/// different LLVMContexts.
 class IRCompileLayer2 : public IRLayer {
 public:
   using CompileFunction =
@@ -23,6 +23,7 @@
 #include "llvm/ExecutionEngine/JITSymbol.h"
 #include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
 #include "llvm/ExecutionEngine/Orc/OrcRemoteTargetRPCAPI.h"
+#include "llvm/ExecutionEngine/Orc/SharedMemoryRegion.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Error.h"
@@ -76,9 +77,11 @@ public:
     uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
                                  unsigned SectionID,
                                  StringRef SectionName) override {
-      Unmapped.back().CodeAllocs.emplace_back(Size, Alignment);
+      auto &ObjAllocs = Unmapped.back();
       uint8_t *Alloc = reinterpret_cast<uint8_t *>(
-          Unmapped.back().CodeAllocs.back().getLocalAddress());
+          addAlloc(ObjAllocs.CodeAllocs, ObjAllocs.LocalCodeAddr,
+                   ObjAllocs.CodeOffset, Size, Alignment)
+              .getLocalAddress());
       LLVM_DEBUG(dbgs() << "Allocator " << Id << " allocated code for "
                         << SectionName << ": " << Alloc << " (" << Size
                         << " bytes, alignment " << Alignment << ")\n");
@@ -88,19 +91,22 @@ public:
     uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
                                  unsigned SectionID, StringRef SectionName,
                                  bool IsReadOnly) override {
+      auto &ObjAllocs = Unmapped.back();
       if (IsReadOnly) {
-        Unmapped.back().RODataAllocs.emplace_back(Size, Alignment);
         uint8_t *Alloc = reinterpret_cast<uint8_t *>(
-            Unmapped.back().RODataAllocs.back().getLocalAddress());
+            addAlloc(ObjAllocs.RODataAllocs, ObjAllocs.LocalRODataAddr,
+                     ObjAllocs.RODataOffset, Size, Alignment)
+                .getLocalAddress());
         LLVM_DEBUG(dbgs() << "Allocator " << Id << " allocated ro-data for "
                           << SectionName << ": " << Alloc << " (" << Size
                           << " bytes, alignment " << Alignment << ")\n");
         return Alloc;
       } // else...
 
-      Unmapped.back().RWDataAllocs.emplace_back(Size, Alignment);
       uint8_t *Alloc = reinterpret_cast<uint8_t *>(
-          Unmapped.back().RWDataAllocs.back().getLocalAddress());
+          addAlloc(ObjAllocs.RWDataAllocs, ObjAllocs.LocalRWDataAddr,
+                   ObjAllocs.RWDataOffset, Size, Alignment)
+              .getLocalAddress());
       LLVM_DEBUG(dbgs() << "Allocator " << Id << " allocated rw-data for "
                         << SectionName << ": " << Alloc << " (" << Size
                         << " bytes, alignment " << Alignment << ")\n");
@@ -116,8 +122,8 @@ public:
       LLVM_DEBUG(dbgs() << "Allocator " << Id << " reserved:\n");
 
       if (CodeSize != 0) {
-        Unmapped.back().RemoteCodeAddr =
-            Client.reserveMem(Id, CodeSize, CodeAlign);
+        reserveSegment(CodeSize, CodeAlign, Unmapped.back().RemoteCodeAddr,
+                       Unmapped.back().LocalCodeAddr);
 
         LLVM_DEBUG(dbgs() << "  code: "
                           << format("0x%016x", Unmapped.back().RemoteCodeAddr)
@@ -126,8 +132,9 @@ public:
       }
 
       if (RODataSize != 0) {
-        Unmapped.back().RemoteRODataAddr =
-            Client.reserveMem(Id, RODataSize, RODataAlign);
+        reserveSegment(RODataSize, RODataAlign,
+                       Unmapped.back().RemoteRODataAddr,
+                       Unmapped.back().LocalRODataAddr);
 
         LLVM_DEBUG(dbgs() << "  ro-data: "
                           << format("0x%016x", Unmapped.back().RemoteRODataAddr)
@@ -136,8 +143,9 @@ public:
       }
 
       if (RWDataSize != 0) {
-        Unmapped.back().RemoteRWDataAddr =
-            Client.reserveMem(Id, RWDataSize, RWDataAlign);
+        reserveSegment(RWDataSize, RWDataAlign,
+                       Unmapped.back().RemoteRWDataAddr,
+                       Unmapped.back().LocalRWDataAddr);
 
         LLVM_DEBUG(dbgs() << "  rw-data: "
                           << format("0x%016x", Unmapped.back().RemoteRWDataAddr)
@@ -217,6 +225,11 @@ public:
       Alloc(uint64_t Size, unsigned Align)
           : Size(Size), Align(Align), Contents(new char[Size + Align - 1]) {}
 
+      /// An allocation at \p SharedAddr, in the local view of a shared memory
+      /// segment.
+      Alloc(uint64_t Size, unsigned Align, char *SharedAddr)
+          : Size(Size), Align(Align), SharedAddr(SharedAddr) {}
+
       Alloc(const Alloc &) = delete;
       Alloc &operator=(const Alloc &) = delete;
       Alloc(Alloc &&) = default;
@@ -226,7 +239,12 @@ public:
 
       unsigned getAlign() const { return Align; }
 
+      /// Returns true if the contents are already in the remote's memory.
+      bool isShared() const { return SharedAddr; }
+
       char *getLocalAddress() const {
+        if (SharedAddr)
+          return SharedAddr;
         uintptr_t LocalAddr = reinterpret_cast<uintptr_t>(Contents.get());
         LocalAddr = alignTo(LocalAddr, Align);
         return reinterpret_cast<char *>(LocalAddr);
@@ -242,6 +260,7 @@ public:
       uint64_t Size;
       unsigned Align;
       std::unique_ptr<char[]> Contents;
+      char *SharedAddr = nullptr;
       JITTargetAddress RemoteAddr = 0;
     };
 
@@ -256,12 +275,71 @@ public:
       JITTargetAddress RemoteRODataAddr = 0;
       JITTargetAddress RemoteRWDataAddr = 0;
       std::vector<Alloc> CodeAllocs, RODataAllocs, RWDataAllocs;
+
+      // Local views of the segments that are in shared memory, and the offset
+      // of the next allocation in each of them.
+      char *LocalCodeAddr = nullptr;
+      char *LocalRODataAddr = nullptr;
+      char *LocalRWDataAddr = nullptr;
+      uint64_t CodeOffset = 0, RODataOffset = 0, RWDataOffset = 0;
     };
 
     RemoteRTDyldMemoryManager(OrcRemoteTargetClient &Client,
-                              ResourceIdMgr::ResourceId Id)
-        : Client(Client), Id(Id) {
-      LLVM_DEBUG(dbgs() << "Created remote allocator " << Id << "\n");
+                              ResourceIdMgr::ResourceId Id,
+                              bool UseSharedMemory)
+        : Client(Client), Id(Id), UseSharedMemory(UseSharedMemory) {
+      LLVM_DEBUG(dbgs() << "Created remote allocator " << Id
+                        << (UseSharedMemory ? " (shared memory)" : "")
+                        << "\n");
+    }
+
+    // Reserves a remote segment. If shared memory is in use, also maps the
+    // segment locally and returns the local view in LocalAddr.
+    void reserveSegment(uint64_t Size, uint32_t Align,
+                        JITTargetAddress &RemoteAddr, char *&LocalAddr) {
+      if (!UseSharedMemory) {
+        RemoteAddr = Client.reserveMem(Id, Size, Align);
+        return;
+      }
+
+      std::string Name;
+      uint64_t RegionSize;
+      if (auto Err = Client.reserveSharedMem(Id, Size, Align, RemoteAddr, Name,
+                                             RegionSize)) {
+        Client.ReportError(std::move(Err));
+        RemoteAddr = 0;
+        return;
+      }
+
+      auto RegionOrErr = SharedMemoryRegion::open(Name, RegionSize);
+      if (!RegionOrErr) {
+        Client.ReportError(RegionOrErr.takeError());
+        RemoteAddr = 0;
+        return;
+      }
+
+      // Both processes have the region mapped now, so its name can go.
+      if (auto Err = RegionOrErr->unlink())
+        Client.ReportError(std::move(Err));
+
+      LocalAddr = static_cast<char *>(RegionOrErr->base());
+      SharedRegions.push_back(std::move(*RegionOrErr));
+    }
+
+    // Adds an allocation to Allocs. Allocations in a shared segment are laid
+    // out the same way mapAllocsToRemoteAddrs lays out their remote addresses,
+    // so that they can be written in place. Both views of the segment are
+    // page aligned, so aligning offsets aligns addresses.
+    static Alloc &addAlloc(std::vector<Alloc> &Allocs, char *SharedSegment,
+                           uint64_t &Offset, uint64_t Size, unsigned Align) {
+      if (!SharedSegment) {
+        Allocs.emplace_back(Size, Align);
+        return Allocs.back();
+      }
+      Offset = alignTo(Offset, Align);
+      Allocs.emplace_back(Size, Align, SharedSegment + Offset);
+      Offset += Size;
+      return Allocs.back();
     }
 
     // Maps all allocations in Allocs to aligned blocks
@@ -291,6 +369,10 @@ public:
         assert(!Allocs.empty() && "No sections in allocated segment");
 
         for (auto &Alloc : Allocs) {
+          // Sections in shared memory were written in place.
+          if (Alloc.isShared())
+            continue;
+
           LLVM_DEBUG(dbgs() << "  copying section: "
                             << static_cast<void *>(Alloc.getLocalAddress())
                             << " -> "
@@ -316,8 +398,10 @@ public:
 
     OrcRemoteTargetClient &Client;
     ResourceIdMgr::ResourceId Id;
+    bool UseSharedMemory;
     std::vector<ObjectAllocs> Unmapped;
     std::vector<ObjectAllocs> Unfinalized;
+    std::vector<SharedMemoryRegion> SharedRegions;
 
     struct EHFrame {
       JITTargetAddress Addr;
@@ -519,7 +603,20 @@ public:
     if (auto Err = callB<mem::CreateRemoteAllocator>(Id))
       return std::move(Err);
     return std::unique_ptr<RemoteRTDyldMemoryManager>(
-        new RemoteRTDyldMemoryManager(*this, Id));
+        new RemoteRTDyldMemoryManager(*this, Id, UseSharedMemory));
+  }
+
+  /// Place the code and data of the memory managers created from now on in
+  /// memory shared with the remote, which must then run on the same host.
+  /// Sections are written in place by RuntimeDyld instead of being copied
+  /// through the channel when the memory is finalized.
+  Error enableSharedMemory() {
+    if (!SharedMemoryRegion::isSupported())
+      return make_error<StringError>(
+          "shared memory is not supported on this host",
+          inconvertibleErrorCode());
+    UseSharedMemory = true;
+    return Error::success();
   }
 
   /// Create an RCIndirectStubsManager that will allocate stubs on the remote
@@ -633,6 +730,16 @@ private:
     }
   }
 
+  Error reserveSharedMem(ResourceIdMgr::ResourceId Id, uint64_t Size,
+                         uint32_t Align, JITTargetAddress &Addr,
+                         std::string &RegionName, uint64_t &RegionSize) {
+    if (auto ResultOrErr = callB<mem::ReserveSharedMem>(Id, Size, Align)) {
+      std::tie(Addr, RegionName, RegionSize) = *ResultOrErr;
+      return Error::success();
+    } else
+      return ResultOrErr.takeError();
+  }
+
   bool setProtections(ResourceIdMgr::ResourceId Id,
                       JITTargetAddress RemoteSegAddr, unsigned ProtFlags) {
     if (auto Err = callB<mem::SetProtections>(Id, RemoteSegAddr, ProtFlags)) {
@@ -663,6 +770,7 @@ private:
   uint32_t RemoteTrampolineSize = 0;
   uint32_t RemoteIndirectStubSize = 0;
   ResourceIdMgr AllocatorIds, IndirectStubOwnerIds;
+  bool UseSharedMemory = false;
   Optional<RemoteCompileCallbackManager> CallbackManager;
 };
 
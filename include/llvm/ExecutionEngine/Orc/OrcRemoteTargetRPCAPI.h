@@ -253,6 +253,19 @@ namespace mem {
     static const char *getName() { return "ReserveMem"; }
   };
 
+  /// Reserve a block of memory on the remote via the given allocator, in a
+  /// shared memory region that the caller can map and write directly. The
+  /// result is (Addr, RegionName, RegionSize).
+  class ReserveSharedMem
+      : public rpc::Function<ReserveSharedMem,
+                             std::tuple<JITTargetAddress, std::string,
+                                        uint64_t>(
+                                 ResourceIdMgr::ResourceId AllocID,
+                                 uint64_t Size, uint32_t Align)> {
+  public:
+    static const char *getName() { return "ReserveSharedMem"; }
+  };
+
   /// Set the memory protection on a memory block.
   class SetProtections
       : public rpc::Function<SetProtections,
@@ -18,6 +18,7 @@
 #include "llvm/ExecutionEngine/JITSymbol.h"
 #include "llvm/ExecutionEngine/Orc/OrcError.h"
 #include "llvm/ExecutionEngine/Orc/OrcRemoteTargetRPCAPI.h"
+#include "llvm/ExecutionEngine/Orc/SharedMemoryRegion.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/Format.h"
@@ -71,6 +72,7 @@ public:
         *this, &ThisT::handleDestroyRemoteAllocator);
     addHandler<mem::ReadMem>(*this, &ThisT::handleReadMem);
     addHandler<mem::ReserveMem>(*this, &ThisT::handleReserveMem);
+    addHandler<mem::ReserveSharedMem>(*this, &ThisT::handleReserveSharedMem);
     addHandler<mem::SetProtections>(*this, &ThisT::handleSetProtections);
     addHandler<mem::WriteMem>(*this, &ThisT::handleWriteMem);
     addHandler<mem::WritePtr>(*this, &ThisT::handleWritePtr);
@@ -107,10 +109,13 @@ public:
 private:
   struct Allocator {
     Allocator() = default;
-    Allocator(Allocator &&Other) : Allocs(std::move(Other.Allocs)) {}
+    Allocator(Allocator &&Other)
+        : Allocs(std::move(Other.Allocs)),
+          SharedAllocs(std::move(Other.SharedAllocs)) {}
 
     Allocator &operator=(Allocator &&Other) {
       Allocs = std::move(Other.Allocs);
+      SharedAllocs = std::move(Other.SharedAllocs);
       return *this;
     }
 
@@ -132,16 +137,35 @@ private:
       return Error::success();
     }
 
+    Expected<SharedMemoryRegion &> allocateShared(size_t Size,
+                                                  uint32_t Align) {
+      // Regions are page aligned, which satisfies any section alignment.
+      auto RegionOrErr = SharedMemoryRegion::create(Size);
+      if (!RegionOrErr)
+        return RegionOrErr.takeError();
+      void *Addr = RegionOrErr->base();
+      assert(SharedAllocs.find(Addr) == SharedAllocs.end() &&
+             "Duplicate alloc");
+      return SharedAllocs.insert(std::make_pair(Addr, std::move(*RegionOrErr)))
+          .first->second;
+    }
+
     Error setProtections(void *block, unsigned Flags) {
       auto I = Allocs.find(block);
-      if (I == Allocs.end())
-        return errorCodeToError(orcError(OrcErrorCode::RemoteMProtectAddrUnrecognized));
+      if (I != Allocs.end())
+        return errorCodeToError(
+            sys::Memory::protectMappedMemory(I->second, Flags));
+      auto J = SharedAllocs.find(block);
+      if (J != SharedAllocs.end())
+        return errorCodeToError(sys::Memory::protectMappedMemory(
+            J->second.getMemoryBlock(), Flags));
       return errorCodeToError(
-          sys::Memory::protectMappedMemory(I->second, Flags));
+          orcError(OrcErrorCode::RemoteMProtectAddrUnrecognized));
     }
 
   private:
     std::map<void *, sys::MemoryBlock> Allocs;
+    std::map<void *, SharedMemoryRegion> SharedAllocs;
   };
 
   static Error doNothing() { return Error::success(); }
@@ -395,6 +419,29 @@ private:
     return AllocAddr;
   }
 
+  Expected<std::tuple<JITTargetAddress, std::string, uint64_t>>
+  handleReserveSharedMem(ResourceIdMgr::ResourceId Id, uint64_t Size,
+                         uint32_t Align) {
+    auto I = Allocators.find(Id);
+    if (I == Allocators.end())
+      return errorCodeToError(
+               orcError(OrcErrorCode::RemoteAllocatorDoesNotExist));
+    auto &Allocator = I->second;
+    auto RegionOrErr = Allocator.allocateShared(Size, Align);
+    if (!RegionOrErr)
+      return RegionOrErr.takeError();
+    auto &Region = *RegionOrErr;
+
+    LLVM_DEBUG(dbgs() << "  Allocator " << Id << " reserved " << Region.base()
+                      << " (" << Size << " bytes, alignment " << Align
+                      << ") in shared memory " << Region.getName() << "\n");
+
+    JITTargetAddress AllocAddr = static_cast<JITTargetAddress>(
+        reinterpret_cast<uintptr_t>(Region.base()));
+
+    return std::make_tuple(AllocAddr, Region.getName().str(), Region.size());
+  }
+
   Error handleSetProtections(ResourceIdMgr::ResourceId Id,
                              JITTargetAddress Addr, uint32_t Flags) {
     auto I = Allocators.find(Id);
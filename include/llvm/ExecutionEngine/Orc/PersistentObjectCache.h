@@ -0,0 +1,98 @@
+//===- PersistentObjectCache.h - On-disk object cache for ORC ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// An ObjectCache that keeps the relocatable objects produced by the JIT in a
+// directory, so that they survive the process.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_PERSISTENTOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_ORC_PERSISTENTOBJECTCACHE_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace llvm {
+
+class Module;
+class TargetMachine;
+
+namespace orc {
+
+/// An on-disk ObjectCache.
+///
+///   Objects are keyed by a hash of the bitcode of the module being compiled,
+/// the configuration of the TargetMachine that compiles it and the version of
+/// LLVM, so one cache directory can be shared by JITs with different targets
+/// and options. When used with SimpleCompiler (and so with IRCompileLayer2 or
+/// the legacy IRCompileLayer), the module hashed is the one handed to the
+/// compiler, i.e. after any IR transforms, and a hit skips code generation.
+///
+///   Cache files are named "llvmcache-orc-*", so the directory can be pruned
+/// with pruneCache() (see llvm/Support/CachePruning.h). Files are written
+/// atomically, so several processes can share a directory.
+///
+///   The cache may be used by several compiling threads at once.
+class PersistentObjectCache : public ObjectCache {
+public:
+  /// Create a cache in \p CacheDir, which is created if it does not exist,
+  /// for objects compiled by \p TM.
+  static Expected<std::unique_ptr<PersistentObjectCache>>
+  Create(StringRef CacheDir, const TargetMachine &TM);
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+  /// Returns the key under which the object for \p M is cached.
+  std::string getKey(const Module &M) const;
+
+  /// Prune the cache directory according to \p Policy.
+  void prune(const CachePruningPolicy &Policy) { pruneCache(CacheDir, Policy); }
+
+  StringRef getCacheDir() const { return CacheDir; }
+
+  unsigned getNumHits() const { return NumHits; }
+  unsigned getNumMisses() const { return NumMisses; }
+
+private:
+  PersistentObjectCache(std::string CacheDir, std::string TargetKey)
+      : CacheDir(std::move(CacheDir)), TargetKey(std::move(TargetKey)) {}
+
+  std::string getEntryPath(StringRef Key) const;
+
+  std::string CacheDir;
+
+  /// Hash of the TargetMachine configuration and the LLVM version, mixed into
+  /// every key.
+  std::string TargetKey;
+
+  /// Keys computed by getObject for modules that missed the cache, to be
+  /// reused by the notifyObjectCompiled call that follows. The key cannot be
+  /// recomputed there, because code generation changes the module. Each
+  /// getObject call replaces or erases the entry for its module, so an entry
+  /// left by a module that was never compiled does not outlive it.
+  std::mutex PendingKeysMutex;
+  std::map<const Module *, std::string> PendingKeys;
+
+  std::atomic<unsigned> NumHits{0};
+  std::atomic<unsigned> NumMisses{0};
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_PERSISTENTOBJECTCACHE_H
@@ -0,0 +1,77 @@
+//===- SharedMemoryRegion.h - Memory shared between processes ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// A named block of memory that the JIT and a remote executor on the same host
+// can both map, so that code can be written by one and run by the other
+// without copying it through the RPC channel.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_SHAREDMEMORYREGION_H
+#define LLVM_EXECUTIONENGINE_ORC_SHAREDMEMORYREGION_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/Memory.h"
+#include <cstdint>
+#include <string>
+
+namespace llvm {
+namespace orc {
+
+/// A mapping of a POSIX shared memory object.
+///
+///   The process that creates the region maps it readable and writable, and
+/// may later change the protection of its mapping with
+/// sys::Memory::protectMappedMemory, e.g. to make it executable. Other
+/// processes open the region by name and get their own, independent,
+/// readable and writable mapping of the same memory. The name can be unlinked
+/// as soon as every process has opened the region; the memory is released
+/// when the last mapping goes away.
+class SharedMemoryRegion {
+public:
+  /// Returns true if shared memory regions are supported on this host.
+  static bool isSupported();
+
+  /// Create a new region of at least \p Size bytes, rounded up to the page
+  /// size.
+  static Expected<SharedMemoryRegion> create(uint64_t Size);
+
+  /// Map the region created by another process under \p Name.
+  static Expected<SharedMemoryRegion> open(StringRef Name, uint64_t Size);
+
+  SharedMemoryRegion(const SharedMemoryRegion &) = delete;
+  SharedMemoryRegion &operator=(const SharedMemoryRegion &) = delete;
+  SharedMemoryRegion(SharedMemoryRegion &&Other);
+  SharedMemoryRegion &operator=(SharedMemoryRegion &&Other);
+  ~SharedMemoryRegion();
+
+  /// Remove the name of the region. Existing mappings stay valid.
+  Error unlink();
+
+  StringRef getName() const { return Name; }
+  sys::MemoryBlock getMemoryBlock() const { return MB; }
+  void *base() const { return MB.base(); }
+  uint64_t size() const { return MB.size(); }
+
+private:
+  SharedMemoryRegion(std::string Name, sys::MemoryBlock MB, bool Linked)
+      : Name(std::move(Name)), MB(MB), Linked(Linked) {}
+
+  void release();
+
+  std::string Name;
+  sys::MemoryBlock MB;
+  bool Linked;
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_SHAREDMEMORYREGION_H
@@ -33,6 +33,11 @@ public:
   /// Create a symbol string pointer from the given string.
   SymbolStringPtr intern(StringRef S);
 
+  /// Create symbol string pointers for each string in Strings and write them
+  /// to Out. The pool lock is taken once for the whole range.
+  template <typename StringRangeT, typename OutputIteratorT>
+  void intern(const StringRangeT &Strings, OutputIteratorT Out);
+
   /// Remove from the pool any entries that are no longer referenced.
   void clearDeadEntries();
 
@@ -127,6 +132,18 @@ inline SymbolStringPtr SymbolStringPool::intern(StringRef S) {
   return SymbolStringPtr(&*I);
 }
 
+template <typename StringRangeT, typename OutputIteratorT>
+void SymbolStringPool::intern(const StringRangeT &Strings,
+                              OutputIteratorT Out) {
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  for (const auto &S : Strings) {
+    PoolMap::iterator I;
+    bool Added;
+    std::tie(I, Added) = Pool.try_emplace(S, 0);
+    *Out++ = SymbolStringPtr(&*I);
+  }
+}
+
 inline void SymbolStringPool::clearDeadEntries() {
   std::lock_guard<std::mutex> Lock(PoolMutex);
   for (auto I = Pool.begin(), E = Pool.end(); I != E;) {
@@ -0,0 +1,195 @@
+//===- PooledSectionMemoryManager.h - Pooled JIT memory manager -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the declaration of a section-based memory manager that
+// draws its pages from a pool shared between memory managers, for JITs that
+// load and remove many objects over their lifetime.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_POOLEDSECTIONMEMORYMANAGER_H
+#define LLVM_EXECUTIONENGINE_POOLEDSECTIONMEMORYMANAGER_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Support/Memory.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace llvm {
+
+class raw_ostream;
+
+/// A thread-safe pool of pages for JIT memory managers.
+///
+/// Pages are requested from the operating system in slabs, and handed out in
+/// page-aligned runs. Runs that are released go back to the pool, not to the
+/// operating system, and are reused by later allocations for the same
+/// AllocationPurpose. Slabs are only unmapped by releaseFreeSlabs or when the
+/// pool is destroyed.
+class JITMemoryPool {
+public:
+  using AllocationPurpose = SectionMemoryManager::AllocationPurpose;
+
+  struct Statistics {
+    /// Number of slabs currently mapped, and their total size.
+    uint64_t NumSlabs = 0;
+    uint64_t BytesMapped = 0;
+
+    /// Bytes currently handed out, and the most ever handed out at once.
+    uint64_t BytesInUse = 0;
+    uint64_t PeakBytesInUse = 0;
+
+    /// Total bytes returned to the pool by release, and so reused rather
+    /// than mapped again.
+    uint64_t BytesReleased = 0;
+
+    /// Number of calls made to the memory mapper.
+    uint64_t NumMapCalls = 0;
+    uint64_t NumProtectCalls = 0;
+    uint64_t NumUnmapCalls = 0;
+
+    void print(raw_ostream &OS) const;
+  };
+
+  /// Create a pool that maps \p SlabSize bytes at a time (rounded up to the
+  /// page size) through \p MM. If \p MM is nullptr the operating system is
+  /// called directly.
+  JITMemoryPool(SectionMemoryManager::MemoryMapper *MM = nullptr,
+                size_t SlabSize = 1024 * 1024);
+  JITMemoryPool(const JITMemoryPool &) = delete;
+  JITMemoryPool &operator=(const JITMemoryPool &) = delete;
+  ~JITMemoryPool();
+
+  /// Returns a readable and writable, page-aligned run of at least
+  /// \p NumBytes bytes, rounded up to the page size, for \p Purpose. On
+  /// failure a null MemoryBlock is returned and \p EC describes the error.
+  sys::MemoryBlock allocate(AllocationPurpose Purpose, size_t NumBytes,
+                            std::error_code &EC);
+
+  /// Set the protection of \p Block, which must lie within a run returned by
+  /// allocate, to \p Flags.
+  std::error_code protect(const sys::MemoryBlock &Block, unsigned Flags);
+
+  /// Return \p Block, a page-aligned part of a run returned by allocate for
+  /// \p Purpose, to the pool. If \p Reprotect is true the block is made
+  /// readable and writable again first.
+  std::error_code release(AllocationPurpose Purpose,
+                          const sys::MemoryBlock &Block, bool Reprotect);
+
+  /// Unmap every slab that has no pages in use.
+  void releaseFreeSlabs();
+
+  Statistics getStatistics() const;
+
+  size_t getPageSize() const { return PageSize; }
+
+private:
+  struct Slab {
+    sys::MemoryBlock MB;
+    /// Free page runs in this slab, keyed by start address.
+    std::map<uintptr_t, size_t> FreeRuns;
+    size_t FreeBytes = 0;
+  };
+
+  sys::MemoryBlock allocateFromSlab(Slab &S, size_t NumBytes);
+  Slab *findSlab(AllocationPurpose Purpose, uintptr_t Addr);
+  void unmapSlab(Slab &S);
+
+  SectionMemoryManager::MemoryMapper *MM;
+  size_t PageSize;
+  size_t SlabSize;
+
+  mutable std::mutex PoolMutex;
+  /// Slabs for each AllocationPurpose.
+  std::vector<std::unique_ptr<Slab>> Slabs[3];
+  Statistics Stats;
+};
+
+/// A memory manager for RuntimeDyld that allocates from a JITMemoryPool.
+///
+/// Sections are packed into page runs taken from the pool, with code,
+/// read-only data and read-write data kept on separate pages, so the sections
+/// of several objects loaded into the same manager share pages. Permissions
+/// are applied by finalizeMemory with one call per page run rather than one
+/// per section. Pages that have been finalized are never made writable again
+/// while the manager is alive; later allocations start on a fresh page, and
+/// unused pages are returned to the pool at each finalization.
+///
+/// Destroying the manager (e.g. when the ORC module that owns it is removed)
+/// returns all of its pages to the pool for reuse.
+class PooledSectionMemoryManager : public RTDyldMemoryManager {
+public:
+  explicit PooledSectionMemoryManager(std::shared_ptr<JITMemoryPool> Pool);
+  PooledSectionMemoryManager(const PooledSectionMemoryManager &) = delete;
+  void operator=(const PooledSectionMemoryManager &) = delete;
+  ~PooledSectionMemoryManager() override;
+
+  /// Allocates a memory block of (at least) the given size suitable for
+  /// executable code.
+  ///
+  /// The value of \p Alignment must be a power of two.  If \p Alignment is zero
+  /// a default alignment of 16 will be used.
+  uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID,
+                               StringRef SectionName) override;
+
+  /// Allocates a memory block of (at least) the given size suitable for
+  /// data.
+  ///
+  /// The value of \p Alignment must be a power of two.  If \p Alignment is zero
+  /// a default alignment of 16 will be used.
+  uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID, StringRef SectionName,
+                               bool IsReadOnly) override;
+
+  /// Make code read-only and executable and read-only data read-only, then
+  /// invalidate the instruction cache for the new code.
+  ///
+  /// \returns true if an error occurred, false otherwise.
+  bool finalizeMemory(std::string *ErrMsg = nullptr) override;
+
+  JITMemoryPool &getPool() const { return *Pool; }
+
+private:
+  using AllocationPurpose = JITMemoryPool::AllocationPurpose;
+
+  struct MemoryGroup {
+    // Page runs taken from the pool.
+    SmallVector<sys::MemoryBlock, 4> Runs;
+    // Parts of Runs handed out since the last finalization, one per run.
+    SmallVector<sys::MemoryBlock, 4> Pending;
+    // Bump pointer into the last run, and the start of its pending part.
+    uintptr_t Cur = 0;
+    uintptr_t End = 0;
+    uintptr_t PendingBegin = 0;
+  };
+
+  uint8_t *allocateSection(AllocationPurpose Purpose, uintptr_t Size,
+                           unsigned Alignment);
+  std::error_code finalizeGroup(AllocationPurpose Purpose, unsigned Flags);
+  void releaseUnusedPages(AllocationPurpose Purpose, MemoryGroup &G);
+  MemoryGroup &getGroup(AllocationPurpose Purpose);
+
+  std::shared_ptr<JITMemoryPool> Pool;
+  MemoryGroup CodeMem;
+  MemoryGroup RODataMem;
+  MemoryGroup RWDataMem;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_POOLEDSECTIONMEMORYMANAGER_H
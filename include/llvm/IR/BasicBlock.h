@@ -84,6 +84,11 @@ public:
   BasicBlock &operator=(const BasicBlock &) = delete;
   ~BasicBlock();
 
+  /// Allocate a BasicBlock from the IRArena active on this thread, if there is
+  /// one. See IRArena.h.
+  void *operator new(size_t Size);
+  void operator delete(void *Ptr);
+
   /// Get the context in which this basic block lives.
   LLVMContext &getContext() const;
 
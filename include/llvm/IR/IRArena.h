@@ -0,0 +1,89 @@
+//===- llvm/IR/IRArena.h - Arena allocation of IR objects -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares IRArena, a bump allocator that Instructions (with their
+// co-allocated operands) and BasicBlocks can be allocated from, for clients
+// that build a module, optimize and codegen it, then throw it away.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_IRARENA_H
+#define LLVM_IR_IRARENA_H
+
+#include "llvm/Support/Allocator.h"
+#include <cstddef>
+
+namespace llvm {
+
+/// An arena for the Instructions and BasicBlocks of a module.
+///
+/// While an IRArena::Scope is alive, every Instruction and BasicBlock created
+/// on that thread is allocated from the scope's arena. Such objects are still
+/// destroyed in the usual way (eraseFromParent, or when their function or
+/// module is destroyed), which unlinks them from their uses and value handles,
+/// but their memory is only released when the arena itself is destroyed.
+/// Deleting arena objects one at a time therefore does not reclaim memory.
+///
+/// Only Instructions and BasicBlocks are affected: constants, globals and
+/// metadata belong to the LLVMContext and may outlive the module, so they are
+/// always allocated normally, as are the separately allocated operand lists
+/// of PHI nodes, switches and other instructions with hung off operands.
+///
+/// The arena must outlive every object allocated from it. It can be handed to
+/// the module that owns those objects with Module::setIRArena, in which case
+/// the objects must not be moved to another module (e.g. by IR linking).
+///
+/// An IRArena is not thread-safe; it may only be in scope on one thread at a
+/// time.
+class IRArena {
+public:
+  IRArena() = default;
+  IRArena(const IRArena &) = delete;
+  IRArena &operator=(const IRArena &) = delete;
+  ~IRArena();
+
+  /// Allocate \p Size bytes aligned to \p Alignment.
+  void *Allocate(size_t Size, size_t Alignment) {
+    ++NumAllocations;
+    return Alloc.Allocate(Size, Alignment);
+  }
+
+  /// Returns the number of objects allocated from this arena.
+  size_t getNumAllocations() const { return NumAllocations; }
+
+  /// Returns the number of bytes handed out by this arena.
+  size_t getBytesAllocated() const { return Alloc.getBytesAllocated(); }
+
+  /// Returns the number of bytes this arena has obtained from malloc.
+  size_t getTotalMemory() const { return Alloc.getTotalMemory(); }
+
+  /// Returns the arena IR is allocated from on this thread, or nullptr.
+  static IRArena *getActive();
+
+  /// Makes an arena the active one on this thread for the lifetime of the
+  /// Scope. Scopes nest; the previously active arena is restored on exit.
+  class Scope {
+  public:
+    explicit Scope(IRArena &Arena);
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+    ~Scope();
+
+  private:
+    IRArena *Prev;
+  };
+
+private:
+  BumpPtrAllocator Alloc;
+  size_t NumAllocations = 0;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_IR_IRARENA_H
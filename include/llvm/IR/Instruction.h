@@ -53,6 +53,13 @@ class Instruction : public User,
   };
 
 protected:
+  /// Allocate an Instruction as the User overloads do, taking the storage of
+  /// the instruction and its co-allocated operands from the IRArena active on
+  /// this thread, if there is one. See IRArena.h.
+  void *operator new(size_t Size);
+  void *operator new(size_t Size, unsigned Us);
+  void *operator new(size_t Size, unsigned Us, unsigned DescBytes);
+
   ~Instruction(); // Use deleteValue() to delete a generic Instruction.
 
 public:
@@ -332,7 +332,7 @@ public:
 
   // allocate space for exactly two operands
   void *operator new(size_t s) {
-    return User::operator new(s, 2);
+    return Instruction::operator new(s, 2);
   }
 
   /// Return true if this is a store to a volatile memory location.
@@ -457,7 +457,7 @@ public:
 
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
 
   /// Returns the ordering constraint of this fence instruction.
@@ -534,7 +534,7 @@ public:
 
   // allocate space for exactly three operands
   void *operator new(size_t s) {
-    return User::operator new(s, 3);
+    return Instruction::operator new(s, 3);
   }
 
   /// Return true if this is a cmpxchg from a volatile memory
@@ -724,7 +724,7 @@ public:
 
   // allocate space for exactly two operands
   void *operator new(size_t s) {
-    return User::operator new(s, 2);
+    return Instruction::operator new(s, 2);
   }
 
   BinOp getOperation() const {
@@ -2403,7 +2403,7 @@ public:
 
   // allocate space for exactly three operands
   void *operator new(size_t s) {
-    return User::operator new(s, 3);
+    return Instruction::operator new(s, 3);
   }
 
   /// Return true if a shufflevector instruction can be
@@ -2634,7 +2634,7 @@ protected:
 public:
   // allocate space for exactly two operands
   void *operator new(size_t s) {
-    return User::operator new(s, 2);
+    return Instruction::operator new(s, 2);
   }
 
   static InsertValueInst *Create(Value *Agg, Value *Val,
@@ -2982,7 +2982,7 @@ private:
 
   // Allocate space for exactly zero operands.
   void *operator new(size_t s) {
-    return User::operator new(s);
+    return Instruction::operator new(s);
   }
 
   void growOperands(unsigned Size);
@@ -3280,7 +3280,7 @@ class SwitchInst : public TerminatorInst {
 
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s);
+    return Instruction::operator new(s);
   }
 
   void init(Value *Value, BasicBlock *Default, unsigned NumReserved);
@@ -3633,7 +3633,7 @@ class IndirectBrInst : public TerminatorInst {
 
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s);
+    return Instruction::operator new(s);
   }
 
   void init(Value *Address, unsigned NumDests);
@@ -4037,7 +4037,7 @@ class CatchSwitchInst : public TerminatorInst {
                   BasicBlock *InsertAtEnd);
 
   // allocate space for exactly zero operands
-  void *operator new(size_t s) { return User::operator new(s); }
+  void *operator new(size_t s) { return Instruction::operator new(s); }
 
   void init(Value *ParentPad, BasicBlock *UnwindDest, unsigned NumReserved);
   void growOperands(unsigned Size);
@@ -4479,7 +4479,7 @@ public:
 
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
 
   unsigned getNumSuccessors() const { return 0; }
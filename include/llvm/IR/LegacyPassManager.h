@@ -74,6 +74,11 @@ public:
 
   void add(Pass *P) override;
 
+  /// addSharedImmutablePass - Let the passes of this manager use the
+  /// immutable pass P of another pass manager. P is neither initialized nor
+  /// deleted by this manager and must outlive it.
+  void addSharedImmutablePass(ImmutablePass *P);
+
   /// run - Execute all of the passes scheduled for execution.  Keep
   /// track of whether any of the passes modifies the function, and if
   /// so, return true.
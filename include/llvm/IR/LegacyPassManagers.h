@@ -205,6 +205,10 @@ public:
   /// Add immutable pass and initialize it.
   void addImmutablePass(ImmutablePass *P);
 
+  /// Make the immutable pass P, which is owned and initialized by another
+  /// pass manager, available to the passes of this one.
+  void addSharedImmutablePass(ImmutablePass *P);
+
   inline SmallVectorImpl<ImmutablePass *>& getImmutablePasses() {
     return ImmutablePasses;
   }
@@ -43,6 +43,7 @@ namespace llvm {
 class Error;
 class FunctionType;
 class GVMaterializer;
+class IRArena;
 class LLVMContext;
 class MemoryBuffer;
 class RandomNumberGenerator;
@@ -179,6 +180,8 @@ private:
                                   ///< module, for legacy clients only.
   std::unique_ptr<GVMaterializer>
   Materializer;                   ///< Used to materialize GlobalValues
+  std::unique_ptr<IRArena>
+  Arena;                          ///< Arena owned by this module, if any.
   std::string ModuleID;           ///< Human readable identifier for the module
   std::string SourceFileName;     ///< Original source file name for module,
                                   ///< recorded in bitcode.
@@ -852,6 +855,14 @@ public:
 
   /// Take ownership of the given memory buffer.
   void setOwnedMemoryBuffer(std::unique_ptr<MemoryBuffer> MB);
+
+  /// Take ownership of the arena the instructions and basic blocks of this
+  /// module were allocated from, so that it is freed along with the module.
+  /// See IRArena.h.
+  void setIRArena(std::unique_ptr<IRArena> A);
+
+  /// Returns the arena owned by this module, or nullptr.
+  IRArena *getIRArena() const { return Arena.get(); }
 };
 
 /// Given "llvm.used" or "llvm.compiler.used" as a global name, collect
@@ -0,0 +1,240 @@
+//===- llvm/IR/ModuleSummaryIndexImage.h - Summary index image --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+/// @file
+/// A compact, read-only, pointer-free on-disk form of a ModuleSummaryIndex.
+///
+/// An index image is a sequence of fixed-size little-endian records that can
+/// be memory-mapped and queried in place, without decoding bitcode or
+/// allocating the maps and edge lists of a ModuleSummaryIndex. It is meant for
+/// the combined and per-module indexes of distributed ThinLTO builds, where
+/// every backend job otherwise rebuilds the index from bitcode on startup.
+///
+/// The image holds the module path table, the summaries (flags, instruction
+/// count, reference and call edges, aliasees) keyed by GUID, and the CFI
+/// function names. Type identifier summaries and the type test information of
+/// function summaries are not represented; indexes that carry them must be
+/// written as bitcode.
+///
+/// Layout, with every section aligned to 8 bytes:
+///
+///   Header
+///   ModuleRecord[NumModules]
+///   ValueRecord[NumValues]      sorted by GUID
+///   SummaryRecord[NumSummaries] grouped by value
+///   EdgeRecord[NumEdges]        references, then calls, of each summary
+///   NameRecord[NumCfiFunctionDefs + NumCfiFunctionDecls]
+///   char[StringTableSize]       module paths and CFI function names
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_MODULESUMMARYINDEXIMAGE_H
+#define LLVM_IR_MODULESUMMARYINDEXIMAGE_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace llvm {
+
+class raw_ostream;
+
+namespace summaryimage {
+
+using support::ulittle32_t;
+using support::ulittle64_t;
+
+/// Magic number at the start of every index image.
+static const char Magic[8] = {'L', 'L', 'V', 'M', 'S', 'I', 'D', 'X'};
+
+/// Version of the image layout. Bump it when changing any of the records.
+static const uint32_t Version = 1;
+
+enum HeaderFlags : uint32_t {
+  WithGlobalValueDeadStripping = 1 << 0,
+  SkipModuleByDistributedBackend = 1 << 1,
+};
+
+struct Header {
+  char Magic[8];
+  ulittle32_t Version;
+  ulittle32_t Flags;
+  ulittle32_t NumModules;
+  ulittle32_t NumValues;
+  ulittle32_t NumSummaries;
+  ulittle32_t NumEdges;
+  ulittle32_t NumCfiFunctionDefs;
+  ulittle32_t NumCfiFunctionDecls;
+  ulittle32_t StringTableSize;
+  ulittle32_t Reserved;
+};
+
+struct ModuleRecord {
+  ulittle64_t ModuleId;
+  ulittle32_t PathOffset;
+  ulittle32_t PathSize;
+  ulittle32_t Hash[5];
+  ulittle32_t Reserved;
+};
+
+struct ValueRecord {
+  ulittle64_t GUID;
+  ulittle32_t FirstSummary;
+  ulittle32_t NumSummaries;
+};
+
+struct SummaryRecord {
+  /// A GlobalValueSummary::SummaryKind.
+  ulittle32_t Kind;
+  /// The GlobalValueSummary::GVFlags: linkage in bits 0-3, then
+  /// NotEligibleToImport, Live and DSOLocal.
+  ulittle32_t Flags;
+  ulittle32_t ModuleIndex;
+  ulittle32_t InstCount;
+  /// The FunctionSummary::FFlags: ReadNone, ReadOnly, NoRecurse and
+  /// ReturnDoesNotAlias in bits 0-3.
+  ulittle32_t FunFlags;
+  ulittle32_t FirstEdge;
+  ulittle32_t NumRefs;
+  ulittle32_t NumCalls;
+  ulittle64_t OriginalName;
+  ulittle64_t AliaseeGUID;
+};
+
+struct EdgeRecord {
+  ulittle64_t GUID;
+  ulittle32_t Hotness;
+  ulittle32_t RelBlockFreq;
+};
+
+struct NameRecord {
+  ulittle32_t Offset;
+  ulittle32_t Size;
+};
+
+} // end namespace summaryimage
+
+/// A summary index image, queried in place. The image does not own the
+/// underlying memory, which must outlive it.
+class ModuleSummaryIndexImage {
+public:
+  /// A summary in the image.
+  class Summary {
+    const ModuleSummaryIndexImage *Image;
+    const summaryimage::SummaryRecord *R;
+
+  public:
+    Summary(const ModuleSummaryIndexImage *Image,
+            const summaryimage::SummaryRecord *R)
+        : Image(Image), R(R) {}
+
+    GlobalValueSummary::SummaryKind getSummaryKind() const {
+      return GlobalValueSummary::SummaryKind(uint32_t(R->Kind));
+    }
+    GlobalValueSummary::GVFlags flags() const;
+    GlobalValue::LinkageTypes linkage() const {
+      return GlobalValue::LinkageTypes(R->Flags & 0xf);
+    }
+    bool notEligibleToImport() const { return flags().NotEligibleToImport; }
+    bool isLive() const { return flags().Live; }
+    unsigned getModuleIndex() const { return R->ModuleIndex; }
+    StringRef modulePath() const {
+      return Image->getModulePath(R->ModuleIndex);
+    }
+    GlobalValue::GUID getOriginalName() const { return R->OriginalName; }
+
+    /// Only meaningful for function summaries.
+    unsigned instCount() const { return R->InstCount; }
+    FunctionSummary::FFlags fflags() const;
+
+    /// Only meaningful for alias summaries.
+    GlobalValue::GUID getAliaseeGUID() const { return R->AliaseeGUID; }
+
+    /// The references and the calls of this summary. Only the GUID is
+    /// meaningful for references.
+    ArrayRef<summaryimage::EdgeRecord> refs() const {
+      return Image->Edges.slice(R->FirstEdge, R->NumRefs);
+    }
+    ArrayRef<summaryimage::EdgeRecord> calls() const {
+      return Image->Edges.slice(R->FirstEdge + R->NumRefs, R->NumCalls);
+    }
+  };
+
+  /// Returns true if \p Buffer starts with the magic of an index image.
+  static bool isImage(StringRef Buffer);
+
+  /// Validates the image in \p Buffer. The buffer must be 8-byte aligned, which
+  /// memory-mapped files and MemoryBuffers always are.
+  static Expected<ModuleSummaryIndexImage> create(MemoryBufferRef Buffer);
+
+  bool withGlobalValueDeadStripping() const {
+    return Hdr->Flags & summaryimage::WithGlobalValueDeadStripping;
+  }
+  bool skipModuleByDistributedBackend() const {
+    return Hdr->Flags & summaryimage::SkipModuleByDistributedBackend;
+  }
+
+  unsigned getNumModules() const { return Modules.size(); }
+  StringRef getModulePath(unsigned I) const {
+    return getString(Modules[I].PathOffset, Modules[I].PathSize);
+  }
+  uint64_t getModuleId(unsigned I) const { return Modules[I].ModuleId; }
+  ModuleHash getModuleHash(unsigned I) const;
+
+  /// The GUIDs that have summaries, in increasing order.
+  ArrayRef<summaryimage::ValueRecord> values() const { return Values; }
+
+  /// Returns the summaries of \p V.
+  std::vector<Summary> getSummaries(const summaryimage::ValueRecord &V) const;
+
+  /// Returns the summaries of \p GUID, found by binary search.
+  std::vector<Summary> findSummaries(GlobalValue::GUID GUID) const;
+
+  /// Returns true unless dead stripping ran and found every summary of
+  /// \p GUID dead. Mirrors ModuleSummaryIndex::isGUIDLive.
+  bool isGUIDLive(GlobalValue::GUID GUID) const;
+
+  /// Builds a ModuleSummaryIndex equivalent to the image, for the consumers
+  /// that need one.
+  Expected<std::unique_ptr<ModuleSummaryIndex>> materialize() const;
+
+private:
+  ModuleSummaryIndexImage() = default;
+
+  StringRef getString(uint32_t Offset, uint32_t Size) const {
+    return StringTable.substr(Offset, Size);
+  }
+
+  const summaryimage::Header *Hdr = nullptr;
+  ArrayRef<summaryimage::ModuleRecord> Modules;
+  ArrayRef<summaryimage::ValueRecord> Values;
+  ArrayRef<summaryimage::SummaryRecord> Summaries;
+  ArrayRef<summaryimage::EdgeRecord> Edges;
+  ArrayRef<summaryimage::NameRecord> CfiFunctionNames;
+  StringRef StringTable;
+};
+
+/// Write \p Index to \p Out as an index image. If \p ModuleToSummariesForIndex
+/// is non-null, only the summaries it lists are written, as for
+/// WriteIndexToFile. Returns an error if the index holds information the image
+/// cannot represent.
+Error writeModuleSummaryIndexImage(
+    const ModuleSummaryIndex &Index, raw_ostream &Out,
+    const std::map<std::string, GVSummaryMapTy> *ModuleToSummariesForIndex =
+        nullptr);
+
+} // end namespace llvm
+
+#endif // LLVM_IR_MODULESUMMARYINDEXIMAGE_H
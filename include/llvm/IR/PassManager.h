@@ -46,6 +46,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManagerInternal.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/TypeName.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -453,7 +454,12 @@ public:
         dbgs() << "Running pass: " << Passes[Idx]->name() << " on "
                << IR.getName() << "\n";
 
-      PreservedAnalyses PassPA = Passes[Idx]->run(IR, AM, ExtraArgs...);
+      PreservedAnalyses PassPA;
+      {
+        TimeTraceScope PassScope(Passes[Idx]->name(),
+                                 [&]() { return std::string(IR.getName()); });
+        PassPA = Passes[Idx]->run(IR, AM, ExtraArgs...);
+      }
 
       // Update the analysis manager as each pass runs and potentially
       // invalidates analyses.
@@ -33,6 +33,7 @@
 
 namespace llvm {
 
+class IRArena;
 template <typename T> class ArrayRef;
 template <typename T> class MutableArrayRef;
 
@@ -47,7 +48,9 @@ class User : public Value {
   friend struct HungoffOperandTraits;
 
   LLVM_ATTRIBUTE_ALWAYS_INLINE inline static void *
-  allocateFixedOperandUser(size_t, unsigned, unsigned);
+  allocateFixedOperandUser(size_t, unsigned, unsigned, IRArena *);
+  LLVM_ATTRIBUTE_ALWAYS_INLINE inline static void *
+  allocateHungOffOperandUser(size_t, IRArena *);
 
 protected:
   /// Allocate a User with an operand pointer co-allocated.
@@ -71,6 +74,15 @@ protected:
   /// This is used for subclasses which have a fixed number of operands.
   void *operator new(size_t Size, unsigned Us, unsigned DescBytes);
 
+  /// Allocate a User like the operator new overloads above, taking the
+  /// storage from \p Arena if it is not null. The storage of such a User is
+  /// not freed by operator delete, only when the arena is destroyed.
+  ///
+  /// These are used by the allocation functions of Instruction.
+  static void *allocateUser(size_t Size, unsigned Us, unsigned DescBytes,
+                            IRArena *Arena);
+  static void *allocateHungOffUser(size_t Size, IRArena *Arena);
+
   User(Type *ty, unsigned vty, Use *, unsigned NumOps)
       : Value(ty, vty) {
     assert(NumOps < (1u << NumUserOperandsBits) && "Too many operands");
@@ -111,7 +111,7 @@ protected:
   ///
   /// Note, this should *NOT* be used directly by any class other than User.
   /// User uses this value to find the Use list.
-  enum : unsigned { NumUserOperandsBits = 28 };
+  enum : unsigned { NumUserOperandsBits = 27 };
   unsigned NumUserOperands : NumUserOperandsBits;
 
   // Use the same type as the bitfield above so that MSVC will pack them.
@@ -120,6 +120,11 @@ protected:
   unsigned HasHungOffUses : 1;
   unsigned HasDescriptor : 1;
 
+  /// Set by the allocation functions of User and BasicBlock when the storage
+  /// of this value comes from an IRArena, in which case it is not freed by
+  /// operator delete. Like HasHungOffUses, it is not initialized by the ctor.
+  unsigned IsArenaAllocated : 1;
+
 private:
   template <typename UseT> // UseT == 'Use' or 'const Use'
   class use_iterator_impl
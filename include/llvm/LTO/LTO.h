@@ -46,6 +46,10 @@ class raw_pwrite_stream;
 ///
 /// This is done for correctness (if value exported, ensure we always
 /// emit a copy), and compile-time optimization (allow drop of duplicates).
+///
+/// The GUIDs of the index are processed in parallel, so \p isPrevailing may
+/// be called concurrently. \p recordNewLinkage is called on the calling
+/// thread, in the order of the index.
 void thinLTOResolveWeakForLinkerInIndex(
     ModuleSummaryIndex &Index,
     function_ref<bool(GlobalValue::GUID, const GlobalValueSummary *)>
@@ -56,6 +60,9 @@ void thinLTOResolveWeakForLinkerInIndex(
 /// Update the linkages in the given \p Index to mark exported values
 /// as external and non-exported values as internal. The ThinLTO backends
 /// must apply the changes to the Module via thinLTOInternalizeModule.
+///
+/// The GUIDs of the index are processed in parallel, so \p isExported may be
+/// called concurrently.
 void thinLTOInternalizeAndPromoteInIndex(
     ModuleSummaryIndex &Index,
     function_ref<bool(StringRef, GlobalValue::GUID)> isExported);
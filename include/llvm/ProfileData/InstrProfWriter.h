@@ -60,6 +60,9 @@ public:
   void mergeRecordsFromWriter(InstrProfWriter &&IPW,
                               function_ref<void(Error)> Warn);
 
+  /// Return the number of distinct functions with profile data.
+  size_t getNumFunctions() const { return FunctionData.size(); }
+
   /// Write the profile to \c OS
   void write(raw_fd_ostream &OS);
 
@@ -204,14 +204,35 @@
 //          in the text format documentation above).
 //        FUNCTION BODY
 //          A FUNCTION BODY entry describing the inlined function.
+//
+// FUNCTION OFFSET TABLE [version 104 and later]
+//    SIZE (uint64_t)
+//        Number of entries in the table, one for each top-level function.
+//    ENTRIES
+//        A list of SIZE entries. Each entry contains:
+//          NAME_IDX (uint32_t)
+//              Index into the name table indicating the function name.
+//          OFFSET (uint64_t)
+//              Offset of the FUNCTION BODY of the function from the start of
+//              the file.
+//
+// TABLE OFFSET (little-endian uint64_t, not ULEB128-encoded)
+//    Offset of the FUNCTION OFFSET TABLE from the start of the file, stored
+//    in the last 8 bytes of the file [version 104 and later].
+//
+// The function offset table lets a reader that is told which functions it
+// needs (see SampleProfileReader::collectFuncsToUse()) decode only the
+// profiles of those functions, rather than every function in the file.
 //===----------------------------------------------------------------------===//
 
 #ifndef LLVM_PROFILEDATA_SAMPLEPROFREADER_H
 #define LLVM_PROFILEDATA_SAMPLEPROFREADER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Function.h"
@@ -231,6 +252,7 @@
 
 namespace llvm {
 
+class Module;
 class raw_ostream;
 
 namespace sampleprof {
@@ -275,6 +297,12 @@ public:
   /// Read sample profiles from the associated file.
   virtual std::error_code read() = 0;
 
+  /// Tell the reader that only the profiles of the functions defined in
+  /// \p M are needed, so that read() may skip decoding the others. Readers
+  /// that cannot locate the profile of a single function ignore this and
+  /// read every profile.
+  virtual void collectFuncsToUse(const Module &M) {}
+
   /// Print the profile for \p FName on stream \p OS.
   void dumpFunctionProfile(StringRef FName, raw_ostream &OS = dbgs());
 
@@ -358,6 +386,10 @@ public:
   /// Read sample profiles from the associated file.
   std::error_code read() override;
 
+  /// Only decode the profiles of the functions defined in \p M, if the
+  /// profile has a function offset table.
+  void collectFuncsToUse(const Module &M) override;
+
   /// Return true if \p Buffer is in the format supported by this class.
   static bool hasFormat(const MemoryBuffer &Buffer);
 
@@ -387,6 +419,9 @@ protected:
   /// Read the contents of the given profile instance.
   std::error_code readProfile(FunctionSamples &FProfile);
 
+  /// Read the profile of the top-level function starting at Data.
+  std::error_code readFuncProfile();
+
   /// Points to the current location in the buffer.
   const uint8_t *Data = nullptr;
 
@@ -401,6 +436,22 @@ private:
 
   /// Read profile summary.
   std::error_code readSummary();
+
+  /// Read the function offset table found at the end of the profile, and
+  /// make End point to the end of the function bodies.
+  std::error_code readFuncOffsetTable();
+
+  /// Offset from the start of the buffer of the profile of each top-level
+  /// function. Empty if the profile has no function offset table.
+  DenseMap<StringRef, uint64_t> FuncOffsetTable;
+
+  /// Whether the profile has a function offset table.
+  bool HasFuncOffsetTable = false;
+
+  /// The names of the functions whose profiles read() should decode, used
+  /// unless UseAllFuncs is set.
+  StringSet<> FuncsToUse;
+  bool UseAllFuncs = true;
 };
 
 using InlineCallStack = SmallVector<FunctionSamples *, 10>;
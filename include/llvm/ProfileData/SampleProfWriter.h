@@ -24,6 +24,8 @@
 #include <cstdint>
 #include <memory>
 #include <system_error>
+#include <utility>
+#include <vector>
 
 namespace llvm {
 namespace sampleprof {
@@ -66,6 +68,9 @@ protected:
   virtual std::error_code
   writeHeader(const StringMap<FunctionSamples> &ProfileMap) = 0;
 
+  /// Write whatever must follow the function profiles in the profile file.
+  virtual std::error_code writeFooter() { return sampleprof_error::success; }
+
   /// Output stream where to emit the profile to.
   std::unique_ptr<raw_ostream> OutputStream;
 
@@ -112,6 +117,7 @@ protected:
 
   std::error_code
   writeHeader(const StringMap<FunctionSamples> &ProfileMap) override;
+  std::error_code writeFooter() override;
   std::error_code writeSummary();
   std::error_code writeNameIdx(StringRef FName);
   std::error_code writeBody(const FunctionSamples &S);
@@ -122,6 +128,13 @@ private:
 
   MapVector<StringRef, uint32_t> NameTable;
 
+  /// Position of the start of the profile in the output stream.
+  uint64_t FileStart = 0;
+
+  /// Offset from the start of the profile of each top-level function
+  /// written so far, in order.
+  std::vector<std::pair<StringRef, uint64_t>> FuncOffsetTable;
+
   friend ErrorOr<std::unique_ptr<SampleProfileWriter>>
   SampleProfileWriter::create(std::unique_ptr<raw_ostream> &OS,
                               SampleProfileFormat Format);
@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <mutex>
 
@@ -31,7 +32,21 @@ namespace llvm {
 
 namespace parallel {
 struct sequential_execution_policy {};
-struct parallel_execution_policy {};
+struct parallel_execution_policy {
+  constexpr parallel_execution_policy() : ThreadCount(0) {}
+  explicit constexpr parallel_execution_policy(unsigned ThreadCount)
+      : ThreadCount(ThreadCount) {}
+
+  /// Returns a policy that runs at most \p N tasks of the algorithm at once.
+  /// The tasks still run on the shared executor, so \p N is an upper bound.
+  constexpr parallel_execution_policy withThreads(unsigned N) const {
+    return parallel_execution_policy(N);
+  }
+
+  /// The maximum number of tasks run concurrently, or 0 for no limit other
+  /// than the number of threads of the executor.
+  unsigned ThreadCount;
+};
 
 template <typename T>
 struct is_execution_policy
@@ -70,30 +85,59 @@ public:
     std::unique_lock<std::mutex> lock(Mutex);
     Cond.wait(lock, [&] { return Count == 0; });
   }
+
+  bool isDone() const {
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Count == 0;
+  }
 };
 
+/// A group of tasks run on the shared work-stealing executor. The destructor
+/// waits for all of them.
+///
+/// Groups may be nested: when sync() is called from one of the executor's
+/// own threads, that thread runs pending tasks while it waits instead of
+/// blocking.
 class TaskGroup {
   Latch L;
 
+  /// The maximum number of tasks of this group that run at once, or 0.
+  const unsigned MaxConcurrency;
+
+  /// With a concurrency limit, tasks that could not be handed to the executor
+  /// yet, and the number of executor tasks currently draining them.
+  std::mutex PendingMutex;
+  std::deque<std::function<void()>> Pending;
+  unsigned Running = 0;
+
+  void drain(std::function<void()> F);
+
 public:
+  explicit TaskGroup(unsigned MaxConcurrency = 0)
+      : MaxConcurrency(MaxConcurrency) {}
+  ~TaskGroup();
+
   void spawn(std::function<void()> f);
 
-  void sync() const { L.sync(); }
+  void sync() const;
 };
 
 #if defined(_MSC_VER)
+// ConcRT manages its own concurrency, so the thread count is ignored here.
 template <class RandomAccessIterator, class Comparator>
 void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End,
-                   const Comparator &Comp) {
+                   const Comparator &Comp, unsigned ThreadCount) {
   concurrency::parallel_sort(Start, End, Comp);
 }
 template <class IterTy, class FuncTy>
-void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn) {
+void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn,
+                       unsigned ThreadCount) {
   concurrency::parallel_for_each(Begin, End, Fn);
 }
 
 template <class IndexTy, class FuncTy>
-void parallel_for_each_n(IndexTy Begin, IndexTy End, FuncTy Fn) {
+void parallel_for_each_n(IndexTy Begin, IndexTy End, FuncTy Fn,
+                         unsigned ThreadCount) {
   concurrency::parallel_for(Begin, End, Fn);
 }
 
@@ -141,14 +185,15 @@ void parallel_quick_sort(RandomAccessIterator Start, RandomAccessIterator End,
 
 template <class RandomAccessIterator, class Comparator>
 void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End,
-                   const Comparator &Comp) {
-  TaskGroup TG;
+                   const Comparator &Comp, unsigned ThreadCount) {
+  TaskGroup TG(ThreadCount);
   parallel_quick_sort(Start, End, Comp, TG,
                       llvm::Log2_64(std::distance(Start, End)) + 1);
 }
 
 template <class IterTy, class FuncTy>
-void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn) {
+void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn,
+                       unsigned ThreadCount) {
   // TaskGroup has a relatively high overhead, so we want to reduce
   // the number of spawn() calls. We'll create up to 1024 tasks here.
   // (Note that 1024 is an arbitrary number. This code probably needs
@@ -157,7 +202,7 @@ void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn) {
   if (TaskSize == 0)
     TaskSize = 1;
 
-  TaskGroup TG;
+  TaskGroup TG(ThreadCount);
   while (TaskSize < std::distance(Begin, End)) {
     TG.spawn([=, &Fn] { std::for_each(Begin, Begin + TaskSize, Fn); });
     Begin += TaskSize;
@@ -166,12 +211,13 @@ void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn) {
 }
 
 template <class IndexTy, class FuncTy>
-void parallel_for_each_n(IndexTy Begin, IndexTy End, FuncTy Fn) {
+void parallel_for_each_n(IndexTy Begin, IndexTy End, FuncTy Fn,
+                         unsigned ThreadCount) {
   ptrdiff_t TaskSize = (End - Begin) / 1024;
   if (TaskSize == 0)
     TaskSize = 1;
 
-  TaskGroup TG;
+  TaskGroup TG(ThreadCount);
   IndexTy I = Begin;
   for (; I + TaskSize < End; I += TaskSize) {
     TG.spawn([=, &Fn] {
@@ -225,19 +271,19 @@ template <class RandomAccessIterator,
           class Comparator = detail::DefComparator<RandomAccessIterator>>
 void sort(parallel_execution_policy policy, RandomAccessIterator Start,
           RandomAccessIterator End, const Comparator &Comp = Comparator()) {
-  detail::parallel_sort(Start, End, Comp);
+  detail::parallel_sort(Start, End, Comp, policy.ThreadCount);
 }
 
 template <class IterTy, class FuncTy>
 void for_each(parallel_execution_policy policy, IterTy Begin, IterTy End,
               FuncTy Fn) {
-  detail::parallel_for_each(Begin, End, Fn);
+  detail::parallel_for_each(Begin, End, Fn, policy.ThreadCount);
 }
 
 template <class IndexTy, class FuncTy>
 void for_each_n(parallel_execution_policy policy, IndexTy Begin, IndexTy End,
                 FuncTy Fn) {
-  detail::parallel_for_each_n(Begin, End, Fn);
+  detail::parallel_for_each_n(Begin, End, Fn, policy.ThreadCount);
 }
 #endif
 
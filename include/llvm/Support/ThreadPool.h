@@ -29,16 +29,35 @@
 
 namespace llvm {
 
+namespace parallel {
+namespace detail {
+class TaskGroup;
+} // namespace detail
+} // namespace parallel
+
 /// A ThreadPool for asynchronous parallel execution on a defined number of
 /// threads.
 ///
-/// The pool keeps a vector of threads alive, waiting on a condition variable
-/// for some work to become available.
+/// By default the pool keeps a vector of threads alive, waiting on a condition
+/// variable for some work to become available. Alternatively, it can run its
+/// tasks on the work-stealing executor behind llvm/Support/Parallel.h, so that
+/// it shares threads with parallel_for_each and friends instead of
+/// oversubscribing the machine.
 class ThreadPool {
 public:
   using TaskTy = std::function<void()>;
   using PackagedTaskTy = std::packaged_task<void()>;
 
+  /// Where the tasks of the pool are run.
+  enum class ExecutionMode {
+    /// On threads owned by the pool.
+    OwnThreads,
+    /// On the executor shared with llvm/Support/Parallel.h, with at most
+    /// ThreadCount tasks of this pool running at once. Tasks must not block
+    /// waiting for tasks submitted after them, as they may not get a thread.
+    SharedExecutor
+  };
+
   /// Construct a pool with the number of threads found by
   /// hardware_concurrency().
   ThreadPool();
@@ -46,6 +65,10 @@ public:
   /// Construct a pool of \p ThreadCount threads
   ThreadPool(unsigned ThreadCount);
 
+  /// Construct a pool running at most \p ThreadCount tasks at a time, on
+  /// threads chosen by \p Mode.
+  ThreadPool(unsigned ThreadCount, ExecutionMode Mode);
+
   /// Blocking destructor: the pool will wait for all the threads to complete.
   ~ThreadPool();
 
@@ -94,6 +117,9 @@ private:
 #if LLVM_ENABLE_THREADS // avoids warning for unused variable
   /// Signal for the destruction of the pool, asking thread to exit.
   bool EnableFlag;
+
+  /// The tasks of a pool in ExecutionMode::SharedExecutor, null otherwise.
+  std::unique_ptr<parallel::detail::TaskGroup> SharedTasks;
 #endif
 };
 }
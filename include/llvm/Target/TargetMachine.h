@@ -339,6 +339,13 @@ public:
   /// EXPENSIVE_CHECKS is enabled.
   virtual bool isMachineVerifierClean() const { return true; }
 
+  /// Returns true if the machine function passes can run over several
+  /// functions of \p M at once, see TargetOptions::MachineFunctionThreads.
+  /// Exception handling, garbage collection and debug info share per-module
+  /// state between those passes, so modules using them are compiled one
+  /// function at a time.
+  virtual bool canRunMachineFunctionPassesConcurrently(const Module &M) const;
+
   /// Adds an AsmPrinter pass to the pipeline that prints assembly or
   /// machine code from the MI representation.
   bool addAsmPrinter(PassManagerBase &PM, raw_pwrite_stream &Out,
@@ -269,6 +269,11 @@ namespace llvm {
     /// What exception model to use
     ExceptionHandling ExceptionModel = ExceptionHandling::None;
 
+    /// MachineFunctionThreads - The number of threads the machine function
+    /// passes of the codegen pipeline may use. Instruction selection and
+    /// emission stay serial, so the output does not depend on this value.
+    unsigned MachineFunctionThreads = 1;
+
     /// Machine level options.
     MCTargetOptions MCOptions;
   };
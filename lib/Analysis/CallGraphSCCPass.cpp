@@ -30,6 +30,7 @@
 #include "llvm/Pass.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cassert>
@@ -131,6 +132,13 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
 
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
+      TimeTraceScope PassScope(CGSP->getPassName(), [&]() {
+        // Name the SCC after its first function, if it has one.
+        for (CallGraphNode *CGN : CurSCC)
+          if (Function *F = CGN->getFunction())
+            return F->getName().str();
+        return std::string();
+      });
       unsigned InstrCount = initSizeRemarkInfo(M);
       Changed = CGSP->runOnSCC(CurSCC);
 
@@ -18,6 +18,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/ADT/Twine.h"
@@ -56,6 +57,7 @@
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
+#include "llvm/IR/ModuleSummaryIndexImage.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Value.h"
@@ -71,6 +73,7 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
@@ -88,11 +91,24 @@
 
 using namespace llvm;
 
+#define DEBUG_TYPE "bitcode-reader"
+
+STATISTIC(NumDebugLocsSkipped,
+          "Number of debug locations not read because debug info is stripped");
+STATISTIC(NumDebugIntrinsicsSkipped,
+          "Number of debug intrinsics not read because debug info is stripped");
+
 static cl::opt<bool> PrintSummaryGUIDs(
     "print-summary-global-ids", cl::init(false), cl::Hidden,
     cl::desc(
         "Print the global id for each value when reading the module summary"));
 
+static cl::opt<unsigned> MaterializeThreads(
+    "bitcode-materialize-threads", cl::init(0), cl::Hidden,
+    cl::desc("Number of threads used to decode function blocks ahead of IR "
+             "construction when materializing a whole module (0 = decode "
+             "each function block while building its IR)"));
+
 namespace {
 
 enum {
@@ -438,6 +454,79 @@ BitcodeReaderBase::readNameFromStrtab(ArrayRef<uint64_t> Record) {
 
 namespace {
 
+/// The top-level records of a FUNCTION_BLOCK, decoded from the bitstream
+/// without building any IR. Decoding only reads the bitcode buffer, so blocks
+/// can be decoded on other threads while the reader builds the IR of earlier
+/// functions, which needs the (single-threaded) LLVMContext.
+struct DecodedFunctionBlock {
+  /// Code of entries that stand for a nested block rather than a record.
+  static const unsigned SubBlockCode = ~0U;
+
+  struct Entry {
+    /// The record code, or SubBlockCode.
+    unsigned Code;
+    /// For a nested block, its block ID.
+    unsigned BlockID;
+    /// For a record, the index of its first operand in Ops. For a nested
+    /// block, the bit position just after its block ID, from which it can be
+    /// entered.
+    uint64_t Pos;
+    unsigned NumOps;
+  };
+
+  std::vector<Entry> Entries;
+  std::vector<uint64_t> Ops;
+  /// Bit position just past the end of the block.
+  uint64_t EndBit = 0;
+  /// Set if the block is malformed. It is then parsed from the stream instead,
+  /// which reports the error.
+  bool Failed = false;
+
+  /// Decode the function block whose body starts at \p BitNo, using a copy of
+  /// the reader's cursor. Nested blocks are skipped and only their positions
+  /// are recorded.
+  void decode(BitstreamCursor Cursor, uint64_t BitNo);
+};
+
+} // end anonymous namespace
+
+void DecodedFunctionBlock::decode(BitstreamCursor Cursor, uint64_t BitNo) {
+  Cursor.JumpToBit(BitNo);
+  if (Cursor.EnterSubBlock(bitc::FUNCTION_BLOCK_ID)) {
+    Failed = true;
+    return;
+  }
+
+  SmallVector<uint64_t, 64> Record;
+  while (true) {
+    BitstreamEntry Entry = Cursor.advance();
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      Failed = true;
+      return;
+    case BitstreamEntry::EndBlock:
+      EndBit = Cursor.GetCurrentBitNo();
+      return;
+    case BitstreamEntry::SubBlock:
+      Entries.push_back({SubBlockCode, Entry.ID, Cursor.GetCurrentBitNo(), 0});
+      if (Cursor.SkipBlock()) {
+        Failed = true;
+        return;
+      }
+      continue;
+    case BitstreamEntry::Record:
+      break;
+    }
+
+    Record.clear();
+    unsigned Code = Cursor.readRecord(Entry.ID, Record);
+    Entries.push_back({Code, 0, Ops.size(), unsigned(Record.size())});
+    Ops.insert(Ops.end(), Record.begin(), Record.end());
+  }
+}
+
+namespace {
+
 class BitcodeReader : public BitcodeReaderBase, public GVMaterializer {
   LLVMContext &Context;
   Module *TheModule = nullptr;
@@ -671,13 +760,17 @@ private:
   /// Save the positions of the Metadata blocks and skip parsing the blocks.
   Error rememberAndSkipMetadata();
   Error typeCheckLoadStoreInst(Type *ValType, Type *PtrType);
-  Error parseFunctionBody(Function *F);
+  Error parseFunctionBody(Function *F,
+                          const DecodedFunctionBlock *Decoded = nullptr);
   Error globalCleanup();
   Error resolveGlobalAndIndirectSymbolInits();
   Error parseUseLists();
   Error findFunctionInStream(
       Function *F,
       DenseMap<Function *, uint64_t>::iterator DeferredFunctionInfoIterator);
+  Error materializeFunction(Function *F,
+                            const DecodedFunctionBlock *Decoded = nullptr);
+  Error materializeFunctionsInParallel(unsigned NumThreads);
 
   SyncScope::ID getDecodedSyncScopeID(unsigned Val);
 };
@@ -2702,7 +2795,11 @@ Error BitcodeReader::materializeMetadata() {
   return Error::success();
 }
 
-void BitcodeReader::setStripDebugInfo() { StripDebugInfo = true; }
+void BitcodeReader::setStripDebugInfo() {
+  StripDebugInfo = true;
+  if (MDLoader)
+    MDLoader->setStripDebugInfo();
+}
 
 /// When we see the block for a function body, remember where it is and then
 /// skip it.  This lets us lazily deserialize the functions.
@@ -3354,14 +3451,40 @@ Error BitcodeReader::typeCheckLoadStoreInst(Type *ValType, Type *PtrType) {
   return Error::success();
 }
 
-/// Lazily parse the specified function body block.
-Error BitcodeReader::parseFunctionBody(Function *F) {
-  if (Stream.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
+/// Return true if calls through \p FTy take metadata arguments, which may refer
+/// to function-level metadata.
+static bool hasMetadataParams(FunctionType *FTy) {
+  return any_of(FTy->params(), [](Type *T) { return T->isMetadataTy(); });
+}
+
+/// Return true if \p Callee is one of the llvm.dbg.* intrinsics.
+static bool isDebugInfoIntrinsic(const Value *Callee) {
+  const auto *F = dyn_cast<Function>(Callee);
+  if (!F)
+    return false;
+  switch (F->getIntrinsicID()) {
+  case Intrinsic::dbg_declare:
+  case Intrinsic::dbg_value:
+  case Intrinsic::dbg_addr:
+  case Intrinsic::dbg_label:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// Lazily parse the specified function body block. If \p Decoded is set, its
+/// records are read from there instead of from the stream, which is only used
+/// for nested blocks.
+Error BitcodeReader::parseFunctionBody(Function *F,
+                                       const DecodedFunctionBlock *Decoded) {
+  if (!Decoded && Stream.EnterSubBlock(bitc::FUNCTION_BLOCK_ID))
     return error("Invalid record");
 
   // Unexpected unresolved metadata when parsing function.
   if (MDLoader->hasFwdRefs())
     return error("Invalid function metadata: incoming forward references");
+  MDLoader->dropDeferredFunctionMetadata();
 
   InstructionList.clear();
   unsigned ModuleValueListSize = ValueList.size();
@@ -3387,11 +3510,28 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
 
   std::vector<OperandBundleDef> OperandBundles;
 
+  // Return the next entry of the block, positioning the stream at nested
+  // blocks when reading decoded records.
+  unsigned NextDecoded = 0;
+  auto advance = [&]() -> BitstreamEntry {
+    if (!Decoded)
+      return Stream.advance();
+    if (NextDecoded == Decoded->Entries.size()) {
+      Stream.JumpToBit(Decoded->EndBit);
+      return BitstreamEntry::getEndBlock();
+    }
+    const DecodedFunctionBlock::Entry &E = Decoded->Entries[NextDecoded++];
+    if (E.Code != DecodedFunctionBlock::SubBlockCode)
+      return BitstreamEntry::getRecord(0);
+    Stream.JumpToBit(E.Pos);
+    return BitstreamEntry::getSubBlock(E.BlockID);
+  };
+
   // Read all the records.
   SmallVector<uint64_t, 64> Record;
 
   while (true) {
-    BitstreamEntry Entry = Stream.advance();
+    BitstreamEntry Entry = advance();
 
     switch (Entry.Kind) {
     case BitstreamEntry::Error:
@@ -3421,7 +3561,7 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
       case bitc::METADATA_BLOCK_ID:
         assert(DeferredMetadataInfo.empty() &&
                "Must read all module-level metadata before function-level");
-        if (Error Err = MDLoader->parseFunctionMetadata())
+        if (Error Err = MDLoader->deferFunctionMetadata())
           return Err;
         break;
       case bitc::USELIST_BLOCK_ID:
@@ -3439,7 +3579,15 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
     // Read a record.
     Record.clear();
     Instruction *I = nullptr;
-    unsigned BitCode = Stream.readRecord(Entry.ID, Record);
+    unsigned BitCode;
+    if (Decoded) {
+      const DecodedFunctionBlock::Entry &E = Decoded->Entries[NextDecoded - 1];
+      BitCode = E.Code;
+      Record.append(Decoded->Ops.begin() + E.Pos,
+                    Decoded->Ops.begin() + E.Pos + E.NumOps);
+    } else {
+      BitCode = Stream.readRecord(Entry.ID, Record);
+    }
     switch (BitCode) {
     default: // Default behavior: reject
       return error("Invalid value");
@@ -3481,6 +3629,10 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
     case bitc::FUNC_CODE_DEBUG_LOC_AGAIN:  // DEBUG_LOC_AGAIN
       // This record indicates that the last instruction is at the same
       // location as the previous instruction with a location.
+      if (StripDebugInfo) {
+        ++NumDebugLocsSkipped;
+        continue;
+      }
       I = getLastInstruction();
 
       if (!I)
@@ -3490,12 +3642,21 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
       continue;
 
     case bitc::FUNC_CODE_DEBUG_LOC: {      // DEBUG_LOC: [line, col, scope, ia]
+      // Locations would be dropped after parsing; do not build them, nor
+      // load the function-level metadata they refer to.
+      if (StripDebugInfo) {
+        ++NumDebugLocsSkipped;
+        continue;
+      }
       I = getLastInstruction();
       if (!I || Record.size() < 4)
         return error("Invalid record");
 
       unsigned Line = Record[0], Col = Record[1];
       unsigned ScopeID = Record[2], IAID = Record[3];
+      if (std::max(ScopeID, IAID) > MDLoader->size())
+        if (Error Err = MDLoader->loadDeferredFunctionMetadata())
+          return Err;
 
       MDNode *Scope = nullptr, *IA = nullptr;
       if (ScopeID) {
@@ -4112,6 +4273,9 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
                      "callee operand");
       if (Record.size() < FTy->getNumParams() + OpNum)
         return error("Insufficient operands to call");
+      if (hasMetadataParams(FTy))
+        if (Error Err = MDLoader->loadDeferredFunctionMetadata())
+          return Err;
 
       SmallVector<Value*, 16> Ops;
       for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i, ++OpNum) {
@@ -4508,6 +4672,19 @@ Error BitcodeReader::parseFunctionBody(Function *F) {
       if (Record.size() < FTy->getNumParams() + OpNum)
         return error("Insufficient operands to call");
 
+      // Debug intrinsics would be erased after parsing; do not build them,
+      // nor load the function-level metadata they refer to. They have no
+      // value number, and their attachments are dropped.
+      if (StripDebugInfo && isDebugInfoIntrinsic(Callee)) {
+        ++NumDebugIntrinsicsSkipped;
+        OperandBundles.clear();
+        InstructionList.push_back(nullptr);
+        continue;
+      }
+      if (hasMetadataParams(FTy))
+        if (Error Err = MDLoader->loadDeferredFunctionMetadata())
+          return Err;
+
       SmallVector<Value*, 16> Args;
       // Read the fixed params.
       for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i, ++OpNum) {
@@ -4619,6 +4796,9 @@ OutOfRecordLoop:
   if (!OperandBundles.empty())
     return error("Operand bundles found with no consumer");
 
+  // Function-level metadata that nothing referred to is not needed.
+  MDLoader->dropDeferredFunctionMetadata();
+
   // Check the function list for unresolved values.
   if (Argument *A = dyn_cast<Argument>(ValueList.back())) {
     if (!A->getParent()) {
@@ -4688,15 +4868,25 @@ Error BitcodeReader::materialize(GlobalValue *GV) {
     if (Error Err = findFunctionInStream(F, DFII))
       return Err;
 
+  return materializeFunction(F);
+}
+
+Error BitcodeReader::materializeFunction(Function *F,
+                                         const DecodedFunctionBlock *Decoded) {
   // Materialize metadata before parsing any function bodies.
   if (Error Err = materializeMetadata())
     return Err;
 
-  // Move the bit stream to the saved position of the deferred function body.
-  Stream.JumpToBit(DFII->second);
+  if (Decoded && !Decoded->Failed) {
+    if (Error Err = parseFunctionBody(F, Decoded))
+      return Err;
+  } else {
+    // Move the bit stream to the saved position of the deferred function body.
+    Stream.JumpToBit(DeferredFunctionInfo[F]);
 
-  if (Error Err = parseFunctionBody(F))
-    return Err;
+    if (Error Err = parseFunctionBody(F))
+      return Err;
+  }
   F->setIsMaterializable(false);
 
   if (StripDebugInfo)
@@ -4740,6 +4930,50 @@ Error BitcodeReader::materialize(GlobalValue *GV) {
   return materializeForwardReferencedFunctions();
 }
 
+/// Materialize the functions whose bodies have been located, decoding their
+/// function blocks on \p NumThreads threads ahead of building their IR on
+/// this one. Functions are still materialized in module order, so the result
+/// is the same as materializing them one by one.
+Error BitcodeReader::materializeFunctionsInParallel(unsigned NumThreads) {
+  std::vector<Function *> Work;
+  for (Function &F : *TheModule) {
+    if (!F.isMaterializable())
+      continue;
+    auto DFII = DeferredFunctionInfo.find(&F);
+    if (DFII != DeferredFunctionInfo.end() && DFII->second)
+      Work.push_back(&F);
+  }
+  if (Work.size() < 2)
+    return Error::success();
+
+  // Bound the number of decoded blocks alive at once, so that large modules
+  // are not decoded in full before any IR is built.
+  const size_t Window = 4 * NumThreads;
+  std::vector<std::unique_ptr<DecodedFunctionBlock>> Decoded(Work.size());
+  std::vector<std::shared_future<void>> Done(Work.size());
+  ThreadPool Pool(NumThreads);
+  auto Submit = [&](size_t I) {
+    Decoded[I] = llvm::make_unique<DecodedFunctionBlock>();
+    Done[I] = Pool.async(&DecodedFunctionBlock::decode, Decoded[I].get(),
+                         Stream, DeferredFunctionInfo[Work[I]]);
+  };
+
+  size_t NextToSubmit = 0;
+  for (size_t I = 0, E = Work.size(); I != E; ++I) {
+    for (; NextToSubmit != E && NextToSubmit < I + Window; ++NextToSubmit)
+      Submit(NextToSubmit);
+    Done[I].wait();
+
+    // The function may have been materialized already as the target of a
+    // blockaddress. On error, the pool waits for the blocks in flight.
+    if (Work[I]->isMaterializable())
+      if (Error Err = materializeFunction(Work[I], Decoded[I].get()))
+        return Err;
+    Decoded[I].reset();
+  }
+  return Error::success();
+}
+
 Error BitcodeReader::materializeModule() {
   if (Error Err = materializeMetadata())
     return Err;
@@ -4747,6 +4981,10 @@ Error BitcodeReader::materializeModule() {
   // Promise to materialize all forward references.
   WillMaterializeAllForwardRefs = true;
 
+  if (MaterializeThreads)
+    if (Error Err = materializeFunctionsInParallel(MaterializeThreads))
+      return Err;
+
   // Iterate over the module, deserializing any functions that are still on
   // disk.
   for (Function &F : *TheModule) {
@@ -5909,6 +6147,14 @@ Error llvm::readModuleSummaryIndex(MemoryBufferRef Buffer,
 
 Expected<std::unique_ptr<ModuleSummaryIndex>>
 llvm::getModuleSummaryIndex(MemoryBufferRef Buffer) {
+  if (ModuleSummaryIndexImage::isImage(Buffer.getBuffer())) {
+    Expected<ModuleSummaryIndexImage> Image =
+        ModuleSummaryIndexImage::create(Buffer);
+    if (!Image)
+      return Image.takeError();
+    return Image->materialize();
+  }
+
   Expected<BitcodeModule> BM = getSingleModule(Buffer);
   if (!BM)
     return BM.takeError();
@@ -90,6 +90,12 @@ using namespace llvm;
 STATISTIC(NumMDStringLoaded, "Number of MDStrings loaded");
 STATISTIC(NumMDNodeTemporary, "Number of MDNode::Temporary created");
 STATISTIC(NumMDRecordLoaded, "Number of Metadata records loaded");
+STATISTIC(NumFunctionMDBlockLoaded,
+          "Number of function-level Metadata blocks loaded");
+STATISTIC(NumFunctionMDBlockSkipped,
+          "Number of function-level Metadata blocks never loaded");
+STATISTIC(NumFunctionMDBytesSkipped,
+          "Number of bytes of function-level Metadata never loaded");
 
 /// Flag whether we need to import full type definitions for ThinLTO.
 /// Currently needed for Darwin and LLDB.
@@ -100,7 +106,8 @@ static cl::opt<bool> ImportFullTypeDefinitions(
 static cl::opt<bool> DisableLazyLoading(
     "disable-ondemand-mds-loading", cl::init(false), cl::Hidden,
     cl::desc("Force disable the lazy-loading on-demand of metadata when "
-             "loading bitcode for importing."));
+             "loading bitcode for importing, and of function-level "
+             "metadata."));
 
 namespace {
 
@@ -440,6 +447,10 @@ class MetadataLoader::MetadataLoaderImpl {
   /// populated.
   void lazyLoadOneMetadata(unsigned Idx, PlaceholderQueue &Placeholders);
 
+  /// Bit positions and sizes of the function-level METADATA_BLOCKs of the
+  /// function being parsed that have been skipped so far.
+  SmallVector<std::pair<uint64_t, uint64_t>, 1> DeferredFunctionMetadata;
+
   // Keep mapping of seens pair of old-style CU <-> SP, and update pointers to
   // point from SP to CU after a block is completly parsed.
   std::vector<std::pair<DICompileUnit *, Metadata *>> CUSubprograms;
@@ -452,6 +463,7 @@ class MetadataLoader::MetadataLoaderImpl {
   DenseMap<unsigned, unsigned> MDKindMap;
 
   bool StripTBAA = false;
+  bool StripDebugInfo = false;
   bool HasSeenOldLoopTags = false;
   bool NeedUpgradeToDIGlobalVariableExpression = false;
   bool NeedDeclareExpressionUpgrade = false;
@@ -632,6 +644,10 @@ public:
 
   Error parseMetadata(bool ModuleLevel);
 
+  Error deferFunctionMetadata();
+  Error loadDeferredFunctionMetadata();
+  void dropDeferredFunctionMetadata();
+
   bool hasFwdRefs() const { return MetadataList.hasFwdRefs(); }
 
   Metadata *getMetadataFwdRefOrLoad(unsigned ID) {
@@ -667,6 +683,7 @@ public:
 
   void setStripTBAA(bool Value) { StripTBAA = Value; }
   bool isStrippingTBAA() { return StripTBAA; }
+  void setStripDebugInfo() { StripDebugInfo = true; }
 
   unsigned size() const { return MetadataList.size(); }
   void shrinkTo(unsigned N) { MetadataList.shrinkTo(N); }
@@ -913,6 +930,45 @@ Error MetadataLoader::MetadataLoaderImpl::parseMetadata(bool ModuleLevel) {
   }
 }
 
+/// Function-level metadata is only referenced by the function's debug
+/// locations, metadata arguments and attachments, each of which loads it
+/// before referring to it. A function that is read without its debug info may
+/// never need the block at all.
+Error MetadataLoader::MetadataLoaderImpl::deferFunctionMetadata() {
+  if (DisableLazyLoading)
+    return parseMetadata(false);
+
+  uint64_t Pos = Stream.GetCurrentBitNo();
+  if (Stream.SkipBlock())
+    return error("Invalid record");
+  DeferredFunctionMetadata.push_back({Pos, Stream.GetCurrentBitNo() - Pos});
+  return Error::success();
+}
+
+Error MetadataLoader::MetadataLoaderImpl::loadDeferredFunctionMetadata() {
+  if (DeferredFunctionMetadata.empty())
+    return Error::success();
+
+  uint64_t SavedPos = Stream.GetCurrentBitNo();
+  for (const auto &Block : DeferredFunctionMetadata) {
+    ++NumFunctionMDBlockLoaded;
+    Stream.JumpToBit(Block.first);
+    if (Error Err = parseMetadata(false))
+      return Err;
+  }
+  DeferredFunctionMetadata.clear();
+  Stream.JumpToBit(SavedPos);
+  return Error::success();
+}
+
+void MetadataLoader::MetadataLoaderImpl::dropDeferredFunctionMetadata() {
+  for (const auto &Block : DeferredFunctionMetadata) {
+    ++NumFunctionMDBlockSkipped;
+    NumFunctionMDBytesSkipped += Block.second / 8;
+  }
+  DeferredFunctionMetadata.clear();
+}
+
 MDString *MetadataLoader::MetadataLoaderImpl::lazyLoadOneMDString(unsigned ID) {
   ++NumMDStringLoaded;
   if (Metadata *MD = MetadataList.lookup(ID))
@@ -1855,14 +1911,30 @@ Error MetadataLoader::MetadataLoaderImpl::parseMetadataAttachment(
       if (Record.empty())
         return error("Invalid record");
       if (RecordLength % 2 == 0) {
-        // A function attachment.
-        if (Error Err = parseGlobalObjectAttachment(F, Record))
+        // A function attachment. The subprogram is not loaded when stripping
+        // debug info.
+        SmallVector<uint64_t, 4> Attachments;
+        for (unsigned i = 0; i != RecordLength; i += 2) {
+          auto K = MDKindMap.find(Record[i]);
+          if (StripDebugInfo && K != MDKindMap.end() &&
+              K->second == LLVMContext::MD_dbg)
+            continue;
+          if (Record[i + 1] >= MetadataList.size())
+            if (Error Err = loadDeferredFunctionMetadata())
+              return Err;
+          Attachments.push_back(Record[i]);
+          Attachments.push_back(Record[i + 1]);
+        }
+        if (Error Err = parseGlobalObjectAttachment(F, Attachments))
           return Err;
         continue;
       }
 
-      // An instruction attachment.
+      // An instruction attachment. Instructions that were not read, such as
+      // debug intrinsics when stripping debug info, drop their attachments.
       Instruction *Inst = InstructionList[Record[0]];
+      if (!Inst)
+        continue;
       for (unsigned i = 1; i != RecordLength; i = i + 2) {
         unsigned Kind = Record[i];
         DenseMap<unsigned, unsigned>::iterator I = MDKindMap.find(Kind);
@@ -1879,6 +1951,10 @@ Error MetadataLoader::MetadataLoaderImpl::parseMetadataAttachment(
           lazyLoadOneMetadata(Idx, Placeholders);
           resolveForwardRefsAndPlaceholders(Placeholders);
         }
+        // Load the function-level metadata if the attachment is part of it.
+        if (Idx >= MetadataList.size())
+          if (Error Err = loadDeferredFunctionMetadata())
+            return Err;
 
         Metadata *Node = MetadataList.getMetadataFwdRef(Idx);
         if (isa<LocalAsMetadata>(Node))
@@ -1976,6 +2052,18 @@ Error MetadataLoader::parseMetadata(bool ModuleLevel) {
   return Pimpl->parseMetadata(ModuleLevel);
 }
 
+Error MetadataLoader::deferFunctionMetadata() {
+  return Pimpl->deferFunctionMetadata();
+}
+
+Error MetadataLoader::loadDeferredFunctionMetadata() {
+  return Pimpl->loadDeferredFunctionMetadata();
+}
+
+void MetadataLoader::dropDeferredFunctionMetadata() {
+  Pimpl->dropDeferredFunctionMetadata();
+}
+
 bool MetadataLoader::hasFwdRefs() const { return Pimpl->hasFwdRefs(); }
 
 /// Return the given metadata, creating a replaceable forward reference if
@@ -2007,6 +2095,8 @@ void MetadataLoader::setStripTBAA(bool StripTBAA) {
 
 bool MetadataLoader::isStrippingTBAA() { return Pimpl->isStrippingTBAA(); }
 
+void MetadataLoader::setStripDebugInfo() { Pimpl->setStripDebugInfo(); }
+
 unsigned MetadataLoader::size() const { return Pimpl->size(); }
 void MetadataLoader::shrinkTo(unsigned N) { return Pimpl->shrinkTo(N); }
 
@@ -52,12 +52,26 @@ public:
   // Parse a function metadata block
   Error parseFunctionMetadata() { return parseMetadata(false); }
 
+  /// Skip a function metadata block, remembering its position so that it can
+  /// be parsed by loadDeferredFunctionMetadata if the function refers to it.
+  Error deferFunctionMetadata();
+
+  /// Parse the function metadata blocks skipped by deferFunctionMetadata.
+  Error loadDeferredFunctionMetadata();
+
+  /// Forget the function metadata blocks skipped by deferFunctionMetadata,
+  /// once the function has been parsed without needing them.
+  void dropDeferredFunctionMetadata();
+
   /// Set the mode to strip TBAA metadata on load.
   void setStripTBAA(bool StripTBAA = true);
 
   /// Return true if the Loader is stripping TBAA metadata.
   bool isStrippingTBAA();
 
+  /// Set the mode to drop debug info attachments of functions on load.
+  void setStripDebugInfo();
+
   // Return true there are remaining unresolved forward references.
   bool hasFwdRefs() const;
 
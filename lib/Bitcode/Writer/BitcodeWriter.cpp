@@ -51,6 +51,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/ModuleSlotTracker.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/Type.h"
@@ -69,6 +70,7 @@
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/raw_sha1_ostream.h"
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
@@ -255,6 +257,14 @@ class ModuleBitcodeWriter : public ModuleBitcodeWriterBase {
   /// The start bit of the identification block.
   uint64_t BitcodeStartBit;
 
+  /// If non-null, function blocks kept from the previous write of this module
+  /// are copied, and the blocks written now are kept for the next one.
+  BitcodeIncrementalState *Incremental;
+
+  /// Slot tracker used to compute the default keys of functions for
+  /// Incremental, created on first use.
+  std::unique_ptr<ModuleSlotTracker> KeyMST;
+
 public:
   /// Constructs a ModuleBitcodeWriter object for the given Module,
   /// writing to the provided \p Buffer.
@@ -262,11 +272,12 @@ public:
                       StringTableBuilder &StrtabBuilder,
                       BitstreamWriter &Stream, bool ShouldPreserveUseListOrder,
                       const ModuleSummaryIndex *Index, bool GenerateHash,
-                      ModuleHash *ModHash = nullptr)
+                      ModuleHash *ModHash = nullptr,
+                      BitcodeIncrementalState *Incremental = nullptr)
       : ModuleBitcodeWriterBase(M, StrtabBuilder, Stream,
                                 ShouldPreserveUseListOrder, Index),
         Buffer(Buffer), GenerateHash(GenerateHash), ModHash(ModHash),
-        BitcodeStartBit(Stream.GetCurrentBitNo()) {}
+        BitcodeStartBit(Stream.GetCurrentBitNo()), Incremental(Incremental) {}
 
   /// Emit the current module to the bitstream.
   void write();
@@ -383,7 +394,9 @@ private:
   void writeUseListBlock(const Function *F);
   void
   writeFunction(const Function &F,
-                DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex);
+                DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex,
+                bool UseIncremental);
+  std::string getFunctionKey(const Function &F);
   void writeBlockInfo();
   void writeModuleHash(size_t BlockStartPos);
 
@@ -3028,15 +3041,46 @@ void ModuleBitcodeWriter::writeUseListBlock(const Function *F) {
   Stream.ExitBlock();
 }
 
+/// Compute the key under which the incremental state caches F's block.
+std::string ModuleBitcodeWriter::getFunctionKey(const Function &F) {
+  if (Incremental->getKeyFn())
+    return Incremental->getKeyFn()(F);
+
+  // Hash the textual IR. Local slots are numbered per function, but global
+  // ones (e.g. metadata) are module-wide, so share one tracker between all
+  // functions.
+  if (!KeyMST)
+    KeyMST = llvm::make_unique<ModuleSlotTracker>(&M);
+  raw_sha1_ostream OS;
+  static_cast<const Value &>(F).print(OS, *KeyMST);
+  return OS.sha1();
+}
+
 /// Emit a function body to the module stream.
 void ModuleBitcodeWriter::writeFunction(
     const Function &F,
-    DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex) {
+    DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex,
+    bool UseIncremental) {
   // Save the bitcode index of the start of this function block for recording
   // in the VST.
   FunctionToBitcodeIndex[&F] = Stream.GetCurrentBitNo();
 
+  // Copy the block written for this function last time if it is unchanged.
+  // Unnamed functions can not be matched up between writes.
+  std::string Key;
+  UseIncremental &= F.hasName();
+  if (UseIncremental) {
+    Key = getFunctionKey(F);
+    StringRef Kept = Incremental->lookup(F.getName(), Key);
+    if (!Kept.empty()) {
+      Stream.EmitEncodedBlock(bitc::FUNCTION_BLOCK_ID, 4,
+                              makeArrayRef(Kept.data(), Kept.size()));
+      return;
+    }
+  }
+
   Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+  size_t ContentsStart = Buffer.size();
   VE.incorporateFunction(F);
 
   SmallVector<unsigned, 64> Vals;
@@ -3104,6 +3148,11 @@ void ModuleBitcodeWriter::writeFunction(
     writeUseListBlock(&F);
   VE.purgeFunction();
   Stream.ExitBlock();
+
+  if (UseIncremental)
+    Incremental->insert(F.getName(), std::move(Key),
+                        StringRef(Buffer.data() + ContentsStart,
+                                  Buffer.size() - ContentsStart));
 }
 
 // Emit blockinfo, which defines the standard abbreviations etc.
@@ -3958,11 +4007,35 @@ void ModuleBitcodeWriter::write() {
   writeOperandBundleTags();
   writeSyncScopeNames();
 
+  // Function blocks refer to types, attributes, globals, constants and
+  // metadata by number, so blocks kept from the last write can only be
+  // copied if everything written so far is unchanged. That is checked by
+  // hashing it, which needs the stream to be at a word boundary. In practice
+  // it is, since every context has sync scope names and their block ends
+  // aligned.
+  bool UseIncremental = false;
+  if (Incremental) {
+    std::string ContextHash;
+    if (!VE.shouldPreserveUseListOrder() &&
+        Stream.GetCurrentBitNo() % 32 == 0) {
+      SHA1 ContextHasher;
+      ContextHasher.update(ArrayRef<uint8_t>(
+          reinterpret_cast<const uint8_t *>(Buffer.data()) + BlockStartPos,
+          Buffer.size() - BlockStartPos));
+      ContextHash = ContextHasher.result();
+      UseIncremental = true;
+    }
+    Incremental->beginModule(ContextHash);
+  }
+
   // Emit function bodies.
   DenseMap<const Function *, uint64_t> FunctionToBitcodeIndex;
   for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F)
     if (!F->isDeclaration())
-      writeFunction(*F, FunctionToBitcodeIndex);
+      writeFunction(*F, FunctionToBitcodeIndex, UseIncremental);
+
+  if (Incremental)
+    Incremental->endModule();
 
   // Need to write after the above call to WriteFunction which populates
   // the summary information in the index.
@@ -4052,6 +4125,46 @@ static void writeBitcodeHeader(BitstreamWriter &Stream) {
   Stream.Emit(0xD, 4);
 }
 
+void BitcodeIncrementalState::clear() {
+  ContextHash.clear();
+  Functions.clear();
+}
+
+void BitcodeIncrementalState::beginModule(StringRef NewContextHash) {
+  if (NewContextHash.empty() || NewContextHash != ContextHash)
+    Functions.clear();
+  ContextHash = NewContextHash;
+  for (auto &KV : Functions)
+    KV.second.Written = false;
+  NumReused = NumEncoded = 0;
+}
+
+void BitcodeIncrementalState::endModule() {
+  for (auto I = Functions.begin(), E = Functions.end(); I != E;) {
+    auto Cur = I++;
+    if (!Cur->second.Written)
+      Functions.erase(Cur);
+  }
+}
+
+StringRef BitcodeIncrementalState::lookup(StringRef Name, StringRef Key) {
+  auto I = Functions.find(Name);
+  if (I == Functions.end() || I->second.Key != Key)
+    return StringRef();
+  I->second.Written = true;
+  ++NumReused;
+  return I->second.Contents;
+}
+
+void BitcodeIncrementalState::insert(StringRef Name, std::string Key,
+                                     StringRef Contents) {
+  Entry &E = Functions[Name];
+  E.Key = std::move(Key);
+  E.Contents = Contents;
+  E.Written = true;
+  ++NumEncoded;
+}
+
 BitcodeWriter::BitcodeWriter(SmallVectorImpl<char> &Buffer)
     : Buffer(Buffer), Stream(new BitstreamWriter(Buffer)) {
   writeBitcodeHeader(*Stream);
@@ -4126,7 +4239,8 @@ void BitcodeWriter::copyStrtab(StringRef Strtab) {
 void BitcodeWriter::writeModule(const Module &M,
                                 bool ShouldPreserveUseListOrder,
                                 const ModuleSummaryIndex *Index,
-                                bool GenerateHash, ModuleHash *ModHash) {
+                                bool GenerateHash, ModuleHash *ModHash,
+                                BitcodeIncrementalState *Incremental) {
   assert(!WroteStrtab);
 
   // The Mods vector is used by irsymtab::build, which requires non-const
@@ -4138,7 +4252,7 @@ void BitcodeWriter::writeModule(const Module &M,
 
   ModuleBitcodeWriter ModuleWriter(M, Buffer, StrtabBuilder, *Stream,
                                    ShouldPreserveUseListOrder, Index,
-                                   GenerateHash, ModHash);
+                                   GenerateHash, ModHash, Incremental);
   ModuleWriter.write();
 }
 
@@ -4154,7 +4268,8 @@ void BitcodeWriter::writeIndex(
 void llvm::WriteBitcodeToFile(const Module &M, raw_ostream &Out,
                               bool ShouldPreserveUseListOrder,
                               const ModuleSummaryIndex *Index,
-                              bool GenerateHash, ModuleHash *ModHash) {
+                              bool GenerateHash, ModuleHash *ModHash,
+                              BitcodeIncrementalState *Incremental) {
   SmallVector<char, 0> Buffer;
   Buffer.reserve(256*1024);
 
@@ -4166,7 +4281,7 @@ void llvm::WriteBitcodeToFile(const Module &M, raw_ostream &Out,
 
   BitcodeWriter Writer(Buffer);
   Writer.writeModule(M, ShouldPreserveUseListOrder, Index, GenerateHash,
-                     ModHash);
+                     ModHash, Incremental);
   Writer.writeSymtab();
   Writer.writeStrtab();
 
@@ -105,6 +105,7 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetLoweringObjectFile.h"
@@ -242,6 +243,8 @@ void AsmPrinter::getAnalysisUsage(AnalysisUsage &AU) const {
 }
 
 bool AsmPrinter::doInitialization(Module &M) {
+  TimeTraceScope TraceScope("AsmPrinter Initialization",
+                            M.getModuleIdentifier());
   MMI = getAnalysisIfAvailable<MachineModuleInfo>();
 
   // Initialize TargetLoweringObjectFile.
@@ -1340,6 +1343,7 @@ void AsmPrinter::emitGlobalIndirectSymbol(Module &M,
 }
 
 bool AsmPrinter::doFinalization(Module &M) {
+  TimeTraceScope TraceScope("AsmPrinter Finalization", M.getModuleIdentifier());
   // Set the MachineFunction to nullptr so that we can catch attempted
   // accesses to MF specific features at the module level and so that
   // we can conditionalize accesses based on whether or not it is nullptr.
@@ -17,7 +17,10 @@
 #include "llvm/CodeGen/MachineModuleInfo.h"
 #include "llvm/CodeGen/Passes.h"
 #include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/DiagnosticHandler.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
 #include "llvm/MC/MCAsmBackend.h"
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCCodeEmitter.h"
@@ -112,7 +115,10 @@ addPassesToGenerateCode(LLVMTargetMachine *TM, PassManagerBase &PM,
 
   if (PassConfig->addISelPasses())
     return nullptr;
-  PassConfig->addMachinePasses();
+  if (PassConfig->canRunMachinePassesConcurrently())
+    PM.add(createParallelMachinePassesPass(DisableVerify));
+  else
+    PassConfig->addMachinePasses();
   PassConfig->setInitialized();
   if (!WillCompleteCodeGenPipeline)
     PM.add(createPrintMIRPass(Out));
@@ -120,6 +126,20 @@ addPassesToGenerateCode(LLVMTargetMachine *TM, PassManagerBase &PM,
   return &MMI->getContext();
 }
 
+bool LLVMTargetMachine::canRunMachineFunctionPassesConcurrently(
+    const Module &M) const {
+  if (M.debug_compile_units_begin() != M.debug_compile_units_end() ||
+      M.getFunction("llvm.codeview.annotation"))
+    return false;
+  // Optimization remarks go to a single stream.
+  if (M.getContext().getDiagHandlerPtr()->isAnyRemarkEnabled())
+    return false;
+  for (const Function &F : M)
+    if (F.hasPersonalityFn() || F.hasGC())
+      return false;
+  return true;
+}
+
 bool LLVMTargetMachine::addAsmPrinter(PassManagerBase &PM,
                                       raw_pwrite_stream &Out,
                                       raw_pwrite_stream *DwoOut,
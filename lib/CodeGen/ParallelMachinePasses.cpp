@@ -0,0 +1,185 @@
+//===- ParallelMachinePasses.cpp - Machine passes on worker threads -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file implements a module pass that stands in for the machine function
+/// passes of the codegen pipeline. It runs them over the functions of the
+/// module on worker threads, each thread with its own copy of the passes added
+/// by TargetPassConfig::addMachinePasses(). Instruction selection before it and
+/// the AsmPrinter after it still handle one function at a time in module
+/// order, so the emitted code does not depend on the number of threads.
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/ScopedNoAliasAA.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/TypeBasedAliasAnalysis.h"
+#include "llvm/CodeGen/GCMetadata.h"
+#include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/CodeGen/TargetPassConfig.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/TypeFinder.h"
+#include "llvm/PassInfo.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+#include <atomic>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "parallel-machine-passes"
+
+STATISTIC(NumPipelines, "Number of machine function pass pipelines built");
+STATISTIC(NumConcurrentFunctions,
+          "Number of functions compiled on worker threads");
+
+namespace {
+
+class ParallelMachinePasses : public ModulePass {
+  bool DisableVerify;
+
+public:
+  static char ID;
+
+  explicit ParallelMachinePasses(bool DisableVerify = false)
+      : ModulePass(ID), DisableVerify(DisableVerify) {}
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<MachineModuleInfo>();
+    AU.addRequired<TargetPassConfig>();
+    AU.addRequired<AssumptionCacheTracker>();
+    AU.setPreservesAll();
+  }
+
+  bool runOnModule(Module &M) override;
+
+  StringRef getPassName() const override {
+    return "Parallel Machine Function Passes";
+  }
+
+private:
+  std::unique_ptr<legacy::FunctionPassManager>
+  createPipeline(Module &M, LLVMTargetMachine &TM);
+};
+
+} // end anonymous namespace
+
+char ParallelMachinePasses::ID;
+
+ModulePass *llvm::createParallelMachinePassesPass(bool DisableVerify) {
+  return new ParallelMachinePasses(DisableVerify);
+}
+
+/// Module-wide analyses the pipelines share with the codegen pass manager.
+/// None of them change once the module reached the machine passes. The
+/// TargetTransformInfo wrapper is not among them: it keeps the result of the
+/// last query around, and no machine pass uses it.
+static const AnalysisID SharedAnalyses[] = {
+    &MachineModuleInfo::ID,      &TargetLibraryInfoWrapperPass::ID,
+    &AssumptionCacheTracker::ID, &TypeBasedAAWrapperPass::ID,
+    &ScopedNoAliasAAWrapperPass::ID, &GCModuleInfo::ID};
+
+std::unique_ptr<legacy::FunctionPassManager>
+ParallelMachinePasses::createPipeline(Module &M, LLVMTargetMachine &TM) {
+  auto Pipeline = llvm::make_unique<legacy::FunctionPassManager>(&M);
+  for (AnalysisID ID : SharedAnalyses)
+    if (Pass *P = getResolver()->getAnalysisIfAvailable(ID, true))
+      Pipeline->addSharedImmutablePass(P->getAsImmutablePass());
+  // The external AA wrapper, which targets add to the codegen pass manager, is
+  // only known by its pass name.
+  if (const PassInfo *PI =
+          PassRegistry::getPassRegistry()->getPassInfo("external-aa"))
+    if (Pass *P = getResolver()->getAnalysisIfAvailable(PI->getTypeInfo(), true))
+      Pipeline->addSharedImmutablePass(P->getAsImmutablePass());
+
+  TargetPassConfig *PassConfig = TM.createPassConfig(*Pipeline);
+  PassConfig->setDisableVerify(DisableVerify);
+  Pipeline->add(PassConfig);
+  PassConfig->addMachinePasses();
+  PassConfig->setInitialized();
+
+  Pipeline->doInitialization();
+  ++NumPipelines;
+  return Pipeline;
+}
+
+/// Fill in the module-wide caches that the passes would otherwise populate on
+/// first use, so that the worker threads only ever read them.
+static void prepareSharedState(Module &M, AssumptionCacheTracker &ACT) {
+  const DataLayout &DL = M.getDataLayout();
+  TypeFinder StructTypes;
+  StructTypes.run(M, /*onlyNamed=*/false);
+  for (StructType *STy : StructTypes)
+    if (STy->isSized())
+      DL.getStructLayout(STy);
+
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      ACT.getAssumptionCache(F).assumptions();
+}
+
+bool ParallelMachinePasses::runOnModule(Module &M) {
+  MachineModuleInfo &MMI = getAnalysis<MachineModuleInfo>();
+  auto &TM = getAnalysis<TargetPassConfig>().getTM<LLVMTargetMachine>();
+
+  // Only the functions that went through instruction selection have machine
+  // code to run the passes on.
+  std::vector<Function *> Functions;
+  for (Function &F : M)
+    if (MMI.getMachineFunction(F))
+      Functions.push_back(&F);
+
+  unsigned NumThreads = std::min<size_t>(TM.Options.MachineFunctionThreads,
+                                         Functions.size());
+  if (NumThreads > 1 && !TM.canRunMachineFunctionPassesConcurrently(M))
+    NumThreads = 1;
+
+  std::vector<std::unique_ptr<legacy::FunctionPassManager>> Pipelines;
+  Pipelines.push_back(createPipeline(M, TM));
+  if (NumThreads <= 1) {
+    for (Function *F : Functions)
+      Pipelines.front()->run(*F);
+  } else {
+    prepareSharedState(M, getAnalysis<AssumptionCacheTracker>());
+    while (Pipelines.size() != NumThreads)
+      Pipelines.push_back(createPipeline(M, TM));
+
+    // Each thread owns one pipeline and takes the next function to compile
+    // until there are none left.
+    std::atomic<size_t> NextFunction(0);
+    ThreadPool Pool(NumThreads);
+    for (auto &Pipeline : Pipelines) {
+      legacy::FunctionPassManager *FPM = Pipeline.get();
+      Pool.async([&Functions, &NextFunction, FPM] {
+        for (size_t I = NextFunction++; I < Functions.size();
+             I = NextFunction++) {
+          FPM->run(*Functions[I]);
+          ++NumConcurrentFunctions;
+        }
+      });
+    }
+    Pool.wait();
+  }
+
+  // Machine passes may add functions with machine code of their own to the
+  // module, like the X86 retpoline thunks. Compile them now, in module order.
+  SmallPtrSet<Function *, 32> Compiled(Functions.begin(), Functions.end());
+  for (Function &F : M)
+    if (!Compiled.count(&F) && MMI.getMachineFunction(F))
+      Pipelines.front()->run(F);
+
+  for (auto &Pipeline : Pipelines)
+    Pipeline->doFinalization();
+  return true;
+}
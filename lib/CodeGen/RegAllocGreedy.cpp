@@ -85,6 +85,8 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumBudgetFallbacks,
+          "Number of times the work budget forced a cheaper strategy");
 
 static cl::opt<SplitEditor::ComplementSpillMode> SplitSpillMode(
     "split-spill-mode", cl::Hidden,
@@ -137,6 +139,13 @@ static cl::opt<bool> ConsiderLocalIntervalCost(
              "candidate when choosing the best split candidate."),
     cl::init(false));
 
+static cl::opt<unsigned> WorkBudget(
+    "regalloc-work-budget", cl::Hidden,
+    cl::desc("Amount of allocation work (interference checks and split "
+             "attempts) spent on a function before falling back to cheaper "
+             "strategies, 0 for no limit"),
+    cl::init(0));
+
 static RegisterRegAlloc greedyRegAlloc("greedy", "greedy register allocator",
                                        createGreedyRegisterAllocator);
 
@@ -231,6 +240,31 @@ class RAGreedy : public MachineFunctionPass,
 
   uint8_t CutOffInfo;
 
+  // Strategies the allocator gives up, one at a time, each time the work
+  // budget for the function (-regalloc-work-budget) runs out. Huge functions
+  // can otherwise take minutes in splitting and eviction.
+  enum BudgetStage {
+    /// Every strategy is available.
+    BS_Full,
+
+    /// Region splitting, which drives SpillPlacement, is disabled.
+    BS_NoRegionSplit,
+
+    /// All live range splitting is disabled; ranges that cannot be assigned
+    /// or evict are spilled.
+    BS_NoSplit,
+
+    /// Only spill products and unspillable ranges may evict. Everything else
+    /// is assigned a free register or spilled.
+    BS_NoEvict
+  };
+
+  BudgetStage Budget;
+
+  // Allocation work done on the current function, in the units of
+  // -regalloc-work-budget.
+  uint64_t Work;
+
 #ifndef NDEBUG
   static const char *const StageName[];
 #endif
@@ -530,6 +564,10 @@ private:
 
   bool isUnusedCalleeSavedReg(unsigned PhysReg) const;
 
+  /// Account for \p Units of allocation work, and move to the next budget
+  /// stage if the budget for the current one ran out.
+  void chargeWork(uint64_t Units);
+
   /// Compute and report the number of spills and reloads for a loop.
   void reportNumberOfSplillsReloads(MachineLoop *L, unsigned &Reloads,
                                     unsigned &FoldedReloads, unsigned &Spills,
@@ -860,6 +898,8 @@ bool RAGreedy::shouldEvict(LiveInterval &A, bool IsHint,
 /// @returns True when interference can be evicted cheaper than MaxCost.
 bool RAGreedy::canEvictInterference(LiveInterval &VirtReg, unsigned PhysReg,
                                     bool IsHint, EvictionCost &MaxCost) {
+  chargeWork(1);
+
   // It is only possible to evict virtual register interference.
   if (Matrix->checkInterference(VirtReg, PhysReg) > LiveRegMatrix::IK_VirtReg)
     return false;
@@ -881,7 +921,9 @@ bool RAGreedy::canEvictInterference(LiveInterval &VirtReg, unsigned PhysReg,
   for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
     LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
     // If there is 10 or more interferences, chances are one is heavier.
-    if (Q.collectInterferingVRegs(10) >= 10)
+    unsigned NumIntf = Q.collectInterferingVRegs(10);
+    chargeWork(NumIntf);
+    if (NumIntf >= 10)
       return false;
 
     // Check if any interfering live range is heavier than MaxWeight.
@@ -1080,6 +1122,39 @@ bool RAGreedy::isUnusedCalleeSavedReg(unsigned PhysReg) const {
   return !Matrix->isPhysRegUsed(PhysReg);
 }
 
+void RAGreedy::chargeWork(uint64_t Units) {
+  Work += Units;
+  if (!WorkBudget || Budget == BS_NoEvict ||
+      Work < uint64_t(WorkBudget) * (Budget + 1))
+    return;
+
+  Budget = static_cast<BudgetStage>(Budget + 1);
+  ++NumBudgetFallbacks;
+  LLVM_DEBUG(dbgs() << "Work budget exhausted after " << Work
+                    << " units, budget stage " << Budget << '\n');
+
+  using namespace ore;
+  ORE->emit([&]() {
+    MachineOptimizationRemarkAnalysis R(DEBUG_TYPE, "WorkBudgetExhausted",
+                                        MF->getFunction().getSubprogram(),
+                                        &MF->front());
+    R << "register allocation work budget exhausted after "
+      << NV("Work", Work) << " units, ";
+    switch (Budget) {
+    case BS_NoRegionSplit:
+      R << NV("Fallback", StringRef("disabling region splitting"));
+      break;
+    case BS_NoSplit:
+      R << NV("Fallback", StringRef("disabling live range splitting"));
+      break;
+    default:
+      R << NV("Fallback", StringRef("disabling eviction"));
+      break;
+    }
+    return R;
+  });
+}
+
 /// tryEvict - Try to evict all interferences for a physreg.
 /// @param  VirtReg Currently unassigned virtual register.
 /// @param  Order   Physregs to try.
@@ -1848,6 +1923,7 @@ unsigned RAGreedy::calculateRegionSplitCost(LiveInterval &VirtReg,
     GlobalSplitCandidate &Cand = GlobalCand[NumCands];
     Cand.reset(IntfCache, PhysReg);
 
+    chargeWork(1 + SA->getUseBlocks().size() + SA->getNumThroughBlocks());
     SpillPlacer->prepare(Cand.LiveBundles);
     BlockFrequency Cost;
     if (!addSplitConstraints(Cand.Intf, Cost)) {
@@ -1964,6 +2040,7 @@ unsigned RAGreedy::tryBlockSplit(LiveInterval &VirtReg, AllocationOrder &Order,
   LiveRangeEdit LREdit(&VirtReg, NewVRegs, *MF, *LIS, VRM, this, &DeadRemats);
   SE->reset(LREdit, SplitSpillMode);
   ArrayRef<SplitAnalysis::BlockInfo> UseBlocks = SA->getUseBlocks();
+  chargeWork(UseBlocks.size());
   for (unsigned i = 0; i != UseBlocks.size(); ++i) {
     const SplitAnalysis::BlockInfo &BI = UseBlocks[i];
     if (SA->shouldSplitSingleBlock(BI, SingleInstrs))
@@ -2041,6 +2118,7 @@ RAGreedy::tryInstructionSplit(LiveInterval &VirtReg, AllocationOrder &Order,
 
   LLVM_DEBUG(dbgs() << "Split around " << Uses.size()
                     << " individual instrs.\n");
+  chargeWork(Uses.size());
 
   const TargetRegisterClass *SuperRC =
       TRI->getLargestLegalSuperClass(CurRC, *MF);
@@ -2094,6 +2172,7 @@ void RAGreedy::calcGapWeights(unsigned PhysReg,
   const SplitAnalysis::BlockInfo &BI = SA->getUseBlocks().front();
   ArrayRef<SlotIndex> Uses = SA->getUseSlots();
   const unsigned NumGaps = Uses.size()-1;
+  chargeWork(Uses.size());
 
   // Start and end points for the interference check.
   SlotIndex StartIdx =
@@ -2399,6 +2478,10 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
   if (getStage(VirtReg) >= RS_Spill)
     return 0;
 
+  // Splitting is the first thing to go when the work budget runs out.
+  if (Budget >= BS_NoSplit)
+    return 0;
+
   // Local intervals are handled separately.
   if (LIS->intervalIsInOneMBB(VirtReg)) {
     NamedRegionTimer T("local_split", "Local Splitting", TimerGroupName,
@@ -2429,7 +2512,7 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
   // First try to split around a region spanning multiple blocks. RS_Split2
   // ranges already made dubious progress with region splitting, so they go
   // straight to single block splitting.
-  if (getStage(VirtReg) < RS_Split2) {
+  if (getStage(VirtReg) < RS_Split2 && Budget < BS_NoRegionSplit) {
     unsigned PhysReg = tryRegionSplit(VirtReg, Order, NewVRegs);
     if (PhysReg || !NewVRegs.empty())
       return PhysReg;
@@ -2588,6 +2671,7 @@ unsigned RAGreedy::tryLastChanceRecoloring(LiveInterval &VirtReg,
       LLVM_DEBUG(dbgs() << "Some interferences cannot be recolored.\n");
       continue;
     }
+    chargeWork(1 + RecoloringCandidates.size());
 
     // RecoloringCandidates contains all the virtual registers that interfer
     // with VirtReg on PhysReg (or one of its aliases).
@@ -2751,7 +2835,7 @@ unsigned RAGreedy::tryAssignCSRFirstTime(LiveInterval &VirtReg,
     CostPerUseLimit = 1;
     return 0;
   }
-  if (getStage(VirtReg) < RS_Split) {
+  if (getStage(VirtReg) < RS_Split && Budget < BS_NoRegionSplit) {
     // We choose pre-splitting over using the CSR for the first time if
     // the cost of splitting is lower than CSRCost.
     SA->analyze(&VirtReg);
@@ -2996,8 +3080,10 @@ unsigned RAGreedy::selectOrSplitImpl(LiveInterval &VirtReg,
 
   // Try to evict a less worthy live range, but only for ranges from the primary
   // queue. The RS_Split ranges already failed to do this, and they should not
-  // get a second chance until they have been split.
-  if (Stage != RS_Split)
+  // get a second chance until they have been split. Once the work budget is
+  // spent, only ranges that cannot be spilled (any more) get to evict.
+  if (Stage != RS_Split &&
+      (Budget < BS_NoEvict || Stage >= RS_Done || !VirtReg.isSpillable()))
     if (unsigned PhysReg =
             tryEvict(VirtReg, Order, NewVRegs, CostPerUseLimit)) {
       unsigned Hint = MRI->getSimpleHint(VirtReg.reg);
@@ -3183,6 +3269,8 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   GlobalCand.resize(32);  // This will grow as needed.
   SetOfBrokenHints.clear();
   LastEvicted.clear();
+  Budget = BS_Full;
+  Work = 0;
 
   allocatePhysRegs();
   tryHintsRecoloring();
@@ -0,0 +1,347 @@
+//===-- RegAllocLinearScan.cpp - Linear Scan Register Allocator -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the RALinearScan function pass, a global register
+// allocator that visits live intervals in order of their start point, in the
+// spirit of Poletto and Sarkar's linear scan. It is meant for JITs and other
+// clients that need much better code than the fast allocator gives, at a
+// fraction of the compile time of the greedy allocator.
+//
+//===----------------------------------------------------------------------===//
+
+#include "AllocationOrder.h"
+#include "LiveDebugVariables.h"
+#include "RegAllocBase.h"
+#include "Spiller.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/CodeGen/CalcSpillWeights.h"
+#include "llvm/CodeGen/LiveIntervals.h"
+#include "llvm/CodeGen/LiveRangeEdit.h"
+#include "llvm/CodeGen/LiveRegMatrix.h"
+#include "llvm/CodeGen/LiveStacks.h"
+#include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/CodeGen/RegAllocRegistry.h"
+#include "llvm/CodeGen/SlotIndexes.h"
+#include "llvm/CodeGen/TargetRegisterInfo.h"
+#include "llvm/CodeGen/VirtRegMap.h"
+#include "llvm/PassAnalysisSupport.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <queue>
+#include <utility>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "regalloc"
+
+STATISTIC(NumLinearScanEvictions, "Number of live ranges evicted");
+STATISTIC(NumLinearScanEvictSpills, "Number of evicted live ranges spilled");
+
+static RegisterRegAlloc linearScanRegAlloc("linearscan",
+                                           "linear scan register allocator",
+                                           createLinearScanRegisterAllocator);
+
+namespace {
+
+/// RALinearScan assigns live intervals to physical registers in order of their
+/// start point, so an interval is considered once the intervals that start
+/// before it have been allocated, as in classic linear scan. The intervals that
+/// are "active" at that point are exactly the ones LiveRegMatrix reports as
+/// interfering.
+///
+/// When no register is free, the allocator compares the spill weight of the
+/// current interval with that of the intervals occupying each register. It
+/// evicts the cheapest set of interferences if they are all lighter than the
+/// current interval, and spills the current interval otherwise. An evicted
+/// interval is requeued the first time, as it may fit in another register, and
+/// spilled the second time. There is no live range splitting apart from what
+/// the spiller does, so each interval is visited a bounded number of times and
+/// allocation takes time close to linear in the number of intervals.
+class RALinearScan : public MachineFunctionPass,
+                     public RegAllocBase,
+                     private LiveRangeEdit::Delegate {
+  // context
+  MachineFunction *MF;
+  SlotIndexes *Indexes;
+
+  // state
+  std::unique_ptr<Spiller> SpillerInstance;
+
+  // Queue of (~start, ~reg), so the interval starting first is on top. The
+  // start point is recorded when the interval is enqueued, as it may change
+  // while it waits.
+  std::priority_queue<std::pair<unsigned, unsigned>> Queue;
+
+  // Virtual registers that have been evicted once already.
+  DenseSet<unsigned> Evicted;
+
+  bool LRE_CanEraseVirtReg(unsigned) override;
+  void LRE_WillShrinkVirtReg(unsigned) override;
+
+  /// Returns true if all interference between VirtReg and PhysReg can be
+  /// evicted, and sets MaxWeight to the largest spill weight involved.
+  bool canEvictInterference(LiveInterval &VirtReg, unsigned PhysReg,
+                            float &MaxWeight);
+
+  /// Unassign all intervals interfering with VirtReg in PhysReg, and requeue
+  /// or spill them.
+  void evictInterference(LiveInterval &VirtReg, unsigned PhysReg,
+                         SmallVectorImpl<unsigned> &SplitVRegs);
+
+public:
+  RALinearScan();
+
+  /// Return the pass name.
+  StringRef getPassName() const override {
+    return "Linear Scan Register Allocator";
+  }
+
+  /// RALinearScan analysis usage.
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+
+  void releaseMemory() override;
+
+  Spiller &spiller() override { return *SpillerInstance; }
+
+  void enqueue(LiveInterval *LI) override;
+  LiveInterval *dequeue() override;
+
+  unsigned selectOrSplit(LiveInterval &VirtReg,
+                         SmallVectorImpl<unsigned> &SplitVRegs) override;
+
+  /// Perform register allocation.
+  bool runOnMachineFunction(MachineFunction &mf) override;
+
+  MachineFunctionProperties getRequiredProperties() const override {
+    return MachineFunctionProperties().set(
+        MachineFunctionProperties::Property::NoPHIs);
+  }
+
+  static char ID;
+};
+
+char RALinearScan::ID = 0;
+
+} // end anonymous namespace
+
+char &llvm::RALinearScanID = RALinearScan::ID;
+
+INITIALIZE_PASS_BEGIN(RALinearScan, "regalloclinearscan",
+                      "Linear Scan Register Allocator", false, false)
+INITIALIZE_PASS_DEPENDENCY(LiveDebugVariables)
+INITIALIZE_PASS_DEPENDENCY(SlotIndexes)
+INITIALIZE_PASS_DEPENDENCY(LiveIntervals)
+INITIALIZE_PASS_DEPENDENCY(RegisterCoalescer)
+INITIALIZE_PASS_DEPENDENCY(MachineScheduler)
+INITIALIZE_PASS_DEPENDENCY(LiveStacks)
+INITIALIZE_PASS_DEPENDENCY(MachineDominatorTree)
+INITIALIZE_PASS_DEPENDENCY(MachineLoopInfo)
+INITIALIZE_PASS_DEPENDENCY(VirtRegMap)
+INITIALIZE_PASS_DEPENDENCY(LiveRegMatrix)
+INITIALIZE_PASS_END(RALinearScan, "regalloclinearscan",
+                    "Linear Scan Register Allocator", false, false)
+
+bool RALinearScan::LRE_CanEraseVirtReg(unsigned VirtReg) {
+  LiveInterval &LI = LIS->getInterval(VirtReg);
+  if (VRM->hasPhys(VirtReg)) {
+    Matrix->unassign(LI);
+    aboutToRemoveInterval(LI);
+    return true;
+  }
+  // Unassigned virtreg is probably in the priority queue.
+  // RegAllocBase will erase it after dequeueing.
+  // Nonetheless, clear the live-range so that the debug
+  // dump will show the right state for that VirtReg.
+  LI.clear();
+  return false;
+}
+
+void RALinearScan::LRE_WillShrinkVirtReg(unsigned VirtReg) {
+  if (!VRM->hasPhys(VirtReg))
+    return;
+
+  // Register is assigned, put it back on the queue for reassignment.
+  LiveInterval &LI = LIS->getInterval(VirtReg);
+  Matrix->unassign(LI);
+  enqueue(&LI);
+}
+
+RALinearScan::RALinearScan() : MachineFunctionPass(ID) {}
+
+void RALinearScan::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesCFG();
+  AU.addRequired<AAResultsWrapperPass>();
+  AU.addPreserved<AAResultsWrapperPass>();
+  AU.addRequired<LiveIntervals>();
+  AU.addPreserved<LiveIntervals>();
+  AU.addRequired<SlotIndexes>();
+  AU.addPreserved<SlotIndexes>();
+  AU.addRequired<LiveDebugVariables>();
+  AU.addPreserved<LiveDebugVariables>();
+  AU.addRequired<LiveStacks>();
+  AU.addPreserved<LiveStacks>();
+  AU.addRequired<MachineBlockFrequencyInfo>();
+  AU.addPreserved<MachineBlockFrequencyInfo>();
+  AU.addRequiredID(MachineDominatorsID);
+  AU.addPreservedID(MachineDominatorsID);
+  AU.addRequired<MachineLoopInfo>();
+  AU.addPreserved<MachineLoopInfo>();
+  AU.addRequired<VirtRegMap>();
+  AU.addPreserved<VirtRegMap>();
+  AU.addRequired<LiveRegMatrix>();
+  AU.addPreserved<LiveRegMatrix>();
+  MachineFunctionPass::getAnalysisUsage(AU);
+}
+
+void RALinearScan::releaseMemory() {
+  SpillerInstance.reset();
+  Evicted.clear();
+}
+
+void RALinearScan::enqueue(LiveInterval *LI) {
+  unsigned Start =
+      LI->empty() ? 0 : Indexes->getZeroIndex().distance(LI->beginIndex());
+  Queue.push(std::make_pair(~Start, ~LI->reg));
+}
+
+LiveInterval *RALinearScan::dequeue() {
+  if (Queue.empty())
+    return nullptr;
+  LiveInterval *LI = &LIS->getInterval(~Queue.top().second);
+  Queue.pop();
+  return LI;
+}
+
+bool RALinearScan::canEvictInterference(LiveInterval &VirtReg,
+                                        unsigned PhysReg, float &MaxWeight) {
+  MaxWeight = 0;
+  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
+    LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
+    Q.collectInterferingVRegs();
+    for (LiveInterval *Intf : Q.interferingVRegs()) {
+      // Spill products cannot be spilled again, and only intervals strictly
+      // lighter than VirtReg are worth evicting.
+      if (!Intf->isSpillable() || Intf->weight >= VirtReg.weight)
+        return false;
+      MaxWeight = std::max(MaxWeight, Intf->weight);
+    }
+  }
+  return true;
+}
+
+void RALinearScan::evictInterference(LiveInterval &VirtReg, unsigned PhysReg,
+                                     SmallVectorImpl<unsigned> &SplitVRegs) {
+  // Collect the interference first; the queries are invalidated as soon as
+  // the matrix changes.
+  SmallVector<LiveInterval *, 8> Intfs;
+  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
+    LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
+    Q.collectInterferingVRegs();
+    Intfs.append(Q.interferingVRegs().begin(), Q.interferingVRegs().end());
+  }
+
+  for (LiveInterval *Intf : Intfs) {
+    // The same interval may interfere in several register units.
+    if (!VRM->hasPhys(Intf->reg))
+      continue;
+    LLVM_DEBUG(dbgs() << "evicting " << *Intf << '\n');
+    Matrix->unassign(*Intf);
+    ++NumLinearScanEvictions;
+    if (Evicted.insert(Intf->reg).second) {
+      SplitVRegs.push_back(Intf->reg);
+      continue;
+    }
+    LiveRangeEdit LRE(Intf, SplitVRegs, *MF, *LIS, VRM, this, &DeadRemats);
+    spiller().spill(LRE);
+    ++NumLinearScanEvictSpills;
+  }
+}
+
+unsigned RALinearScan::selectOrSplit(LiveInterval &VirtReg,
+                                     SmallVectorImpl<unsigned> &SplitVRegs) {
+  // Take the first free register in allocation order, which starts with the
+  // hints. Remember the cheapest register to evict from in case none is free.
+  unsigned BestPhys = 0;
+  float BestWeight = 0;
+  AllocationOrder Order(VirtReg.reg, *VRM, RegClassInfo, Matrix);
+  while (unsigned PhysReg = Order.next()) {
+    switch (Matrix->checkInterference(VirtReg, PhysReg)) {
+    case LiveRegMatrix::IK_Free:
+      return PhysReg;
+
+    case LiveRegMatrix::IK_VirtReg: {
+      float MaxWeight;
+      if (canEvictInterference(VirtReg, PhysReg, MaxWeight) &&
+          (!BestPhys || MaxWeight < BestWeight)) {
+        BestPhys = PhysReg;
+        BestWeight = MaxWeight;
+      }
+      continue;
+    }
+
+    default:
+      // RegMask or RegUnit interference.
+      continue;
+    }
+  }
+
+  if (BestPhys) {
+    evictInterference(VirtReg, BestPhys, SplitVRegs);
+    assert(!Matrix->checkInterference(VirtReg, BestPhys) &&
+           "Interference after eviction.");
+    return BestPhys;
+  }
+
+  // Nothing lighter is in the way, so spill VirtReg itself.
+  LLVM_DEBUG(dbgs() << "spilling: " << VirtReg << '\n');
+  if (!VirtReg.isSpillable())
+    return ~0u;
+  LiveRangeEdit LRE(&VirtReg, SplitVRegs, *MF, *LIS, VRM, this, &DeadRemats);
+  spiller().spill(LRE);
+
+  // The live virtual register requesting allocation was spilled, so tell
+  // the caller not to allocate anything during this round.
+  return 0;
+}
+
+bool RALinearScan::runOnMachineFunction(MachineFunction &mf) {
+  LLVM_DEBUG(dbgs() << "********** LINEAR SCAN REGISTER ALLOCATION **********\n"
+                    << "********** Function: " << mf.getName() << '\n');
+
+  MF = &mf;
+  Indexes = &getAnalysis<SlotIndexes>();
+  RegAllocBase::init(getAnalysis<VirtRegMap>(),
+                     getAnalysis<LiveIntervals>(),
+                     getAnalysis<LiveRegMatrix>());
+
+  calculateSpillWeightsAndHints(*LIS, *MF, VRM,
+                                getAnalysis<MachineLoopInfo>(),
+                                getAnalysis<MachineBlockFrequencyInfo>());
+
+  SpillerInstance.reset(createInlineSpiller(*this, *MF, *VRM));
+
+  allocatePhysRegs();
+  postOptimization();
+
+  // Diagnostic output before rewriting
+  LLVM_DEBUG(dbgs() << "Post alloc VirtRegMap:\n" << *VRM << "\n");
+
+  releaseMemory();
+  return true;
+}
+
+FunctionPass *llvm::createLinearScanRegisterAllocator() {
+  return new RALinearScan();
+}
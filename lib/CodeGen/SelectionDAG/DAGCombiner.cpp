@@ -129,20 +129,20 @@ namespace {
     ///
     /// The worklist will not contain duplicates but may contain null entries
     /// due to nodes being deleted from the underlying DAG.
-    SmallVector<SDNode *, 64> Worklist;
+    SmallVectorImpl<SDNode *> &Worklist;
 
     /// Mapping from an SDNode to its position on the worklist.
     ///
     /// This is used to find and remove nodes from the worklist (by nulling
     /// them) when they are deleted from the underlying DAG. It relies on
     /// stable indices of nodes within the worklist.
-    DenseMap<SDNode *, unsigned> WorklistMap;
+    DenseMap<SDNode *, unsigned> &WorklistMap;
 
     /// Set of nodes which have been combined (at least once).
     ///
     /// This is used to allow us to reliably add any operands of a DAG node
     /// which have not yet been combined to the worklist.
-    SmallPtrSet<SDNode *, 32> CombinedNodes;
+    SmallPtrSetImpl<SDNode *> &CombinedNodes;
 
     // AA - Used for DAG load/store alias analysis.
     AliasAnalysis *AA;
@@ -160,7 +160,9 @@ namespace {
   public:
     DAGCombiner(SelectionDAG &D, AliasAnalysis *AA, CodeGenOpt::Level OL)
         : DAG(D), TLI(D.getTargetLoweringInfo()), Level(BeforeLegalizeTypes),
-          OptLevel(OL), AA(AA) {
+          OptLevel(OL), Worklist(D.getCombinerWorklist().Nodes),
+          WorklistMap(D.getCombinerWorklist().Positions),
+          CombinedNodes(D.getCombinerWorklist().Combined), AA(AA) {
       ForCodeSize = DAG.getMachineFunction().getFunction().optForSize();
 
       MaximumLegalStoreInBits = 0;
@@ -1390,7 +1392,17 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
   LegalOperations = Level >= AfterLegalizeVectorOps;
   LegalTypes = Level >= AfterLegalizeTypes;
 
-  // Add all the dag nodes to the worklist.
+  // The worklist storage is shared by every combine of this SelectionDAG. The
+  // previous run drained the map but may have left null entries behind.
+  assert(WorklistMap.empty() && "Combiner worklist is already in use");
+  Worklist.clear();
+  CombinedNodes.clear();
+
+  // Add all the dag nodes to the worklist. The storage only has to grow when
+  // this DAG is larger than any combined before it.
+  unsigned NumNodes = DAG.allnodes_size();
+  Worklist.reserve(NumNodes);
+  WorklistMap.reserve(NumNodes);
   for (SDNode &Node : DAG.allnodes())
     AddToWorklist(&Node);
 
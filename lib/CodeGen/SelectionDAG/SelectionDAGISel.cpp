@@ -83,6 +83,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/KnownBits.h"
 #include "llvm/Support/MachineValueType.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetIntrinsicInfo.h"
@@ -711,6 +712,7 @@ void SelectionDAGISel::ComputeLiveOutVRegInfo() {
 void SelectionDAGISel::CodeGenAndEmitDAG() {
   StringRef GroupName = "sdag";
   StringRef GroupDescription = "Instruction Selection and Scheduling";
+  auto FunctionName = [&]() { return MF->getName().str(); };
   std::string BlockName;
   int BlockNumber = -1;
   (void)BlockNumber;
@@ -748,6 +750,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   {
     NamedRegionTimer T("combine1", "DAG Combining 1", GroupName,
                        GroupDescription, TimePassesIsEnabled);
+    TimeTraceScope TraceScope("DAG Combining 1", FunctionName);
     CurDAG->Combine(BeforeLegalizeTypes, AA, OptLevel);
   }
 
@@ -768,6 +771,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   {
     NamedRegionTimer T("legalize_types", "Type Legalization", GroupName,
                        GroupDescription, TimePassesIsEnabled);
+    TimeTraceScope TraceScope("Type Legalization", FunctionName);
     Changed = CurDAG->LegalizeTypes();
   }
 
@@ -790,6 +794,8 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
     {
       NamedRegionTimer T("combine_lt", "DAG Combining after legalize types",
                          GroupName, GroupDescription, TimePassesIsEnabled);
+      TimeTraceScope TraceScope("DAG Combining after legalize types",
+                                FunctionName);
       CurDAG->Combine(AfterLegalizeTypes, AA, OptLevel);
     }
 
@@ -805,6 +811,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   {
     NamedRegionTimer T("legalize_vec", "Vector Legalization", GroupName,
                        GroupDescription, TimePassesIsEnabled);
+    TimeTraceScope TraceScope("Vector Legalization", FunctionName);
     Changed = CurDAG->LegalizeVectors();
   }
 
@@ -817,6 +824,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
     {
       NamedRegionTimer T("legalize_types2", "Type Legalization 2", GroupName,
                          GroupDescription, TimePassesIsEnabled);
+      TimeTraceScope TraceScope("Type Legalization 2", FunctionName);
       CurDAG->LegalizeTypes();
     }
 
@@ -832,6 +840,8 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
     {
       NamedRegionTimer T("combine_lv", "DAG Combining after legalize vectors",
                          GroupName, GroupDescription, TimePassesIsEnabled);
+      TimeTraceScope TraceScope("DAG Combining after legalize vectors",
+                                FunctionName);
       CurDAG->Combine(AfterLegalizeVectorOps, AA, OptLevel);
     }
 
@@ -850,6 +860,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   {
     NamedRegionTimer T("legalize", "DAG Legalization", GroupName,
                        GroupDescription, TimePassesIsEnabled);
+    TimeTraceScope TraceScope("DAG Legalization", FunctionName);
     CurDAG->Legalize();
   }
 
@@ -868,6 +879,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   {
     NamedRegionTimer T("combine2", "DAG Combining 2", GroupName,
                        GroupDescription, TimePassesIsEnabled);
+    TimeTraceScope TraceScope("DAG Combining 2", FunctionName);
     CurDAG->Combine(AfterLegalizeDAG, AA, OptLevel);
   }
 
@@ -890,6 +902,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   {
     NamedRegionTimer T("isel", "Instruction Selection", GroupName,
                        GroupDescription, TimePassesIsEnabled);
+    TimeTraceScope TraceScope("Instruction Selection", FunctionName);
     DoInstructionSelection();
   }
 
@@ -906,6 +919,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   {
     NamedRegionTimer T("sched", "Instruction Scheduling", GroupName,
                        GroupDescription, TimePassesIsEnabled);
+    TimeTraceScope TraceScope("Instruction Scheduling", FunctionName);
     Scheduler->Run(CurDAG, FuncInfo->MBB);
   }
 
@@ -918,6 +932,7 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   {
     NamedRegionTimer T("emit", "Instruction Creation", GroupName,
                        GroupDescription, TimePassesIsEnabled);
+    TimeTraceScope TraceScope("Instruction Creation", FunctionName);
 
     // FuncInfo->InsertPt is passed by reference and set to the end of the
     // scheduled instructions.
@@ -933,6 +948,8 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   {
     NamedRegionTimer T("cleanup", "Instruction Scheduling Cleanup", GroupName,
                        GroupDescription, TimePassesIsEnabled);
+    TimeTraceScope TraceScope("Instruction Scheduling Cleanup",
+                              FunctionName);
     delete Scheduler;
   }
 
@@ -1748,6 +1765,10 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
 
   propagateSwiftErrorVRegs(FuncInfo);
 
+  // The stack objects of the allocas exist now. Tag them with the layout the
+  // stack protector needs, for the frame lowering passes to read.
+  getAnalysis<StackProtector>().copyToMachineFrameInfo(MF->getFrameInfo());
+
   delete FastIS;
   SDB->clearDanglingDebugInfo();
   SDB->SPDescriptor.resetPerFunctionState();
@@ -411,6 +411,15 @@ TargetPassConfig::TargetPassConfig()
                      "triple set?");
 }
 
+bool TargetPassConfig::canRunMachinePassesConcurrently() const {
+  // The machine outliner and IPRA look at more than one function, and the
+  // machine code printer and the pass timers are not thread-safe.
+  return TM->Options.MachineFunctionThreads > 1 &&
+         !hasLimitedCodeGenPipeline() && !requiresCodeGenSCCOrder() &&
+         !EnableMachineOutliner && !TM->Options.PrintMachineCode &&
+         !TimePassesIsEnabled;
+}
+
 bool TargetPassConfig::hasLimitedCodeGenPipeline() const {
   return StartBefore || StartAfter || StopBefore || StopAfter;
 }
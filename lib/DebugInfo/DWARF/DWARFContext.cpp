@@ -49,6 +49,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <map>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -549,6 +550,7 @@ void DWARFContext::dump(
 }
 
 DWARFCompileUnit *DWARFContext::getDWOCompileUnitForHash(uint64_t Hash) {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   DWOCUs.parseDWO(*this, DObj->getInfoDWOSection(), true);
 
   if (const auto &CUI = getCUIndex()) {
@@ -598,6 +600,7 @@ bool DWARFContext::verify(raw_ostream &OS, DIDumpOptions DumpOpts) {
 }
 
 const DWARFUnitIndex &DWARFContext::getCUIndex() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (CUIndex)
     return *CUIndex;
 
@@ -609,6 +612,7 @@ const DWARFUnitIndex &DWARFContext::getCUIndex() {
 }
 
 const DWARFUnitIndex &DWARFContext::getTUIndex() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (TUIndex)
     return *TUIndex;
 
@@ -620,6 +624,7 @@ const DWARFUnitIndex &DWARFContext::getTUIndex() {
 }
 
 DWARFGdbIndex &DWARFContext::getGdbIndex() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (GdbIndex)
     return *GdbIndex;
 
@@ -630,6 +635,7 @@ DWARFGdbIndex &DWARFContext::getGdbIndex() {
 }
 
 const DWARFDebugAbbrev *DWARFContext::getDebugAbbrev() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (Abbrev)
     return Abbrev.get();
 
@@ -641,6 +647,7 @@ const DWARFDebugAbbrev *DWARFContext::getDebugAbbrev() {
 }
 
 const DWARFDebugAbbrev *DWARFContext::getDebugAbbrevDWO() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (AbbrevDWO)
     return AbbrevDWO.get();
 
@@ -651,6 +658,7 @@ const DWARFDebugAbbrev *DWARFContext::getDebugAbbrevDWO() {
 }
 
 const DWARFDebugLoc *DWARFContext::getDebugLoc() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (Loc)
     return Loc.get();
 
@@ -665,6 +673,7 @@ const DWARFDebugLoc *DWARFContext::getDebugLoc() {
 }
 
 const DWARFDebugLocDWO *DWARFContext::getDebugLocDWO() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (LocDWO)
     return LocDWO.get();
 
@@ -679,6 +688,7 @@ const DWARFDebugLocDWO *DWARFContext::getDebugLocDWO() {
 }
 
 const DWARFDebugAranges *DWARFContext::getDebugAranges() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (Aranges)
     return Aranges.get();
 
@@ -688,6 +698,7 @@ const DWARFDebugAranges *DWARFContext::getDebugAranges() {
 }
 
 const DWARFDebugFrame *DWARFContext::getDebugFrame() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (DebugFrame)
     return DebugFrame.get();
 
@@ -708,6 +719,7 @@ const DWARFDebugFrame *DWARFContext::getDebugFrame() {
 }
 
 const DWARFDebugFrame *DWARFContext::getEHFrame() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (EHFrame)
     return EHFrame.get();
 
@@ -719,6 +731,7 @@ const DWARFDebugFrame *DWARFContext::getEHFrame() {
 }
 
 const DWARFDebugMacro *DWARFContext::getDebugMacro() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (Macro)
     return Macro.get();
 
@@ -743,27 +756,32 @@ static T &getAccelTable(std::unique_ptr<T> &Cache, const DWARFObject &Obj,
 }
 
 const DWARFDebugNames &DWARFContext::getDebugNames() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   return getAccelTable(Names, *DObj, DObj->getDebugNamesSection(),
                        DObj->getStringSection(), isLittleEndian());
 }
 
 const AppleAcceleratorTable &DWARFContext::getAppleNames() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   return getAccelTable(AppleNames, *DObj, DObj->getAppleNamesSection(),
                        DObj->getStringSection(), isLittleEndian());
 }
 
 const AppleAcceleratorTable &DWARFContext::getAppleTypes() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   return getAccelTable(AppleTypes, *DObj, DObj->getAppleTypesSection(),
                        DObj->getStringSection(), isLittleEndian());
 }
 
 const AppleAcceleratorTable &DWARFContext::getAppleNamespaces() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   return getAccelTable(AppleNamespaces, *DObj,
                        DObj->getAppleNamespacesSection(),
                        DObj->getStringSection(), isLittleEndian());
 }
 
 const AppleAcceleratorTable &DWARFContext::getAppleObjC() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   return getAccelTable(AppleObjC, *DObj, DObj->getAppleObjCSection(),
                        DObj->getStringSection(), isLittleEndian());
 }
@@ -781,6 +799,7 @@ DWARFContext::getLineTableForUnit(DWARFUnit *U) {
 
 Expected<const DWARFDebugLine::LineTable *> DWARFContext::getLineTableForUnit(
     DWARFUnit *U, std::function<void(Error)> RecoverableErrorCallback) {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (!Line)
     Line.reset(new DWARFDebugLine);
 
@@ -809,10 +828,12 @@ Expected<const DWARFDebugLine::LineTable *> DWARFContext::getLineTableForUnit(
 }
 
 void DWARFContext::parseCompileUnits() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   CUs.parse(*this, DObj->getInfoSection());
 }
 
 void DWARFContext::parseTypeUnits() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (!TUs.empty())
     return;
   DObj->forEachTypesSections([&](const DWARFSection &S) {
@@ -822,10 +843,12 @@ void DWARFContext::parseTypeUnits() {
 }
 
 void DWARFContext::parseDWOCompileUnits() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   DWOCUs.parseDWO(*this, DObj->getInfoDWOSection());
 }
 
 void DWARFContext::parseDWOTypeUnits() {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (!DWOTUs.empty())
     return;
   DObj->forEachTypesDWOSections([&](const DWARFSection &S) {
@@ -1034,6 +1057,7 @@ DWARFContext::getInliningInfoForAddress(uint64_t Address,
 
 std::shared_ptr<DWARFContext>
 DWARFContext::getDWOContext(StringRef AbsolutePath) {
+  std::lock_guard<std::recursive_mutex> Lock(Mutex);
   if (auto S = DWP.lock()) {
     DWARFContext *Ctxt = S->Context.get();
     return std::shared_ptr<DWARFContext>(std::move(S), Ctxt);
@@ -184,7 +184,7 @@ parseRngListTableHeader(DWARFDataExtractor &DA, uint32_t Offset) {
 bool DWARFUnit::extractRangeList(uint32_t RangeListOffset,
                                  DWARFDebugRangeList &RangeList) const {
   // Require that compile unit is extracted.
-  assert(!DieArray.empty());
+  assert(Extracted.load(std::memory_order_acquire) != NothingExtracted);
   DWARFDataExtractor RangesData(Context.getDWARFObj(), *RangeSection,
                                 isLittleEndian, getAddressByteSize());
   uint32_t ActualRangeListOffset = RangeSectionBase + RangeListOffset;
@@ -198,6 +198,7 @@ void DWARFUnit::clear() {
   AddrOffsetSectionBase = 0;
   clearDIEs(false);
   DWO.reset();
+  DWOInUse = false;
 }
 
 const char *DWARFUnit::getCompilationDir() {
@@ -259,90 +260,109 @@ void DWARFUnit::extractDIEsToVector(
 }
 
 size_t DWARFUnit::extractDIEsIfNeeded(bool CUDieOnly) {
-  if ((CUDieOnly && !DieArray.empty()) ||
-      DieArray.size() > 1)
+  const uint8_t Needed = CUDieOnly ? UnitDIEExtracted : AllDIEsExtracted;
+  if (Extracted.load(std::memory_order_acquire) >= Needed)
     return 0; // Already parsed.
 
-  bool HasCUDie = !DieArray.empty();
-  extractDIEsToVector(!HasCUDie, !CUDieOnly, DieArray);
+  std::lock_guard<std::mutex> Lock(ExtractMutex);
+  const uint8_t State = Extracted.load(std::memory_order_relaxed);
+  if (State >= Needed)
+    return 0; // Parsed by another thread while we were waiting.
+
+  bool HasCUDie = State >= UnitDIEExtracted;
+  if (HasCUDie) {
+    // Other threads may be holding on to the unit DIE, so extract into a new
+    // array rather than growing the current one, and keep the old one alive.
+    std::vector<DWARFDebugInfoEntry> DIEs;
+    DIEs.push_back(DieArray[0]);
+    extractDIEsToVector(false, true, DIEs);
+    RetiredDieArrays.push_back(std::move(DieArray));
+    DieArray = std::move(DIEs);
+  } else {
+    extractDIEsToVector(true, !CUDieOnly, DieArray);
+  }
 
   if (DieArray.empty())
     return 0;
+  UnitDIEEntry.store(&DieArray[0]);
 
-  // If CU DIE was just parsed, copy several attribute values from it.
-  if (!HasCUDie) {
-    DWARFDie UnitDie = getUnitDIE();
-    if (Optional<uint64_t> DWOId = toUnsigned(UnitDie.find(DW_AT_GNU_dwo_id)))
-      Header.setDWOId(*DWOId);
-    if (!isDWO) {
-      assert(AddrOffsetSectionBase == 0);
-      assert(RangeSectionBase == 0);
-      AddrOffsetSectionBase =
-          toSectionOffset(UnitDie.find(DW_AT_GNU_addr_base), 0);
-      RangeSectionBase = toSectionOffset(UnitDie.find(DW_AT_rnglists_base), 0);
-    }
+  // If CU DIE was just parsed, copy several attribute values from it before
+  // publishing it.
+  if (!HasCUDie)
+    initFromUnitDIE(DWARFDie(this, &DieArray[0]));
+  Extracted.store(Needed, std::memory_order_release);
+  return DieArray.size();
+}
 
-    // In general, in DWARF v5 and beyond we derive the start of the unit's
-    // contribution to the string offsets table from the unit DIE's
-    // DW_AT_str_offsets_base attribute. Split DWARF units do not use this
-    // attribute, so we assume that there is a contribution to the string
-    // offsets table starting at offset 0 of the debug_str_offsets.dwo section.
-    // In both cases we need to determine the format of the contribution,
-    // which may differ from the unit's format.
-    uint64_t StringOffsetsContributionBase =
-        isDWO ? 0 : toSectionOffset(UnitDie.find(DW_AT_str_offsets_base), 0);
-    auto IndexEntry = Header.getIndexEntry();
-    if (IndexEntry)
-      if (const auto *C = IndexEntry->getOffset(DW_SECT_STR_OFFSETS))
-        StringOffsetsContributionBase += C->Offset;
-
-    DWARFDataExtractor DA(Context.getDWARFObj(), StringOffsetSection,
-                          isLittleEndian, 0);
+void DWARFUnit::initFromUnitDIE(DWARFDie UnitDie) {
+  if (Optional<uint64_t> DWOId = toUnsigned(UnitDie.find(DW_AT_GNU_dwo_id)))
+    Header.setDWOId(*DWOId);
+  if (!isDWO) {
+    assert(AddrOffsetSectionBase == 0);
+    assert(RangeSectionBase == 0);
+    AddrOffsetSectionBase =
+        toSectionOffset(UnitDie.find(DW_AT_GNU_addr_base), 0);
+    RangeSectionBase = toSectionOffset(UnitDie.find(DW_AT_rnglists_base), 0);
+  }
+
+  // In general, in DWARF v5 and beyond we derive the start of the unit's
+  // contribution to the string offsets table from the unit DIE's
+  // DW_AT_str_offsets_base attribute. Split DWARF units do not use this
+  // attribute, so we assume that there is a contribution to the string
+  // offsets table starting at offset 0 of the debug_str_offsets.dwo section.
+  // In both cases we need to determine the format of the contribution,
+  // which may differ from the unit's format.
+  uint64_t StringOffsetsContributionBase =
+      isDWO ? 0 : toSectionOffset(UnitDie.find(DW_AT_str_offsets_base), 0);
+  auto IndexEntry = Header.getIndexEntry();
+  if (IndexEntry)
+    if (const auto *C = IndexEntry->getOffset(DW_SECT_STR_OFFSETS))
+      StringOffsetsContributionBase += C->Offset;
+
+  DWARFDataExtractor DA(Context.getDWARFObj(), StringOffsetSection,
+                        isLittleEndian, 0);
+  if (isDWO)
+    StringOffsetsTableContribution =
+        determineStringOffsetsTableContributionDWO(
+            DA, StringOffsetsContributionBase);
+  else if (getVersion() >= 5)
+    StringOffsetsTableContribution = determineStringOffsetsTableContribution(
+        DA, StringOffsetsContributionBase);
+
+  // DWARF v5 uses the .debug_rnglists and .debug_rnglists.dwo sections to
+  // describe address ranges.
+  if (getVersion() >= 5) {
     if (isDWO)
-      StringOffsetsTableContribution =
-          determineStringOffsetsTableContributionDWO(
-              DA, StringOffsetsContributionBase);
-    else if (getVersion() >= 5)
-      StringOffsetsTableContribution = determineStringOffsetsTableContribution(
-          DA, StringOffsetsContributionBase);
-
-    // DWARF v5 uses the .debug_rnglists and .debug_rnglists.dwo sections to
-    // describe address ranges.
-    if (getVersion() >= 5) {
-      if (isDWO)
-        setRangesSection(&Context.getDWARFObj().getRnglistsDWOSection(), 0);
-      else
-        setRangesSection(&Context.getDWARFObj().getRnglistsSection(),
-                         toSectionOffset(UnitDie.find(DW_AT_rnglists_base), 0));
-      // Parse the range list table header. Individual range lists are
-      // extracted lazily.
-      DWARFDataExtractor RangesDA(Context.getDWARFObj(), *RangeSection,
-                                  isLittleEndian, 0);
-      if (auto TableOrError =
-              parseRngListTableHeader(RangesDA, RangeSectionBase))
-        RngListTable = TableOrError.get();
-      else
-        WithColor::error() << "parsing a range list table: "
-                           << toString(TableOrError.takeError())
-                           << '\n';
-
-      // In a split dwarf unit, there is no DW_AT_rnglists_base attribute.
-      // Adjust RangeSectionBase to point past the table header.
-      if (isDWO && RngListTable)
-        RangeSectionBase = RngListTable->getHeaderSize();
-    }
+      setRangesSection(&Context.getDWARFObj().getRnglistsDWOSection(), 0);
+    else
+      setRangesSection(&Context.getDWARFObj().getRnglistsSection(),
+                       toSectionOffset(UnitDie.find(DW_AT_rnglists_base), 0));
+    // Parse the range list table header. Individual range lists are
+    // extracted lazily.
+    DWARFDataExtractor RangesDA(Context.getDWARFObj(), *RangeSection,
+                                isLittleEndian, 0);
+    if (auto TableOrError =
+            parseRngListTableHeader(RangesDA, RangeSectionBase))
+      RngListTable = TableOrError.get();
+    else
+      WithColor::error() << "parsing a range list table: "
+                         << toString(TableOrError.takeError())
+                         << '\n';
 
-    // Don't fall back to DW_AT_GNU_ranges_base: it should be ignored for
-    // skeleton CU DIE, so that DWARF users not aware of it are not broken.
+    // In a split dwarf unit, there is no DW_AT_rnglists_base attribute.
+    // Adjust RangeSectionBase to point past the table header.
+    if (isDWO && RngListTable)
+      RangeSectionBase = RngListTable->getHeaderSize();
   }
 
-  return DieArray.size();
+  // Don't fall back to DW_AT_GNU_ranges_base: it should be ignored for
+  // skeleton CU DIE, so that DWARF users not aware of it are not broken.
 }
 
 bool DWARFUnit::parseDWO() {
   if (isDWO)
     return false;
-  if (DWO.get())
+  if (getDWO())
     return false;
   DWARFDie UnitDie = getUnitDIE();
   if (!UnitDie)
@@ -367,6 +387,12 @@ bool DWARFUnit::parseDWO() {
   DWARFCompileUnit *DWOCU = DWOContext->getDWOCompileUnitForHash(*DWOId);
   if (!DWOCU)
     return false;
+
+  // The .dwo file was opened without holding DWOMutex, since that takes the
+  // context's lock; another thread may have beaten us to it.
+  std::lock_guard<std::mutex> Lock(DWOMutex);
+  if (DWO)
+    return false;
   DWO = std::shared_ptr<DWARFCompileUnit>(std::move(DWOContext), DWOCU);
   // Share .debug_addr and .debug_ranges section with compile unit in .dwo
   DWO->setAddrOffsetSection(AddrOffsetSection, AddrOffsetSectionBase);
@@ -395,6 +421,15 @@ void DWARFUnit::clearDIEs(bool KeepCUDie) {
     DieArray.resize((unsigned)KeepCUDie);
     DieArray.shrink_to_fit();
   }
+  RetiredDieArrays.clear();
+  AddrDieMap.clear();
+  if (DieArray.empty()) {
+    UnitDIEEntry = nullptr;
+    Extracted = NothingExtracted;
+  } else {
+    UnitDIEEntry = &DieArray[0];
+    Extracted = UnitDIEExtracted;
+  }
 }
 
 DWARFAddressRangesVector DWARFUnit::findRnglistFromOffset(uint32_t Offset) {
@@ -433,23 +468,36 @@ void DWARFUnit::collectAddressRanges(DWARFAddressRangesVector &CURanges) {
   // This function is usually called if there in no .debug_aranges section
   // in order to produce a compile unit level set of address ranges that
   // is accurate. If the DIEs weren't parsed, then we don't want all dies for
-  // all compile units to stay loaded when they weren't needed. So we can end
-  // up parsing the DWARF and then throwing them all away to keep memory usage
-  // down.
-  const bool ClearDIEs = extractDIEsIfNeeded(false) > 1;
-  getUnitDIE().collectChildrenAddressRanges(CURanges);
+  // all compile units to stay loaded when they weren't needed. So we parse
+  // them into a temporary array instead. The DIE tree is stored in preorder,
+  // so a linear walk visits the subprograms in the same order as
+  // DWARFDie::collectChildrenAddressRanges().
+  if (Extracted.load(std::memory_order_acquire) == AllDIEsExtracted) {
+    getUnitDIE().collectChildrenAddressRanges(CURanges);
+  } else {
+    std::vector<DWARFDebugInfoEntry> DIEs;
+    extractDIEsToVector(false, true, DIEs);
+    for (const DWARFDebugInfoEntry &Entry : DIEs) {
+      DWARFDie Die(this, &Entry);
+      if (!Die.isNULL() && Die.isSubprogramDIE()) {
+        const auto &DIERanges = Die.getAddressRanges();
+        CURanges.insert(CURanges.end(), DIERanges.begin(), DIERanges.end());
+      }
+    }
+  }
 
   // Collect address ranges from DIEs in .dwo if necessary.
   bool DWOCreated = parseDWO();
-  if (DWO)
-    DWO->collectAddressRanges(CURanges);
-  if (DWOCreated)
-    DWO.reset();
-
-  // Keep memory down by clearing DIEs if this generate function
-  // caused them to be parsed.
-  if (ClearDIEs)
-    clearDIEs(true);
+  if (std::shared_ptr<DWARFUnit> DWOCU = getDWO())
+    DWOCU->collectAddressRanges(CURanges);
+
+  // Keep memory down by dropping the .dwo file again if this function caused
+  // it to be loaded and nobody else has asked for it since.
+  if (DWOCreated) {
+    std::lock_guard<std::mutex> Lock(DWOMutex);
+    if (!DWOInUse)
+      DWO.reset();
+  }
 }
 
 void DWARFUnit::updateAddressDieMap(DWARFDie Die) {
@@ -481,6 +529,7 @@ void DWARFUnit::updateAddressDieMap(DWARFDie Die) {
 
 DWARFDie DWARFUnit::getSubroutineForAddress(uint64_t Address) {
   extractDIEsIfNeeded(false);
+  std::lock_guard<std::mutex> Lock(AddrDieMapMutex);
   if (AddrDieMap.empty())
     updateAddressDieMap(getUnitDIE());
   auto R = AddrDieMap.upper_bound(Address);
@@ -497,12 +546,18 @@ void
 DWARFUnit::getInlinedChainForAddress(uint64_t Address,
                                      SmallVectorImpl<DWARFDie> &InlinedChain) {
   assert(InlinedChain.empty());
-  // Try to look for subprogram DIEs in the DWO file.
+  // Try to look for subprogram DIEs in the DWO file. The returned DIEs point
+  // into it, so make sure it stays loaded.
+  {
+    std::lock_guard<std::mutex> Lock(DWOMutex);
+    DWOInUse = true;
+  }
   parseDWO();
+  std::shared_ptr<DWARFUnit> DWOCU = getDWO();
   // First, find the subroutine that contains the given address (the leaf
   // of inlined chain).
   DWARFDie SubroutineDIE =
-      (DWO ? DWO.get() : this)->getSubroutineForAddress(Address);
+      (DWOCU ? DWOCU.get() : this)->getSubroutineForAddress(Address);
 
   if (!SubroutineDIE)
     return;
@@ -533,6 +588,8 @@ DWARFDie DWARFUnit::getParent(const DWARFDebugInfoEntry *Die) {
   // Depth of 1 always means parent is the compile/type unit.
   if (Depth == 1)
     return getUnitDIE();
+  if (!allDIEsExtracted())
+    return DWARFDie();
   // Look for previous DIE with a depth that is one less than the Die's depth.
   const uint32_t ParentDepth = Depth - 1;
   for (uint32_t I = getDIEIndex(Die) - 1; I > 0; --I) {
@@ -552,6 +609,8 @@ DWARFDie DWARFUnit::getSibling(const DWARFDebugInfoEntry *Die) {
   // NULL DIEs don't have siblings.
   if (Die->getAbbreviationDeclarationPtr() == nullptr)
     return DWARFDie();
+  if (!allDIEsExtracted())
+    return DWARFDie();
 
   // Find the next DIE whose depth is the same as the Die's depth.
   for (size_t I = getDIEIndex(Die) + 1, EndIdx = DieArray.size(); I < EndIdx;
@@ -565,6 +624,10 @@ DWARFDie DWARFUnit::getSibling(const DWARFDebugInfoEntry *Die) {
 DWARFDie DWARFUnit::getFirstChild(const DWARFDebugInfoEntry *Die) {
   if (!Die->hasChildren())
     return DWARFDie();
+  // Children of a unit DIE extracted on its own are not available yet, and
+  // DieArray is replaced when they are.
+  if (!allDIEsExtracted())
+    return DWARFDie();
 
   // We do not want access out of bounds when parsing corrupted debug data.
   size_t I = getDIEIndex(Die) + 1;
@@ -574,12 +637,17 @@ DWARFDie DWARFUnit::getFirstChild(const DWARFDebugInfoEntry *Die) {
 }
 
 const DWARFAbbreviationDeclarationSet *DWARFUnit::getAbbreviations() const {
-  if (!Abbrevs)
-    Abbrevs = Abbrev->getAbbreviationDeclarationSet(Header.getAbbrOffset());
-  return Abbrevs;
+  // Racing threads look up the same set, so whichever store wins is fine.
+  const DWARFAbbreviationDeclarationSet *Set = Abbrevs.load();
+  if (!Set) {
+    Set = Abbrev->getAbbreviationDeclarationSet(Header.getAbbrOffset());
+    Abbrevs.store(Set);
+  }
+  return Set;
 }
 
 llvm::Optional<BaseAddress> DWARFUnit::getBaseAddress() {
+  std::lock_guard<std::mutex> Lock(BaseAddrMutex);
   if (BaseAddr)
     return BaseAddr;
 
@@ -16,6 +16,7 @@
 #include "SymbolizableObjectFile.h"
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/BinaryFormat/COFF.h"
 #include "llvm/Config/config.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
@@ -56,6 +57,15 @@ namespace symbolize {
 Expected<DILineInfo>
 LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
                               uint64_t ModuleOffset, StringRef DWPName) {
+  SymbolizeCache *Cache;
+  if (auto CacheOrErr = getOrCreateCache(ModuleName, DWPName))
+    Cache = CacheOrErr.get();
+  else
+    return CacheOrErr.takeError();
+  if (Cache)
+    if (Optional<DILineInfo> Cached = Cache->lookupCode(ModuleOffset))
+      return *Cached;
+
   SymbolizableModule *Info;
   if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName, DWPName))
     Info = InfoOrErr.get();
@@ -67,6 +77,10 @@ LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
   if (!Info)
     return DILineInfo();
 
+  // The cache is keyed by the address as given, so remember it before it is
+  // adjusted.
+  uint64_t CacheAddress = ModuleOffset;
+
   // If the user is giving us relative addresses, add the preferred base of the
   // object to the offset before we do the query. It's what DIContext expects.
   if (Opts.RelativeAddresses)
@@ -76,12 +90,24 @@ LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
                                             Opts.UseSymbolTable);
   if (Opts.Demangle)
     LineInfo.FunctionName = DemangleName(LineInfo.FunctionName, Info);
+  if (Cache)
+    Cache->insertCode(CacheAddress, LineInfo);
   return LineInfo;
 }
 
 Expected<DIInliningInfo>
 LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
                                      uint64_t ModuleOffset, StringRef DWPName) {
+  SymbolizeCache *Cache;
+  if (auto CacheOrErr = getOrCreateCache(ModuleName, DWPName))
+    Cache = CacheOrErr.get();
+  else
+    return CacheOrErr.takeError();
+  if (Cache)
+    if (Optional<DIInliningInfo> Cached =
+            Cache->lookupInlinedCode(ModuleOffset))
+      return *Cached;
+
   SymbolizableModule *Info;
   if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName, DWPName))
     Info = InfoOrErr.get();
@@ -93,6 +119,8 @@ LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
   if (!Info)
     return DIInliningInfo();
 
+  uint64_t CacheAddress = ModuleOffset;
+
   // If the user is giving us relative addresses, add the preferred base of the
   // object to the offset before we do the query. It's what DIContext expects.
   if (Opts.RelativeAddresses)
@@ -106,6 +134,8 @@ LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
       Frame->FunctionName = DemangleName(Frame->FunctionName, Info);
     }
   }
+  if (Cache)
+    Cache->insertInlinedCode(CacheAddress, InlinedContext);
   return InlinedContext;
 }
 
@@ -135,6 +165,12 @@ Expected<DIGlobal> LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
 }
 
 void LLVMSymbolizer::flush() {
+  // The cache is only an optimization; failing to update it is not an error
+  // for the symbolization that has already succeeded.
+  for (auto &KV : Caches)
+    if (KV.second)
+      consumeError(KV.second->flush());
+  Caches.clear();
   ObjectForUBPathAndArch.clear();
   BinaryForPath.clear();
   ObjectPairForPathArch.clear();
@@ -364,13 +400,8 @@ LLVMSymbolizer::getOrCreateObject(const std::string &Path,
   return errorCodeToError(object_error::arch_not_found);
 }
 
-Expected<SymbolizableModule *>
-LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName,
-                                      StringRef DWPName) {
-  const auto &I = Modules.find(ModuleName);
-  if (I != Modules.end()) {
-    return I->second.get();
-  }
+std::pair<std::string, std::string>
+LLVMSymbolizer::getBinaryAndArchName(const std::string &ModuleName) const {
   std::string BinaryName = ModuleName;
   std::string ArchName = Opts.DefaultArch;
   size_t ColonPos = ModuleName.find_last_of(':');
@@ -382,6 +413,64 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName,
       ArchName = ArchStr;
     }
   }
+  return std::make_pair(BinaryName, ArchName);
+}
+
+Expected<SymbolizeCache *>
+LLVMSymbolizer::getOrCreateCache(const std::string &ModuleName,
+                                 StringRef DWPName) {
+  // Results depend on the contents of a DWP file, which the build-id of the
+  // binary does not cover.
+  if (Opts.CacheDirectory.empty() || !DWPName.empty())
+    return nullptr;
+  const auto &I = Caches.find(ModuleName);
+  if (I != Caches.end())
+    return I->second.get();
+  // A module that already failed to load has no cache either.
+  const auto &M = Modules.find(ModuleName);
+  if (M != Modules.end() && !M->second)
+    return nullptr;
+
+  // Only the object itself is needed to read its build-id; debug info lookup
+  // and parsing are deferred until a query misses the cache.
+  std::string BinaryName, ArchName;
+  std::tie(BinaryName, ArchName) = getBinaryAndArchName(ModuleName);
+  auto ObjOrErr = getOrCreateObject(BinaryName, ArchName);
+  if (!ObjOrErr || !ObjOrErr.get()) {
+    Caches.insert(
+        std::make_pair(ModuleName, std::unique_ptr<SymbolizeCache>()));
+    Modules.insert(
+        std::make_pair(ModuleName, std::unique_ptr<SymbolizableModule>()));
+    if (!ObjOrErr)
+      return ObjOrErr.takeError();
+    return nullptr;
+  }
+
+  std::unique_ptr<SymbolizeCache> Cache;
+  std::string BuildID = SymbolizeCache::getBuildID(*ObjOrErr.get());
+  if (!BuildID.empty()) {
+    // Everything that changes the results for a given address is part of the
+    // key, so that differently configured symbolizers can share a directory.
+    std::string Key = BuildID + "-" +
+                      utostr(static_cast<unsigned>(Opts.PrintFunctions)) +
+                      utostr(Opts.UseSymbolTable) + utostr(Opts.Demangle) +
+                      utostr(Opts.RelativeAddresses);
+    Cache = llvm::make_unique<SymbolizeCache>(Opts.CacheDirectory, Key);
+  }
+  SymbolizeCache *Res = Cache.get();
+  Caches.insert(std::make_pair(ModuleName, std::move(Cache)));
+  return Res;
+}
+
+Expected<SymbolizableModule *>
+LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName,
+                                      StringRef DWPName) {
+  const auto &I = Modules.find(ModuleName);
+  if (I != Modules.end()) {
+    return I->second.get();
+  }
+  std::string BinaryName, ArchName;
+  std::tie(BinaryName, ArchName) = getBinaryAndArchName(ModuleName);
   auto ObjectsOrErr = getOrCreateObjectPair(BinaryName, ArchName);
   if (!ObjectsOrErr) {
     // Failed to find valid object file.
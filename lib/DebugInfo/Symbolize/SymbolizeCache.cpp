@@ -0,0 +1,321 @@
+//===- SymbolizeCache.cpp -------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of the persistent symbolization cache.
+//
+// A cache file is laid out as follows, all integers little-endian:
+//
+//   FileHeader
+//   FileEntry[NumEntries]    sorted by (Address, Kind)
+//   FileFrame[NumFrames]
+//   char[StringTableSize]    NUL-terminated strings referenced by frames
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/DebugInfo/Symbolize/SymbolizeCache.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Object/MachO.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace llvm;
+using namespace object;
+using namespace symbolize;
+
+namespace {
+
+const char CacheMagic[8] = {'L', 'L', 'V', 'M', 'S', 'Y', 'M', 'C'};
+const uint32_t CacheVersion = 1;
+
+struct FileHeader {
+  char Magic[8];
+  support::ulittle32_t Version;
+  support::ulittle32_t NumEntries;
+  support::ulittle32_t NumFrames;
+  support::ulittle32_t StringTableSize;
+};
+
+struct FileEntry {
+  support::ulittle64_t Address;
+  support::ulittle32_t Kind;
+  support::ulittle32_t FirstFrame;
+  support::ulittle32_t NumFrames;
+  support::ulittle32_t Padding;
+};
+
+struct FileFrame {
+  support::ulittle32_t FunctionName;
+  support::ulittle32_t FileName;
+  support::ulittle32_t Line;
+  support::ulittle32_t Column;
+  support::ulittle32_t StartLine;
+  support::ulittle32_t Discriminator;
+};
+
+/// Provides typed access to the contents of a validated cache file.
+class CacheFileView {
+public:
+  /// Returns false if \p Data is not a well-formed cache file.
+  bool init(StringRef Data) {
+    if (Data.size() < sizeof(FileHeader))
+      return false;
+    Header = reinterpret_cast<const FileHeader *>(Data.data());
+    if (memcmp(Header->Magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+        Header->Version != CacheVersion)
+      return false;
+    uint64_t ExpectedSize = sizeof(FileHeader) +
+                            uint64_t(Header->NumEntries) * sizeof(FileEntry) +
+                            uint64_t(Header->NumFrames) * sizeof(FileFrame) +
+                            Header->StringTableSize;
+    if (Data.size() != ExpectedSize)
+      return false;
+    Entries = reinterpret_cast<const FileEntry *>(Header + 1);
+    Frames = reinterpret_cast<const FileFrame *>(Entries + Header->NumEntries);
+    Strings = StringRef(reinterpret_cast<const char *>(Frames +
+                                                       Header->NumFrames),
+                        Header->StringTableSize);
+    // Every string is NUL-terminated, so the table must end with a NUL.
+    return Strings.empty() || Strings.back() == '\0';
+  }
+
+  ArrayRef<FileEntry> entries() const {
+    return makeArrayRef(Entries, Header->NumEntries);
+  }
+
+  /// Decodes the frames of \p E, or returns None if they are out of bounds.
+  Optional<DIInliningInfo> decode(const FileEntry &E) const {
+    if (uint64_t(E.FirstFrame) + E.NumFrames > Header->NumFrames)
+      return None;
+    DIInliningInfo Info;
+    for (const FileFrame &F :
+         makeArrayRef(Frames + E.FirstFrame, E.NumFrames)) {
+      if (F.FunctionName >= Strings.size() || F.FileName >= Strings.size())
+        return None;
+      DILineInfo Frame;
+      Frame.FunctionName = Strings.data() + F.FunctionName;
+      Frame.FileName = Strings.data() + F.FileName;
+      Frame.Line = F.Line;
+      Frame.Column = F.Column;
+      Frame.StartLine = F.StartLine;
+      Frame.Discriminator = F.Discriminator;
+      Info.addFrame(Frame);
+    }
+    return Info;
+  }
+
+private:
+  const FileHeader *Header = nullptr;
+  const FileEntry *Entries = nullptr;
+  const FileFrame *Frames = nullptr;
+  StringRef Strings;
+};
+
+bool entryLess(const FileEntry &E, std::pair<uint64_t, uint32_t> Key) {
+  return std::make_pair(uint64_t(E.Address), uint32_t(E.Kind)) < Key;
+}
+
+/// Reads the descriptor of the GNU build-id note in \p Obj, if any.
+ArrayRef<uint8_t> getELFBuildID(const ObjectFile &Obj) {
+  for (const SectionRef &Section : Obj.sections()) {
+    StringRef Name;
+    if (Section.getName(Name) || Name != ".note.gnu.build-id")
+      continue;
+    StringRef Data;
+    if (Section.getContents(Data))
+      return {};
+    DataExtractor DE(Data, Obj.isLittleEndian(), 0);
+    uint32_t Offset = 0;
+    // Walk the notes in the section and return the first NT_GNU_BUILD_ID.
+    while (DE.isValidOffsetForDataOfSize(Offset, 12)) {
+      uint32_t NameSize = DE.getU32(&Offset);
+      uint32_t DescSize = DE.getU32(&Offset);
+      uint32_t Type = DE.getU32(&Offset);
+      uint32_t DescOffset = Offset + alignTo(NameSize, 4);
+      if (!DE.isValidOffsetForDataOfSize(DescOffset, DescSize))
+        break;
+      if (Type == 3 /* NT_GNU_BUILD_ID */ && NameSize == 4 &&
+          Data.substr(Offset, 4) == StringRef("GNU", 4))
+        return arrayRefFromStringRef(Data.substr(DescOffset, DescSize));
+      Offset = DescOffset + alignTo(DescSize, 4);
+    }
+  }
+  return {};
+}
+
+} // end anonymous namespace
+
+std::string SymbolizeCache::getBuildID(const ObjectFile &Obj) {
+  ArrayRef<uint8_t> ID;
+  if (Obj.isELF())
+    ID = getELFBuildID(Obj);
+  else if (auto *MachO = dyn_cast<MachOObjectFile>(&Obj))
+    ID = MachO->getUuid();
+  return toHex(ID);
+}
+
+SymbolizeCache::SymbolizeCache(StringRef CacheDir, StringRef Key) {
+  SmallString<128> FullPath(CacheDir);
+  sys::path::append(FullPath, "llvmcache-symbolizer-" + Key);
+  Path = FullPath.str();
+
+  auto BufOrErr = MemoryBuffer::getFile(Path, /*FileSize=*/-1,
+                                        /*RequiresNullTerminator=*/false);
+  if (!BufOrErr)
+    return;
+  CacheFileView View;
+  if (View.init((*BufOrErr)->getBuffer()))
+    Buffer = std::move(*BufOrErr);
+}
+
+Optional<DIInliningInfo> SymbolizeCache::lookupOnDisk(uint64_t Address,
+                                                      EntryKind Kind) const {
+  if (!Buffer)
+    return None;
+  CacheFileView View;
+  View.init(Buffer->getBuffer());
+  ArrayRef<FileEntry> Entries = View.entries();
+  EntryKey Key(Address, Kind);
+  auto I = std::lower_bound(Entries.begin(), Entries.end(), Key, entryLess);
+  if (I == Entries.end() || I->Address != Address || I->Kind != Kind)
+    return None;
+  return View.decode(*I);
+}
+
+Optional<DIInliningInfo> SymbolizeCache::lookup(uint64_t Address,
+                                                EntryKind Kind) const {
+  auto I = NewEntries.find(EntryKey(Address, Kind));
+  if (I != NewEntries.end())
+    return I->second;
+  return lookupOnDisk(Address, Kind);
+}
+
+Optional<DILineInfo> SymbolizeCache::lookupCode(uint64_t Address) const {
+  Optional<DIInliningInfo> Info = lookup(Address, CodeEntry);
+  if (!Info || Info->getNumberOfFrames() != 1)
+    return None;
+  return Info->getFrame(0);
+}
+
+Optional<DIInliningInfo>
+SymbolizeCache::lookupInlinedCode(uint64_t Address) const {
+  return lookup(Address, InlinedCodeEntry);
+}
+
+void SymbolizeCache::insertCode(uint64_t Address, const DILineInfo &Info) {
+  // Embedded source is not persisted; leave such results uncached rather than
+  // returning them without it later.
+  if (Info.Source)
+    return;
+  DIInliningInfo Entry;
+  Entry.addFrame(Info);
+  NewEntries[EntryKey(Address, CodeEntry)] = Entry;
+}
+
+void SymbolizeCache::insertInlinedCode(uint64_t Address,
+                                       const DIInliningInfo &Info) {
+  for (uint32_t I = 0, E = Info.getNumberOfFrames(); I != E; ++I)
+    if (Info.getFrame(I).Source)
+      return;
+  NewEntries[EntryKey(Address, InlinedCodeEntry)] = Info;
+}
+
+Error SymbolizeCache::flush() {
+  if (NewEntries.empty())
+    return Error::success();
+
+  // Another process may have updated the file since we opened it, so merge
+  // with its current contents rather than with our stale mapping.
+  std::map<EntryKey, DIInliningInfo> Merged;
+  auto BufOrErr = MemoryBuffer::getFile(Path, /*FileSize=*/-1,
+                                        /*RequiresNullTerminator=*/false);
+  if (BufOrErr) {
+    CacheFileView View;
+    if (View.init((*BufOrErr)->getBuffer()))
+      for (const FileEntry &E : View.entries())
+        if (Optional<DIInliningInfo> Info = View.decode(E))
+          Merged[EntryKey(E.Address, E.Kind)] = std::move(*Info);
+  }
+  for (auto &KV : NewEntries)
+    Merged[KV.first] = std::move(KV.second);
+  NewEntries.clear();
+
+  std::string StringTable;
+  StringMap<uint32_t> StringOffsets;
+  auto addString = [&](StringRef S) -> uint32_t {
+    auto R = StringOffsets.insert(std::make_pair(S, StringTable.size()));
+    if (R.second) {
+      StringTable += S;
+      StringTable += '\0';
+    }
+    return R.first->second;
+  };
+
+  uint32_t NumFrames = 0;
+  for (const auto &KV : Merged)
+    NumFrames += KV.second.getNumberOfFrames();
+
+  auto TempOrErr = sys::fs::TempFile::create(Path + ".%%%%%%.tmp");
+  if (!TempOrErr)
+    return TempOrErr.takeError();
+  {
+    raw_fd_ostream OS(TempOrErr->FD, /*shouldClose=*/false);
+    support::endian::Writer W(OS, support::little);
+    OS.write(CacheMagic, sizeof(CacheMagic));
+    W.write<uint32_t>(CacheVersion);
+    W.write<uint32_t>(Merged.size());
+    W.write<uint32_t>(NumFrames);
+    // The string table size is not known until the frames have been encoded,
+    // so build the frame array first.
+    std::string FrameData;
+    raw_string_ostream FrameOS(FrameData);
+    support::endian::Writer FW(FrameOS, support::little);
+    uint32_t FirstFrame = 0;
+    std::string EntryData;
+    raw_string_ostream EntryOS(EntryData);
+    support::endian::Writer EW(EntryOS, support::little);
+    for (const auto &KV : Merged) {
+      const DIInliningInfo &Info = KV.second;
+      EW.write<uint64_t>(KV.first.first);
+      EW.write<uint32_t>(KV.first.second);
+      EW.write<uint32_t>(FirstFrame);
+      EW.write<uint32_t>(Info.getNumberOfFrames());
+      EW.write<uint32_t>(0);
+      for (uint32_t I = 0, E = Info.getNumberOfFrames(); I != E; ++I) {
+        DILineInfo Frame = Info.getFrame(I);
+        FW.write<uint32_t>(addString(Frame.FunctionName));
+        FW.write<uint32_t>(addString(Frame.FileName));
+        FW.write<uint32_t>(Frame.Line);
+        FW.write<uint32_t>(Frame.Column);
+        FW.write<uint32_t>(Frame.StartLine);
+        FW.write<uint32_t>(Frame.Discriminator);
+      }
+      FirstFrame += Info.getNumberOfFrames();
+    }
+    W.write<uint32_t>(StringTable.size());
+    OS << EntryOS.str() << FrameOS.str() << StringTable;
+    OS.flush();
+    if (OS.has_error()) {
+      OS.clear_error();
+      consumeError(TempOrErr->discard());
+      return make_error<StringError>("could not write " + Path,
+                                     inconvertibleErrorCode());
+    }
+  }
+  return TempOrErr->keep(Path);
+}
@@ -11,6 +11,7 @@
 #include "llvm/Config/llvm-config.h"
 #include "llvm/ExecutionEngine/Orc/OrcError.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/ThreadPool.h"
 
 #if LLVM_ENABLE_THREADS
 #include <future>
@@ -124,6 +125,43 @@ void SymbolsNotFound::log(raw_ostream &OS) const {
   OS << "Symbols not found: " << Symbols;
 }
 
+/// Set while the current thread materializes a unit dispatched to a pool.
+static LLVM_THREAD_LOCAL bool IsPoolMaterializationThread = false;
+
+ExecutionSessionBase &
+ExecutionSessionBase::setDispatchMaterializationToThreadPool(ThreadPool &Pool) {
+  return setDispatchMaterialization(
+      [this, &Pool](VSO &V, std::unique_ptr<MaterializationUnit> MU) {
+#if LLVM_ENABLE_THREADS
+        // Each pool task runs whichever queued unit is oldest, so that
+        // threads waiting in lookup can take units off the queue too.
+        {
+          std::lock_guard<std::mutex> Lock(QueuedMaterializationsMutex);
+          QueuedMaterializations.emplace_back(&V, std::move(MU));
+        }
+        Pool.async([this]() { runQueuedMaterialization(); });
+#else
+        MU->doMaterialize(V);
+#endif
+      });
+}
+
+bool ExecutionSessionBase::runQueuedMaterialization() {
+  std::pair<VSO *, std::unique_ptr<MaterializationUnit>> Next;
+  {
+    std::lock_guard<std::mutex> Lock(QueuedMaterializationsMutex);
+    if (QueuedMaterializations.empty())
+      return false;
+    Next = std::move(QueuedMaterializations.front());
+    QueuedMaterializations.pop_front();
+  }
+  bool WasPoolMaterializationThread = IsPoolMaterializationThread;
+  IsPoolMaterializationThread = true;
+  Next.second->doMaterialize(*Next.first);
+  IsPoolMaterializationThread = WasPoolMaterializationThread;
+  return true;
+}
+
 void ExecutionSessionBase::failQuery(AsynchronousSymbolQuery &Q, Error Err) {
   bool DeliveredError = true;
   runSessionLocked([&]() -> void {
@@ -704,6 +742,29 @@ SymbolNameSet VSO::lookup(std::shared_ptr<AsynchronousSymbolQuery> Q,
   return Unresolved;
 }
 
+void VSO::lookupReady(SymbolMap &Result, SymbolNameSet &Names,
+                      SymbolNameSet &Pending) {
+  ES.runSessionLocked([&, this]() {
+    for (auto I = Names.begin(), E = Names.end(); I != E;) {
+      auto SymI = Symbols.find(*I);
+      if (SymI == Symbols.end()) {
+        ++I;
+        continue;
+      }
+
+      // Symbols found here shadow any definition in later VSOs, so they leave
+      // Names whether or not they are ready.
+      auto Flags = SymI->second.getFlags();
+      if (SymI->second.getAddress() != 0 && !Flags.isLazy() &&
+          !Flags.isMaterializing())
+        Result[*I] = SymI->second;
+      else
+        Pending.insert(*I);
+      I = Names.erase(I);
+    }
+  });
+}
+
 void VSO::dump(raw_ostream &OS) {
   ES.runSessionLocked([&, this]() {
     OS << "VSO \"" << VSOName
@@ -869,7 +930,22 @@ VSO &ExecutionSession::createVSO(std::string Name) {
   });
 }
 
-Expected<SymbolMap> lookup(const std::vector<VSO *> &VSOs, SymbolNameSet Names) {
+#if LLVM_ENABLE_THREADS
+/// Wait until \p F is ready. On a thread materializing a unit for a thread
+/// pool, run the units still queued for the pool meanwhile: the one we are
+/// waiting for may be among them, with every pool thread blocked like this one.
+template <typename T>
+static void waitForLookup(ExecutionSessionBase *ES, std::future<T> &F) {
+  if (ES && IsPoolMaterializationThread)
+    while (F.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+      if (!ES->runQueuedMaterialization())
+        F.wait_for(std::chrono::milliseconds(1));
+  F.wait();
+}
+#endif
+
+static Expected<SymbolMap> lookupWithQuery(const std::vector<VSO *> &VSOs,
+                                           SymbolNameSet Names) {
 #if LLVM_ENABLE_THREADS
   // In the threaded case we use promises to return the results.
   std::promise<SymbolMap> PromisedResult;
@@ -937,7 +1013,10 @@ Expected<SymbolMap> lookup(const std::vector<VSO *> &VSOs, SymbolNameSet Names)
   }
 
 #if LLVM_ENABLE_THREADS
+  ExecutionSessionBase *ES =
+      VSOs.empty() ? nullptr : &VSOs.front()->getExecutionSession();
   auto ResultFuture = PromisedResult.get_future();
+  waitForLookup(ES, ResultFuture);
   auto Result = ResultFuture.get();
 
   {
@@ -950,6 +1029,7 @@ Expected<SymbolMap> lookup(const std::vector<VSO *> &VSOs, SymbolNameSet Names)
   }
 
   auto ReadyFuture = PromisedReady.get_future();
+  waitForLookup(ES, ReadyFuture);
   ReadyFuture.get();
 
   {
@@ -974,6 +1054,34 @@ Expected<SymbolMap> lookup(const std::vector<VSO *> &VSOs, SymbolNameSet Names)
 #endif
 }
 
+Expected<SymbolMap> lookup(const std::vector<VSO *> &VSOs, SymbolNameSet Names) {
+  SymbolMap Result;
+  SymbolNameSet Pending;
+
+  for (auto *V : VSOs) {
+    assert(V && "VSO pointers in VSOs list should be non-null");
+    if (Names.empty())
+      break;
+    V->lookupReady(Result, Names, Pending);
+  }
+
+  if (Names.empty() && Pending.empty())
+    return std::move(Result);
+
+  // Anything not yet ready, and anything not found (so that the error comes
+  // from the usual path), is looked up with a query. The query searches the
+  // VSOs in the same order, so pending symbols resolve to the definitions
+  // that shadowed them above.
+  Names.insert(Pending.begin(), Pending.end());
+  auto QueryResult = lookupWithQuery(VSOs, std::move(Names));
+  if (!QueryResult)
+    return QueryResult.takeError();
+
+  for (auto &KV : *QueryResult)
+    Result[KV.first] = std::move(KV.second);
+  return std::move(Result);
+}
+
 /// Look up a symbol by searching a list of VSOs.
 Expected<JITEvaluatedSymbol> lookup(const std::vector<VSO *> VSOs,
                                     SymbolStringPtr Name) {
@@ -22,8 +22,8 @@ JITSymbolResolverAdapter::lookup(const LookupSet &Symbols) {
   JITSymbolResolver::LookupResult Result;
 
   SymbolNameSet InternedSymbols;
-  for (auto &S : Symbols)
-    InternedSymbols.insert(ES.getSymbolStringPool().intern(S));
+  ES.getSymbolStringPool().intern(
+      Symbols, std::inserter(InternedSymbols, InternedSymbols.end()));
 
   auto OnResolve =
       [&, this](Expected<AsynchronousSymbolQuery::ResolutionResult> RR) {
@@ -73,8 +73,8 @@ JITSymbolResolverAdapter::lookup(const LookupSet &Symbols) {
 Expected<JITSymbolResolverAdapter::LookupFlagsResult>
 JITSymbolResolverAdapter::lookupFlags(const LookupSet &Symbols) {
   SymbolNameSet InternedSymbols;
-  for (auto &S : Symbols)
-    InternedSymbols.insert(ES.getSymbolStringPool().intern(S));
+  ES.getSymbolStringPool().intern(
+      Symbols, std::inserter(InternedSymbols, InternedSymbols.end()));
 
   SymbolFlagsMap SymbolFlags;
   R.lookupFlags(SymbolFlags, InternedSymbols);
@@ -0,0 +1,173 @@
+//===- PersistentObjectCache.cpp - On-disk object cache for ORC -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/PersistentObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/raw_sha1_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+/// Hash everything about \p TM that affects the object code it produces.
+static std::string computeTargetKey(const TargetMachine &TM) {
+  SHA1 Hasher;
+
+  Hasher.update(LLVM_VERSION_STRING);
+
+  auto AddString = [&](StringRef Str) {
+    Hasher.update(Str);
+    Hasher.update(ArrayRef<uint8_t>{0});
+  };
+  auto AddUnsigned = [&](unsigned I) {
+    uint8_t Data[4];
+    Data[0] = I;
+    Data[1] = I >> 8;
+    Data[2] = I >> 16;
+    Data[3] = I >> 24;
+    Hasher.update(ArrayRef<uint8_t>{Data, 4});
+  };
+
+  AddString(TM.getTargetTriple().str());
+  AddString(TM.getTargetCPU());
+  AddString(TM.getTargetFeatureString());
+  AddUnsigned(TM.getRelocationModel());
+  AddUnsigned(TM.getCodeModel());
+  AddUnsigned(TM.getOptLevel());
+
+  const TargetOptions &Options = TM.Options;
+  AddUnsigned(Options.UnsafeFPMath);
+  AddUnsigned(Options.NoInfsFPMath);
+  AddUnsigned(Options.NoNaNsFPMath);
+  AddUnsigned(Options.NoTrappingFPMath);
+  AddUnsigned(Options.NoSignedZerosFPMath);
+  AddUnsigned(Options.HonorSignDependentRoundingFPMathOption);
+  AddUnsigned(Options.NoZerosInBSS);
+  AddUnsigned(Options.GuaranteedTailCallOpt);
+  AddUnsigned(Options.StackAlignmentOverride);
+  AddUnsigned(Options.StackSymbolOrdering);
+  AddUnsigned(Options.EnableFastISel);
+  AddUnsigned(Options.EnableGlobalISel);
+  AddUnsigned(Options.UseInitArray);
+  AddUnsigned(Options.RelaxELFRelocations);
+  AddUnsigned(Options.FunctionSections);
+  AddUnsigned(Options.DataSections);
+  AddUnsigned(Options.UniqueSectionNames);
+  AddUnsigned(Options.TrapUnreachable);
+  AddUnsigned(Options.EmulatedTLS);
+  AddUnsigned(Options.EnableIPRA);
+  AddUnsigned(Options.EmitStackSizeSection);
+  AddUnsigned((unsigned)Options.FloatABIType);
+  AddUnsigned((unsigned)Options.AllowFPOpFusion);
+  AddUnsigned((unsigned)Options.ThreadModel);
+  AddUnsigned((unsigned)Options.EABIVersion);
+  AddUnsigned((unsigned)Options.DebuggerTuning);
+  AddUnsigned((unsigned)Options.FPDenormalMode);
+  AddUnsigned((unsigned)Options.ExceptionModel);
+
+  return toHex(Hasher.result());
+}
+
+Expected<std::unique_ptr<PersistentObjectCache>>
+PersistentObjectCache::Create(StringRef CacheDir, const TargetMachine &TM) {
+  if (std::error_code EC = sys::fs::create_directories(CacheDir))
+    return errorCodeToError(EC);
+  return std::unique_ptr<PersistentObjectCache>(
+      new PersistentObjectCache(CacheDir, computeTargetKey(TM)));
+}
+
+std::string PersistentObjectCache::getKey(const Module &M) const {
+  raw_sha1_ostream Hasher;
+  Hasher << TargetKey;
+  WriteBitcodeToFile(M, Hasher);
+  return toHex(Hasher.sha1());
+}
+
+std::string PersistentObjectCache::getEntryPath(StringRef Key) const {
+  // This choice of file name allows the cache to be pruned (see pruneCache()
+  // in include/llvm/Support/CachePruning.h).
+  SmallString<128> EntryPath;
+  sys::path::append(EntryPath, CacheDir, "llvmcache-orc-" + Key);
+  return EntryPath.str();
+}
+
+std::unique_ptr<MemoryBuffer>
+PersistentObjectCache::getObject(const Module *M) {
+  std::string Key = getKey(*M);
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+      MemoryBuffer::getFile(getEntryPath(Key), /*FileSize=*/-1,
+                            /*RequiresNullTerminator=*/false);
+
+  // Every lookup replaces or drops the key remembered for this address. A
+  // module that missed but was never compiled (e.g. because codegen failed)
+  // leaves its key behind, and a later module allocated at the same address
+  // must not pick it up.
+  std::lock_guard<std::mutex> Lock(PendingKeysMutex);
+  if (MBOrErr) {
+    ++NumHits;
+    PendingKeys.erase(M);
+    return std::move(*MBOrErr);
+  }
+
+  // A missing or unreadable entry is a miss. Remember the key so that the
+  // object can be stored without hashing the module again.
+  ++NumMisses;
+  PendingKeys[M] = std::move(Key);
+  return nullptr;
+}
+
+void PersistentObjectCache::notifyObjectCompiled(const Module *M,
+                                                 MemoryBufferRef Obj) {
+  std::string Key;
+  {
+    std::lock_guard<std::mutex> Lock(PendingKeysMutex);
+    auto I = PendingKeys.find(M);
+    if (I != PendingKeys.end()) {
+      Key = std::move(I->second);
+      PendingKeys.erase(I);
+    }
+  }
+  if (Key.empty())
+    Key = getKey(*M);
+
+  // Write to a temporary and rename it into place, so that concurrent readers
+  // never see a partial object. Failing to store an object only costs a later
+  // recompilation, so errors are dropped.
+  SmallString<128> TempFileModel;
+  sys::path::append(TempFileModel, CacheDir, "orc-%%%%%%.tmp.o");
+  Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(
+      TempFileModel, sys::fs::owner_read | sys::fs::owner_write);
+  if (!Temp) {
+    consumeError(Temp.takeError());
+    return;
+  }
+
+  {
+    raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    OS << Obj.getBuffer();
+    OS.flush();
+    if (OS.has_error()) {
+      OS.clear_error();
+      consumeError(Temp->discard());
+      return;
+    }
+  }
+
+  // keep() removes the temporary if it cannot be renamed.
+  consumeError(Temp->keep(getEntryPath(Key)));
+}
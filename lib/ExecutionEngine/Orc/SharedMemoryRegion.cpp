@@ -0,0 +1,155 @@
+//===- SharedMemoryRegion.cpp - Memory shared between processes -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/SharedMemoryRegion.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+#include <atomic>
+
+#ifdef LLVM_ON_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+using namespace llvm::orc;
+
+static Error makeSharedMemoryError(const Twine &What, int Errno) {
+  return make_error<StringError>(
+      What, std::error_code(Errno, std::generic_category()));
+}
+
+bool SharedMemoryRegion::isSupported() {
+#ifdef LLVM_ON_UNIX
+  return true;
+#else
+  return false;
+#endif
+}
+
+#ifdef LLVM_ON_UNIX
+
+/// Map \p Size bytes of the shared memory object open as \p FD, then close it.
+static Expected<sys::MemoryBlock> mapAndClose(int FD, StringRef Name,
+                                              uint64_t Size) {
+  void *Addr =
+      ::mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, FD, 0);
+  int MapErrno = errno;
+  ::close(FD);
+  if (Addr == MAP_FAILED)
+    return makeSharedMemoryError("cannot map shared memory " + Name, MapErrno);
+  return sys::MemoryBlock(Addr, Size);
+}
+
+Expected<SharedMemoryRegion> SharedMemoryRegion::create(uint64_t Size) {
+  static std::atomic<unsigned> NextId(0);
+
+  Size = alignTo(std::max<uint64_t>(Size, 1), sys::Process::getPageSize());
+
+  std::string Name;
+  int FD = -1;
+  do {
+    Name = ("/llvm-orc-" + Twine(::getpid()) + "-" + Twine(NextId++)).str();
+    FD = ::shm_open(Name.c_str(), O_RDWR | O_CREAT | O_EXCL,
+                    S_IRUSR | S_IWUSR);
+  } while (FD == -1 && errno == EEXIST);
+  if (FD == -1)
+    return makeSharedMemoryError("cannot create shared memory " + Name, errno);
+
+  if (::ftruncate(FD, Size) == -1) {
+    int TruncErrno = errno;
+    ::close(FD);
+    ::shm_unlink(Name.c_str());
+    return makeSharedMemoryError("cannot resize shared memory " + Name,
+                                 TruncErrno);
+  }
+
+  auto MBOrErr = mapAndClose(FD, Name, Size);
+  if (!MBOrErr) {
+    ::shm_unlink(Name.c_str());
+    return MBOrErr.takeError();
+  }
+  return SharedMemoryRegion(std::move(Name), *MBOrErr, true);
+}
+
+Expected<SharedMemoryRegion> SharedMemoryRegion::open(StringRef Name,
+                                                      uint64_t Size) {
+  std::string NameStr = Name;
+  int FD = ::shm_open(NameStr.c_str(), O_RDWR, 0);
+  if (FD == -1)
+    return makeSharedMemoryError("cannot open shared memory " + Name, errno);
+
+  auto MBOrErr = mapAndClose(FD, Name, Size);
+  if (!MBOrErr)
+    return MBOrErr.takeError();
+  return SharedMemoryRegion(std::move(NameStr), *MBOrErr, true);
+}
+
+Error SharedMemoryRegion::unlink() {
+  if (!Linked)
+    return Error::success();
+  Linked = false;
+  if (::shm_unlink(Name.c_str()) == -1 && errno != ENOENT)
+    return makeSharedMemoryError("cannot unlink shared memory " + Name, errno);
+  return Error::success();
+}
+
+void SharedMemoryRegion::release() {
+  if (MB.base())
+    ::munmap(MB.base(), MB.size());
+  MB = sys::MemoryBlock();
+}
+
+#else
+
+Expected<SharedMemoryRegion> SharedMemoryRegion::create(uint64_t Size) {
+  return makeSharedMemoryError("shared memory is not supported on this host",
+                               ENOSYS);
+}
+
+Expected<SharedMemoryRegion> SharedMemoryRegion::open(StringRef Name,
+                                                      uint64_t Size) {
+  return makeSharedMemoryError("shared memory is not supported on this host",
+                               ENOSYS);
+}
+
+Error SharedMemoryRegion::unlink() { return Error::success(); }
+
+void SharedMemoryRegion::release() {}
+
+#endif
+
+SharedMemoryRegion::SharedMemoryRegion(SharedMemoryRegion &&Other)
+    : Name(std::move(Other.Name)), MB(Other.MB), Linked(Other.Linked) {
+  Other.MB = sys::MemoryBlock();
+  Other.Linked = false;
+}
+
+SharedMemoryRegion &SharedMemoryRegion::operator=(SharedMemoryRegion &&Other) {
+  if (this != &Other) {
+    consumeError(unlink());
+    release();
+    Name = std::move(Other.Name);
+    MB = Other.MB;
+    Linked = Other.Linked;
+    Other.MB = sys::MemoryBlock();
+    Other.Linked = false;
+  }
+  return *this;
+}
+
+SharedMemoryRegion::~SharedMemoryRegion() {
+  consumeError(unlink());
+  release();
+}
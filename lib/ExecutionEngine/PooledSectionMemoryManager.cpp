@@ -0,0 +1,375 @@
+//===- PooledSectionMemoryManager.cpp - Pooled JIT memory manager ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements JITMemoryPool and PooledSectionMemoryManager.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/PooledSectionMemoryManager.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+
+namespace llvm {
+
+void JITMemoryPool::Statistics::print(raw_ostream &OS) const {
+  OS << "JIT memory pool: " << NumSlabs << " slabs, " << BytesMapped
+     << " bytes mapped\n"
+     << "  in use: " << BytesInUse << " bytes (peak " << PeakBytesInUse
+     << ")\n"
+     << "  released for reuse: " << BytesReleased << " bytes\n"
+     << "  map/protect/unmap calls: " << NumMapCalls << "/" << NumProtectCalls
+     << "/" << NumUnmapCalls << "\n";
+}
+
+JITMemoryPool::JITMemoryPool(SectionMemoryManager::MemoryMapper *MM,
+                             size_t SlabSize)
+    : MM(MM), PageSize(sys::Process::getPageSize()),
+      SlabSize(alignTo(std::max<size_t>(SlabSize, 1), PageSize)) {}
+
+JITMemoryPool::~JITMemoryPool() {
+  for (auto &List : Slabs)
+    for (auto &S : List)
+      unmapSlab(*S);
+}
+
+void JITMemoryPool::unmapSlab(Slab &S) {
+  if (MM)
+    MM->releaseMappedMemory(S.MB);
+  else
+    sys::Memory::releaseMappedMemory(S.MB);
+}
+
+sys::MemoryBlock JITMemoryPool::allocateFromSlab(Slab &S, size_t NumBytes) {
+  for (auto I = S.FreeRuns.begin(), E = S.FreeRuns.end(); I != E; ++I) {
+    if (I->second < NumBytes)
+      continue;
+    uintptr_t Addr = I->first;
+    size_t Remaining = I->second - NumBytes;
+    S.FreeRuns.erase(I);
+    if (Remaining)
+      S.FreeRuns[Addr + NumBytes] = Remaining;
+    S.FreeBytes -= NumBytes;
+    return sys::MemoryBlock(reinterpret_cast<void *>(Addr), NumBytes);
+  }
+  return sys::MemoryBlock();
+}
+
+sys::MemoryBlock JITMemoryPool::allocate(AllocationPurpose Purpose,
+                                         size_t NumBytes,
+                                         std::error_code &EC) {
+  EC = std::error_code();
+  NumBytes = alignTo(std::max<size_t>(NumBytes, 1), PageSize);
+
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  auto &List = Slabs[static_cast<unsigned>(Purpose)];
+
+  sys::MemoryBlock Result;
+  for (auto &S : List)
+    if (S->FreeBytes >= NumBytes) {
+      Result = allocateFromSlab(*S, NumBytes);
+      if (Result.base())
+        break;
+    }
+
+  if (!Result.base()) {
+    // Nothing free is large enough. Map a new slab next to the last one.
+    size_t MapSize = std::max(SlabSize, NumBytes);
+    const sys::MemoryBlock *Near = List.empty() ? nullptr : &List.back()->MB;
+    unsigned Flags = sys::Memory::MF_READ | sys::Memory::MF_WRITE;
+    sys::MemoryBlock MB =
+        MM ? MM->allocateMappedMemory(Purpose, MapSize, Near, Flags, EC)
+           : sys::Memory::allocateMappedMemory(MapSize, Near, Flags, EC);
+    ++Stats.NumMapCalls;
+    if (EC)
+      return sys::MemoryBlock();
+
+    assert(reinterpret_cast<uintptr_t>(MB.base()) % PageSize == 0 &&
+           "Mapped memory should be page aligned");
+    auto S = llvm::make_unique<Slab>();
+    S->MB = MB;
+    S->FreeBytes = alignDown(MB.size(), PageSize);
+    S->FreeRuns[reinterpret_cast<uintptr_t>(MB.base())] = S->FreeBytes;
+    ++Stats.NumSlabs;
+    Stats.BytesMapped += MB.size();
+
+    Result = allocateFromSlab(*S, NumBytes);
+    assert(Result.base() && "New slab should satisfy the request");
+    List.push_back(std::move(S));
+  }
+
+  Stats.BytesInUse += Result.size();
+  Stats.PeakBytesInUse = std::max(Stats.PeakBytesInUse, Stats.BytesInUse);
+  return Result;
+}
+
+std::error_code JITMemoryPool::protect(const sys::MemoryBlock &Block,
+                                       unsigned Flags) {
+  {
+    std::lock_guard<std::mutex> Lock(PoolMutex);
+    ++Stats.NumProtectCalls;
+  }
+  return MM ? MM->protectMappedMemory(Block, Flags)
+            : sys::Memory::protectMappedMemory(Block, Flags);
+}
+
+JITMemoryPool::Slab *JITMemoryPool::findSlab(AllocationPurpose Purpose,
+                                             uintptr_t Addr) {
+  for (auto &S : Slabs[static_cast<unsigned>(Purpose)]) {
+    uintptr_t Base = reinterpret_cast<uintptr_t>(S->MB.base());
+    if (Addr >= Base && Addr < Base + S->MB.size())
+      return S.get();
+  }
+  return nullptr;
+}
+
+std::error_code JITMemoryPool::release(AllocationPurpose Purpose,
+                                       const sys::MemoryBlock &Block,
+                                       bool Reprotect) {
+  if (Block.size() == 0)
+    return std::error_code();
+
+  if (Reprotect)
+    if (auto EC =
+            protect(Block, sys::Memory::MF_READ | sys::Memory::MF_WRITE))
+      return EC;
+
+  uintptr_t Addr = reinterpret_cast<uintptr_t>(Block.base());
+  size_t Size = Block.size();
+  assert(Addr % PageSize == 0 && Size % PageSize == 0 &&
+         "Released blocks should be whole pages");
+
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  Slab *S = findSlab(Purpose, Addr);
+  assert(S && "Released block was not allocated from this pool");
+  S->FreeBytes += Size;
+  Stats.BytesInUse -= Size;
+  Stats.BytesReleased += Size;
+
+  // Insert the run, merging it with its neighbours.
+  auto Next = S->FreeRuns.lower_bound(Addr);
+  assert((Next == S->FreeRuns.end() || Next->first >= Addr + Size) &&
+         "Released block overlaps a free run");
+  if (Next != S->FreeRuns.begin()) {
+    auto Prev = std::prev(Next);
+    assert(Prev->first + Prev->second <= Addr &&
+           "Released block overlaps a free run");
+    if (Prev->first + Prev->second == Addr) {
+      Addr = Prev->first;
+      Size += Prev->second;
+      S->FreeRuns.erase(Prev);
+    }
+  }
+  if (Next != S->FreeRuns.end() && Next->first == Addr + Size) {
+    Size += Next->second;
+    S->FreeRuns.erase(Next);
+  }
+  S->FreeRuns[Addr] = Size;
+
+  return std::error_code();
+}
+
+void JITMemoryPool::releaseFreeSlabs() {
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  for (auto &List : Slabs) {
+    auto IsFree = [&](const std::unique_ptr<Slab> &S) {
+      return S->FreeBytes == alignDown(S->MB.size(), PageSize);
+    };
+    for (auto &S : List) {
+      if (!IsFree(S))
+        continue;
+      unmapSlab(*S);
+      ++Stats.NumUnmapCalls;
+      --Stats.NumSlabs;
+      Stats.BytesMapped -= S->MB.size();
+    }
+    List.erase(remove_if(List, IsFree), List.end());
+  }
+}
+
+JITMemoryPool::Statistics JITMemoryPool::getStatistics() const {
+  std::lock_guard<std::mutex> Lock(PoolMutex);
+  return Stats;
+}
+
+PooledSectionMemoryManager::PooledSectionMemoryManager(
+    std::shared_ptr<JITMemoryPool> Pool)
+    : Pool(std::move(Pool)) {
+  assert(this->Pool && "PooledSectionMemoryManager requires a pool");
+}
+
+PooledSectionMemoryManager::~PooledSectionMemoryManager() {
+  for (auto Purpose : {AllocationPurpose::Code, AllocationPurpose::ROData,
+                       AllocationPurpose::RWData}) {
+    // Finalized code and read-only data pages must be made writable again
+    // before they can be reused.
+    bool Reprotect = Purpose != AllocationPurpose::RWData;
+    for (auto &Run : getGroup(Purpose).Runs)
+      Pool->release(Purpose, Run, Reprotect);
+  }
+}
+
+PooledSectionMemoryManager::MemoryGroup &
+PooledSectionMemoryManager::getGroup(AllocationPurpose Purpose) {
+  switch (Purpose) {
+  case AllocationPurpose::Code:
+    return CodeMem;
+  case AllocationPurpose::ROData:
+    return RODataMem;
+  case AllocationPurpose::RWData:
+    return RWDataMem;
+  }
+  llvm_unreachable("Unknown SectionMemoryManager::AllocationPurpose");
+}
+
+uint8_t *PooledSectionMemoryManager::allocateCodeSection(
+    uintptr_t Size, unsigned Alignment, unsigned SectionID,
+    StringRef SectionName) {
+  return allocateSection(AllocationPurpose::Code, Size, Alignment);
+}
+
+uint8_t *PooledSectionMemoryManager::allocateDataSection(
+    uintptr_t Size, unsigned Alignment, unsigned SectionID,
+    StringRef SectionName, bool IsReadOnly) {
+  return allocateSection(IsReadOnly ? AllocationPurpose::ROData
+                                    : AllocationPurpose::RWData,
+                         Size, Alignment);
+}
+
+void PooledSectionMemoryManager::releaseUnusedPages(AllocationPurpose Purpose,
+                                                    MemoryGroup &G) {
+  uintptr_t FirstUnused = alignTo(G.Cur, Pool->getPageSize());
+  if (FirstUnused >= G.End)
+    return;
+
+  Pool->release(Purpose,
+                sys::MemoryBlock(reinterpret_cast<void *>(FirstUnused),
+                                 G.End - FirstUnused),
+                /*Reprotect=*/false);
+  sys::MemoryBlock &Run = G.Runs.back();
+  Run = sys::MemoryBlock(Run.base(),
+                         FirstUnused - reinterpret_cast<uintptr_t>(Run.base()));
+  G.End = FirstUnused;
+}
+
+uint8_t *PooledSectionMemoryManager::allocateSection(AllocationPurpose Purpose,
+                                                     uintptr_t Size,
+                                                     unsigned Alignment) {
+  if (!Alignment)
+    Alignment = 16;
+
+  assert(!(Alignment & (Alignment - 1)) && "Alignment must be a power of two.");
+
+  MemoryGroup &G = getGroup(Purpose);
+  uintptr_t Addr = alignTo(G.Cur, Alignment);
+
+  if (G.Runs.empty() || Addr + Size > G.End) {
+    // The current run is full. Remember what was handed out from it, give its
+    // untouched pages back and take a new run from the pool.
+    if (!G.Runs.empty()) {
+      if (G.Cur != G.PendingBegin)
+        G.Pending.push_back(sys::MemoryBlock(
+            reinterpret_cast<void *>(G.PendingBegin), G.Cur - G.PendingBegin));
+      releaseUnusedPages(Purpose, G);
+    }
+
+    std::error_code EC;
+    sys::MemoryBlock Run = Pool->allocate(Purpose, Size + Alignment, EC);
+    if (EC) {
+      // FIXME: Add error propagation to the interface.
+      return nullptr;
+    }
+
+    G.Runs.push_back(Run);
+    G.Cur = G.PendingBegin = reinterpret_cast<uintptr_t>(Run.base());
+    G.End = G.Cur + Run.size();
+    Addr = alignTo(G.Cur, Alignment);
+  }
+
+  G.Cur = Addr + Size;
+  return reinterpret_cast<uint8_t *>(Addr);
+}
+
+std::error_code
+PooledSectionMemoryManager::finalizeGroup(AllocationPurpose Purpose,
+                                          unsigned Flags) {
+  MemoryGroup &G = getGroup(Purpose);
+  if (G.Cur != G.PendingBegin)
+    G.Pending.push_back(sys::MemoryBlock(
+        reinterpret_cast<void *>(G.PendingBegin), G.Cur - G.PendingBegin));
+  if (G.Pending.empty())
+    return std::error_code();
+
+  if (Purpose == AllocationPurpose::Code)
+    for (auto &MB : G.Pending)
+      sys::Memory::InvalidateInstructionCache(MB.base(), MB.size());
+
+  if (Purpose != AllocationPurpose::RWData) {
+    // Every pending block starts on a page boundary. Round them up to whole
+    // pages and merge adjacent ones, so that runs that happen to be
+    // contiguous are protected with a single call.
+    size_t PageSize = Pool->getPageSize();
+    llvm::sort(G.Pending.begin(), G.Pending.end(),
+               [](const sys::MemoryBlock &LHS, const sys::MemoryBlock &RHS) {
+                 return LHS.base() < RHS.base();
+               });
+    uintptr_t SpanBegin = 0, SpanEnd = 0;
+    for (auto &MB : G.Pending) {
+      uintptr_t Begin = reinterpret_cast<uintptr_t>(MB.base());
+      uintptr_t End = alignTo(Begin + MB.size(), PageSize);
+      if (SpanEnd == Begin) {
+        SpanEnd = End;
+        continue;
+      }
+      if (SpanEnd != SpanBegin)
+        if (auto EC = Pool->protect(
+                sys::MemoryBlock(reinterpret_cast<void *>(SpanBegin),
+                                 SpanEnd - SpanBegin),
+                Flags))
+          return EC;
+      SpanBegin = Begin;
+      SpanEnd = End;
+    }
+    if (auto EC = Pool->protect(
+            sys::MemoryBlock(reinterpret_cast<void *>(SpanBegin),
+                             SpanEnd - SpanBegin),
+            Flags))
+      return EC;
+
+    // The rest of the last page is no longer writable. Continue on the next
+    // page and give the unused ones back.
+    releaseUnusedPages(Purpose, G);
+    G.Cur = G.End;
+  }
+
+  G.Pending.clear();
+  G.PendingBegin = G.Cur;
+  return std::error_code();
+}
+
+bool PooledSectionMemoryManager::finalizeMemory(std::string *ErrMsg) {
+  std::error_code EC = finalizeGroup(
+      AllocationPurpose::Code, sys::Memory::MF_READ | sys::Memory::MF_EXEC);
+  if (!EC)
+    EC = finalizeGroup(AllocationPurpose::ROData, sys::Memory::MF_READ);
+  // Read-write data keeps its permissions; this only closes its pending list.
+  if (!EC)
+    EC = finalizeGroup(AllocationPurpose::RWData, 0);
+
+  if (EC) {
+    if (ErrMsg)
+      *ErrMsg = EC.message();
+    return true;
+  }
+  return false;
+}
+
+} // namespace llvm
@@ -16,6 +16,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
@@ -38,6 +39,20 @@ LLVMContext &BasicBlock::getContext() const {
 // are not in the public header file...
 template class llvm::SymbolTableListTraits<Instruction>;
 
+void *BasicBlock::operator new(size_t Size) {
+  IRArena *Arena = IRArena::getActive();
+  void *Storage =
+      Arena ? Arena->Allocate(Size, alignof(BasicBlock)) : ::operator new(Size);
+  static_cast<BasicBlock *>(Storage)->IsArenaAllocated = Arena != nullptr;
+  return Storage;
+}
+
+void BasicBlock::operator delete(void *Ptr) {
+  // Arena storage is released all at once with the arena.
+  if (!static_cast<BasicBlock *>(Ptr)->IsArenaAllocated)
+    ::operator delete(Ptr);
+}
+
 BasicBlock::BasicBlock(LLVMContext &C, const Twine &Name, Function *NewParent,
                        BasicBlock *InsertBefore)
   : Value(Type::getLabelTy(C), Value::BasicBlockVal), Parent(nullptr) {
@@ -0,0 +1,28 @@
+//===- IRArena.cpp - Arena allocation of IR objects -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/IRArena.h"
+#include "llvm/Support/Compiler.h"
+#include <cassert>
+
+using namespace llvm;
+
+static LLVM_THREAD_LOCAL IRArena *ActiveArena = nullptr;
+
+IRArena::~IRArena() {
+  assert(ActiveArena != this && "Destroying an arena that is in scope!");
+}
+
+IRArena *IRArena::getActive() { return ActiveArena; }
+
+IRArena::Scope::Scope(IRArena &Arena) : Prev(ActiveArena) {
+  ActiveArena = &Arena;
+}
+
+IRArena::Scope::~Scope() { ActiveArena = Prev; }
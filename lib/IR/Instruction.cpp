@@ -14,12 +14,25 @@
 #include "llvm/IR/Instruction.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/Type.h"
 using namespace llvm;
 
+void *Instruction::operator new(size_t Size) {
+  return allocateHungOffUser(Size, IRArena::getActive());
+}
+
+void *Instruction::operator new(size_t Size, unsigned Us) {
+  return allocateUser(Size, Us, 0, IRArena::getActive());
+}
+
+void *Instruction::operator new(size_t Size, unsigned Us, unsigned DescBytes) {
+  return allocateUser(Size, Us, DescBytes, IRArena::getActive());
+}
+
 Instruction::Instruction(Type *ty, unsigned it, Use *Ops, unsigned NumOps,
                          Instruction *InsertBefore)
   : User(ty, Value::InstructionVal + it, Ops, NumOps), Parent(nullptr) {
@@ -27,6 +27,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -801,7 +802,10 @@ const PassInfo *PMTopLevelManager::findAnalysisPassInfo(AnalysisID AID) const {
 void PMTopLevelManager::addImmutablePass(ImmutablePass *P) {
   P->initializePass();
   ImmutablePasses.push_back(P);
+  addSharedImmutablePass(P);
+}
 
+void PMTopLevelManager::addSharedImmutablePass(ImmutablePass *P) {
   // Add this pass to the map from its analysis ID. We clobber any prior runs
   // of the pass in the map so that the last one added is the one found when
   // doing lookups.
@@ -1443,6 +1447,10 @@ void FunctionPassManager::add(Pass *P) {
   FPM->add(P);
 }
 
+void FunctionPassManager::addSharedImmutablePass(ImmutablePass *P) {
+  FPM->addSharedImmutablePass(P);
+}
+
 /// run - Execute all of the passes scheduled for execution.  Keep
 /// track of whether any of the passes modifies the function, and if
 /// so, return true.
@@ -1577,6 +1585,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      TimeTraceScope PassScope(FP->getPassName(), F.getName());
       unsigned InstrCount = initSizeRemarkInfo(M);
       LocalChanged |= FP->runOnFunction(F);
       emitInstrCountChangedRemark(FP, M, InstrCount);
@@ -1655,6 +1664,7 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      TimeTraceScope PassScope(MP->getPassName(), M.getModuleIdentifier());
 
       unsigned InstrCount = initSizeRemarkInfo(M);
       LocalChanged |= MP->runOnModule(M);
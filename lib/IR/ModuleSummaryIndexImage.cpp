@@ -0,0 +1,471 @@
+//===-- ModuleSummaryIndexImage.cpp - Mappable summary index --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the writer and the in-place reader of the summary
+// index image format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/ModuleSummaryIndexImage.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace llvm;
+using namespace llvm::summaryimage;
+
+static_assert(sizeof(Header) == 48, "unexpected header size");
+static_assert(sizeof(ModuleRecord) == 40, "unexpected module record size");
+static_assert(sizeof(ValueRecord) == 16, "unexpected value record size");
+static_assert(sizeof(SummaryRecord) == 48, "unexpected summary record size");
+static_assert(sizeof(EdgeRecord) == 16, "unexpected edge record size");
+static_assert(sizeof(NameRecord) == 8, "unexpected name record size");
+
+static Error makeImageError(const Twine &Message) {
+  return make_error<StringError>("Invalid summary index image: " + Message,
+                                 inconvertibleErrorCode());
+}
+
+//===----------------------------------------------------------------------===//
+// Reader
+//===----------------------------------------------------------------------===//
+
+GlobalValueSummary::GVFlags ModuleSummaryIndexImage::Summary::flags() const {
+  uint32_t F = R->Flags;
+  return GlobalValueSummary::GVFlags(GlobalValue::LinkageTypes(F & 0xf),
+                                     (F >> 4) & 1, (F >> 5) & 1, (F >> 6) & 1);
+}
+
+FunctionSummary::FFlags ModuleSummaryIndexImage::Summary::fflags() const {
+  uint32_t F = R->FunFlags;
+  FunctionSummary::FFlags FunFlags;
+  FunFlags.ReadNone = F & 1;
+  FunFlags.ReadOnly = (F >> 1) & 1;
+  FunFlags.NoRecurse = (F >> 2) & 1;
+  FunFlags.ReturnDoesNotAlias = (F >> 3) & 1;
+  return FunFlags;
+}
+
+bool ModuleSummaryIndexImage::isImage(StringRef Buffer) {
+  return Buffer.size() >= sizeof(Magic) &&
+         std::memcmp(Buffer.data(), Magic, sizeof(Magic)) == 0;
+}
+
+/// Reads the \p Count records of type T at \p Offset into \p Data, and
+/// advances \p Offset past them, to the next 8-byte boundary.
+template <typename T>
+static Error readSection(StringRef Data, uint64_t &Offset, uint64_t Count,
+                         ArrayRef<T> &Records, const char *Name) {
+  uint64_t Size = Count * sizeof(T);
+  if (Offset + Size > Data.size())
+    return makeImageError(Twine(Name) + " section is truncated");
+  Records = makeArrayRef(reinterpret_cast<const T *>(Data.data() + Offset),
+                         Count);
+  Offset = alignTo(Offset + Size, 8);
+  return Error::success();
+}
+
+Expected<ModuleSummaryIndexImage>
+ModuleSummaryIndexImage::create(MemoryBufferRef Buffer) {
+  StringRef Data = Buffer.getBuffer();
+  if (!isImage(Data) || Data.size() < sizeof(Header))
+    return makeImageError("missing header");
+  if (reinterpret_cast<uintptr_t>(Data.data()) % 8 != 0)
+    return makeImageError("buffer is not 8-byte aligned");
+
+  ModuleSummaryIndexImage Image;
+  Image.Hdr = reinterpret_cast<const Header *>(Data.data());
+  if (Image.Hdr->Version != summaryimage::Version)
+    return makeImageError("unsupported version " +
+                          Twine(uint32_t(Image.Hdr->Version)));
+
+  uint64_t Offset = sizeof(Header);
+  const Header &H = *Image.Hdr;
+  if (Error E = readSection(Data, Offset, H.NumModules, Image.Modules,
+                            "module"))
+    return std::move(E);
+  if (Error E = readSection(Data, Offset, H.NumValues, Image.Values, "value"))
+    return std::move(E);
+  if (Error E = readSection(Data, Offset, H.NumSummaries, Image.Summaries,
+                            "summary"))
+    return std::move(E);
+  if (Error E = readSection(Data, Offset, H.NumEdges, Image.Edges, "edge"))
+    return std::move(E);
+  if (Error E = readSection(
+          Data, Offset,
+          uint64_t(H.NumCfiFunctionDefs) + uint64_t(H.NumCfiFunctionDecls),
+          Image.CfiFunctionNames, "name"))
+    return std::move(E);
+  if (Offset + H.StringTableSize > Data.size())
+    return makeImageError("string table is truncated");
+  Image.StringTable = Data.substr(Offset, H.StringTableSize);
+
+  // Validate every cross reference once, so that queries do not need to.
+  auto CheckString = [&](uint32_t StrOffset, uint32_t Size) {
+    return uint64_t(StrOffset) + Size <= Image.StringTable.size();
+  };
+  for (const ModuleRecord &M : Image.Modules)
+    if (!CheckString(M.PathOffset, M.PathSize))
+      return makeImageError("module path out of range");
+  for (const NameRecord &N : Image.CfiFunctionNames)
+    if (!CheckString(N.Offset, N.Size))
+      return makeImageError("CFI function name out of range");
+  uint64_t PrevGUID = 0;
+  for (const ValueRecord &V : Image.Values) {
+    if (&V != Image.Values.begin() && V.GUID <= PrevGUID)
+      return makeImageError("values are not sorted");
+    PrevGUID = V.GUID;
+    if (uint64_t(V.FirstSummary) + V.NumSummaries > Image.Summaries.size())
+      return makeImageError("summary index out of range");
+  }
+  for (const SummaryRecord &S : Image.Summaries) {
+    if (S.Kind > GlobalValueSummary::GlobalVarKind)
+      return makeImageError("unknown summary kind");
+    if (S.ModuleIndex >= Image.Modules.size())
+      return makeImageError("module index out of range");
+    if (uint64_t(S.FirstEdge) + S.NumRefs + S.NumCalls > Image.Edges.size())
+      return makeImageError("edge index out of range");
+  }
+  return std::move(Image);
+}
+
+ModuleHash ModuleSummaryIndexImage::getModuleHash(unsigned I) const {
+  ModuleHash Hash;
+  for (unsigned J = 0; J < Hash.size(); ++J)
+    Hash[J] = Modules[I].Hash[J];
+  return Hash;
+}
+
+std::vector<ModuleSummaryIndexImage::Summary>
+ModuleSummaryIndexImage::getSummaries(const ValueRecord &V) const {
+  std::vector<Summary> Result;
+  Result.reserve(V.NumSummaries);
+  for (const SummaryRecord &R :
+       Summaries.slice(V.FirstSummary, V.NumSummaries))
+    Result.emplace_back(this, &R);
+  return Result;
+}
+
+std::vector<ModuleSummaryIndexImage::Summary>
+ModuleSummaryIndexImage::findSummaries(GlobalValue::GUID GUID) const {
+  auto I = std::lower_bound(
+      Values.begin(), Values.end(), GUID,
+      [](const ValueRecord &V, GlobalValue::GUID G) { return V.GUID < G; });
+  if (I == Values.end() || I->GUID != GUID)
+    return {};
+  return getSummaries(*I);
+}
+
+bool ModuleSummaryIndexImage::isGUIDLive(GlobalValue::GUID GUID) const {
+  if (!withGlobalValueDeadStripping())
+    return true;
+  std::vector<Summary> GUIDSummaries = findSummaries(GUID);
+  if (GUIDSummaries.empty())
+    return true;
+  return llvm::any_of(GUIDSummaries,
+                      [](const Summary &S) { return S.isLive(); });
+}
+
+Expected<std::unique_ptr<ModuleSummaryIndex>>
+ModuleSummaryIndexImage::materialize() const {
+  auto Index = llvm::make_unique<ModuleSummaryIndex>(/*IsPerformingAnalysis=*/
+                                                     false);
+  if (withGlobalValueDeadStripping())
+    Index->setWithGlobalValueDeadStripping();
+  if (skipModuleByDistributedBackend())
+    Index->setSkipModuleByDistributedBackend();
+
+  // The summaries refer to the copies of the module paths owned by the index.
+  std::vector<StringRef> ModulePaths;
+  ModulePaths.reserve(Modules.size());
+  for (unsigned I = 0, E = Modules.size(); I != E; ++I)
+    ModulePaths.push_back(
+        Index->addModule(getModulePath(I), getModuleId(I), getModuleHash(I))
+            ->first());
+
+  auto getEdgeValues = [&](ArrayRef<EdgeRecord> Edges) {
+    std::vector<ValueInfo> VIs;
+    VIs.reserve(Edges.size());
+    for (const EdgeRecord &E : Edges)
+      VIs.push_back(Index->getOrInsertValueInfo(E.GUID));
+    return VIs;
+  };
+
+  std::vector<std::pair<AliasSummary *, GlobalValue::GUID>> Aliases;
+  for (const ValueRecord &V : Values) {
+    ValueInfo VI = Index->getOrInsertValueInfo(V.GUID);
+    for (Summary S : getSummaries(V)) {
+      std::unique_ptr<GlobalValueSummary> GVS;
+      switch (S.getSummaryKind()) {
+      case GlobalValueSummary::AliasKind: {
+        auto AS = llvm::make_unique<AliasSummary>(S.flags());
+        Aliases.emplace_back(AS.get(), S.getAliaseeGUID());
+        GVS = std::move(AS);
+        break;
+      }
+      case GlobalValueSummary::FunctionKind: {
+        std::vector<FunctionSummary::EdgeTy> Calls;
+        Calls.reserve(S.calls().size());
+        for (const EdgeRecord &E : S.calls())
+          Calls.emplace_back(
+              Index->getOrInsertValueInfo(E.GUID),
+              CalleeInfo(CalleeInfo::HotnessType(uint32_t(E.Hotness)),
+                         E.RelBlockFreq));
+        GVS = llvm::make_unique<FunctionSummary>(
+            S.flags(), S.instCount(), S.fflags(), getEdgeValues(S.refs()),
+            std::move(Calls), std::vector<GlobalValue::GUID>(),
+            std::vector<FunctionSummary::VFuncId>(),
+            std::vector<FunctionSummary::VFuncId>(),
+            std::vector<FunctionSummary::ConstVCall>(),
+            std::vector<FunctionSummary::ConstVCall>());
+        break;
+      }
+      case GlobalValueSummary::GlobalVarKind:
+        GVS = llvm::make_unique<GlobalVarSummary>(S.flags(),
+                                                  getEdgeValues(S.refs()));
+        break;
+      }
+      GVS->setModulePath(ModulePaths[S.getModuleIndex()]);
+      GVS->setOriginalName(S.getOriginalName());
+      Index->addGlobalValueSummary(VI, std::move(GVS));
+    }
+  }
+
+  for (auto &A : Aliases) {
+    AliasSummary *AS = A.first;
+    auto *Aliasee = Index->findSummaryInModule(A.second, AS->modulePath());
+    if (!Aliasee)
+      return makeImageError("missing aliasee summary");
+    AS->setAliasee(Aliasee);
+    AS->setAliaseeGUID(A.second);
+  }
+
+  for (unsigned I = 0, E = CfiFunctionNames.size(); I != E; ++I) {
+    const NameRecord &N = CfiFunctionNames[I];
+    auto &Names = I < Hdr->NumCfiFunctionDefs ? Index->cfiFunctionDefs()
+                                              : Index->cfiFunctionDecls();
+    Names.insert(getString(N.Offset, N.Size));
+  }
+  return std::move(Index);
+}
+
+//===----------------------------------------------------------------------===//
+// Writer
+//===----------------------------------------------------------------------===//
+
+namespace {
+class ImageWriter {
+  const ModuleSummaryIndex &Index;
+  const std::map<std::string, GVSummaryMapTy> *ModuleToSummariesForIndex;
+
+  std::vector<ModuleRecord> Modules;
+  std::vector<ValueRecord> Values;
+  std::vector<SummaryRecord> Summaries;
+  std::vector<EdgeRecord> Edges;
+  std::vector<NameRecord> CfiFunctionNames;
+  std::string StringTable;
+
+  NameRecord addString(StringRef S) {
+    NameRecord N;
+    N.Offset = StringTable.size();
+    N.Size = S.size();
+    StringTable += S;
+    return N;
+  }
+
+  template <typename T> static void writeSection(raw_ostream &Out,
+                                                 ArrayRef<T> Records) {
+    Out.write(reinterpret_cast<const char *>(Records.data()),
+              Records.size() * sizeof(T));
+    // Every record is a multiple of 8 bytes, except names.
+    if (Records.size() * sizeof(T) % 8)
+      Out.write_zeros(8 - Records.size() * sizeof(T) % 8);
+  }
+
+public:
+  ImageWriter(const ModuleSummaryIndex &Index,
+              const std::map<std::string, GVSummaryMapTy>
+                  *ModuleToSummariesForIndex)
+      : Index(Index), ModuleToSummariesForIndex(ModuleToSummariesForIndex) {}
+
+  Error build();
+  void write(raw_ostream &Out);
+};
+} // end anonymous namespace
+
+Error ImageWriter::build() {
+  // Select the modules and summaries to write, following the same rules as
+  // the bitcode writer of combined indexes.
+  StringMap<unsigned> ModuleIndices;
+  auto addModule = [&](const ModulePathStringTableTy::value_type &MPSE) {
+    ModuleRecord M;
+    std::memset(&M, 0, sizeof(M));
+    M.ModuleId = MPSE.second.first;
+    NameRecord Path = addString(MPSE.first());
+    M.PathOffset = Path.Offset;
+    M.PathSize = Path.Size;
+    for (unsigned I = 0; I < 5; ++I)
+      M.Hash[I] = MPSE.second.second[I];
+    ModuleIndices[MPSE.first()] = Modules.size();
+    Modules.push_back(M);
+  };
+
+  DenseMap<const GlobalValueSummary *, GlobalValue::GUID> SummaryGUIDs;
+  for (auto &Summaries : Index)
+    for (auto &Summary : Summaries.second.SummaryList)
+      SummaryGUIDs[Summary.get()] = Summaries.first;
+
+  std::vector<std::pair<GlobalValue::GUID, const GlobalValueSummary *>>
+      Selected;
+  DenseSet<const GlobalValueSummary *> SeenSummaries;
+  auto select = [&](GlobalValue::GUID GUID, const GlobalValueSummary *S) {
+    if (SeenSummaries.insert(S).second)
+      Selected.emplace_back(GUID, S);
+  };
+  if (ModuleToSummariesForIndex) {
+    for (auto &M : *ModuleToSummariesForIndex) {
+      auto MPI = Index.modulePaths().find(M.first);
+      if (MPI != Index.modulePaths().end())
+        addModule(*MPI);
+      for (auto &Summary : M.second) {
+        select(Summary.first, Summary.second);
+        // Ensure the aliasee is available to the imported alias.
+        if (auto *AS = dyn_cast<AliasSummary>(Summary.second))
+          select(SummaryGUIDs.lookup(&AS->getAliasee()), &AS->getAliasee());
+      }
+    }
+  } else {
+    for (auto &MPSE : Index.modulePaths())
+      addModule(MPSE);
+    for (auto &Summaries : Index)
+      for (auto &Summary : Summaries.second.SummaryList)
+        select(Summaries.first, Summary.get());
+  }
+
+  if (!Index.typeIds().empty())
+    return makeImageError("type identifier summaries are not supported");
+
+  // The values are sorted by GUID; summaries of a value keep their order.
+  std::stable_sort(Selected.begin(), Selected.end(),
+                   [](const std::pair<GlobalValue::GUID,
+                                      const GlobalValueSummary *> &A,
+                      const std::pair<GlobalValue::GUID,
+                                      const GlobalValueSummary *> &B) {
+                     return A.first < B.first;
+                   });
+
+  auto addEdge = [&](GlobalValue::GUID GUID, CalleeInfo Info) {
+    EdgeRecord E;
+    E.GUID = GUID;
+    E.Hotness = Info.Hotness;
+    E.RelBlockFreq = Info.RelBlockFreq;
+    Edges.push_back(E);
+  };
+
+  for (auto &GUIDAndSummary : Selected) {
+    GlobalValue::GUID GUID = GUIDAndSummary.first;
+    const GlobalValueSummary *S = GUIDAndSummary.second;
+    if (Values.empty() || Values.back().GUID != GUID) {
+      ValueRecord V;
+      V.GUID = GUID;
+      V.FirstSummary = Summaries.size();
+      V.NumSummaries = 0;
+      Values.push_back(V);
+    }
+    Values.back().NumSummaries = Values.back().NumSummaries + 1;
+
+    auto MI = ModuleIndices.find(S->modulePath());
+    if (MI == ModuleIndices.end())
+      return makeImageError("summary for module '" + S->modulePath() +
+                            "' which is not in the index");
+
+    SummaryRecord R;
+    std::memset(&R, 0, sizeof(R));
+    GlobalValueSummary::GVFlags Flags = S->flags();
+    R.Kind = S->getSummaryKind();
+    R.Flags = Flags.Linkage | Flags.NotEligibleToImport << 4 |
+              Flags.Live << 5 | Flags.DSOLocal << 6;
+    R.ModuleIndex = MI->second;
+    R.FirstEdge = Edges.size();
+    R.OriginalName =
+        const_cast<GlobalValueSummary *>(S)->getOriginalName();
+
+    for (const ValueInfo &Ref : S->refs())
+      addEdge(Ref.getGUID(), CalleeInfo());
+    R.NumRefs = S->refs().size();
+
+    if (auto *FS = dyn_cast<FunctionSummary>(S)) {
+      if (!FS->type_tests().empty() ||
+          !FS->type_test_assume_vcalls().empty() ||
+          !FS->type_checked_load_vcalls().empty() ||
+          !FS->type_test_assume_const_vcalls().empty() ||
+          !FS->type_checked_load_const_vcalls().empty())
+        return makeImageError("type test information is not supported");
+      FunctionSummary::FFlags FunFlags = FS->fflags();
+      R.InstCount = FS->instCount();
+      R.FunFlags = FunFlags.ReadNone | FunFlags.ReadOnly << 1 |
+                   FunFlags.NoRecurse << 2 | FunFlags.ReturnDoesNotAlias << 3;
+      for (const FunctionSummary::EdgeTy &Call : FS->calls())
+        addEdge(Call.first.getGUID(), Call.second);
+      R.NumCalls = FS->calls().size();
+    } else if (auto *AS = dyn_cast<AliasSummary>(S)) {
+      R.AliaseeGUID = SummaryGUIDs.lookup(&AS->getAliasee());
+    }
+    Summaries.push_back(R);
+  }
+
+  for (auto &Name : Index.cfiFunctionDefs())
+    CfiFunctionNames.push_back(addString(Name));
+  for (auto &Name : Index.cfiFunctionDecls())
+    CfiFunctionNames.push_back(addString(Name));
+  return Error::success();
+}
+
+void ImageWriter::write(raw_ostream &Out) {
+  Header H;
+  std::memset(&H, 0, sizeof(H));
+  std::memcpy(H.Magic, Magic, sizeof(Magic));
+  H.Version = summaryimage::Version;
+  uint32_t Flags = 0;
+  if (Index.withGlobalValueDeadStripping())
+    Flags |= WithGlobalValueDeadStripping;
+  if (Index.skipModuleByDistributedBackend())
+    Flags |= SkipModuleByDistributedBackend;
+  H.Flags = Flags;
+  H.NumModules = Modules.size();
+  H.NumValues = Values.size();
+  H.NumSummaries = Summaries.size();
+  H.NumEdges = Edges.size();
+  H.NumCfiFunctionDefs = Index.cfiFunctionDefs().size();
+  H.NumCfiFunctionDecls = Index.cfiFunctionDecls().size();
+  H.StringTableSize = StringTable.size();
+
+  writeSection(Out, makeArrayRef(H));
+  writeSection(Out, makeArrayRef(Modules));
+  writeSection(Out, makeArrayRef(Values));
+  writeSection(Out, makeArrayRef(Summaries));
+  writeSection(Out, makeArrayRef(Edges));
+  writeSection(Out, makeArrayRef(CfiFunctionNames));
+  Out << StringTable;
+}
+
+Error llvm::writeModuleSummaryIndexImage(
+    const ModuleSummaryIndex &Index, raw_ostream &Out,
+    const std::map<std::string, GVSummaryMapTy> *ModuleToSummariesForIndex) {
+  ImageWriter Writer(Index, ModuleToSummariesForIndex);
+  if (Error E = Writer.build())
+    return E;
+  Writer.write(Out);
+  return Error::success();
+}
@@ -27,15 +27,19 @@
 #include "llvm/LTO/LTOBackend.h"
 #include "llvm/Linker/IRMover.h"
 #include "llvm/Object/IRObjectFile.h"
+#include "llvm/Pass.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/Threading.h"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/VCSRevision.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
@@ -52,10 +56,28 @@ using namespace object;
 
 #define DEBUG_TYPE "lto"
 
+namespace llvm {
+extern cl::opt<unsigned> ThinLinkThreads;
+} // end namespace llvm
+
 static cl::opt<bool>
     DumpThinCGSCCs("dump-thin-cg-sccs", cl::init(false), cl::Hidden,
                    cl::desc("Dump the SCCs in the ThinLTO index's callgraph"));
 
+namespace {
+/// Times one phase of the thin link, both with -time-passes (in the
+/// "Thin link" timer group) and with the time trace profiler.
+class ThinLinkPhaseTimer {
+  NamedRegionTimer Timer;
+  TimeTraceScope Trace;
+
+public:
+  ThinLinkPhaseTimer(StringRef Name, StringRef Description)
+      : Timer(Name, Description, "thinlink", "Thin link", TimePassesIsEnabled),
+        Trace(Description, StringRef("")) {}
+};
+} // end anonymous namespace
+
 // The values are (type identifier, summary) pairs.
 typedef DenseMap<
     GlobalValue::GUID,
@@ -278,6 +300,40 @@ static void computeCacheKey(
   Key = toHex(Hasher.result());
 }
 
+using IndexEntryTy = GlobalValueSummaryMapTy::value_type;
+
+/// Number of consecutive GUIDs of the combined index processed by one task of
+/// the index-wide thin link phases.
+static cl::opt<unsigned> GUIDChunkSize(
+    "thin-link-guid-chunk-size", cl::init(4096), cl::Hidden,
+    cl::value_desc("N"),
+    cl::desc("Split the combined index into tasks of N GUIDs for the "
+             "index-wide thin link phases"));
+
+/// Number of chunks that forEachIndexChunk() splits \p Index into.
+static size_t getNumIndexChunks(const ModuleSummaryIndex &Index) {
+  size_t ChunkSize = std::max(1u, unsigned(GUIDChunkSize));
+  return (Index.size() + ChunkSize - 1) / ChunkSize;
+}
+
+/// Call \p Fn on each chunk of consecutive entries of \p Index, in parallel.
+/// \p Fn receives the position of the chunk and its entries.
+template <typename FnTy>
+static void forEachIndexChunk(ModuleSummaryIndex &Index, FnTy Fn) {
+  std::vector<IndexEntryTy *> Entries;
+  Entries.reserve(Index.size());
+  for (auto &I : Index)
+    Entries.push_back(&I);
+  size_t ChunkSize = std::max(1u, unsigned(GUIDChunkSize));
+  parallel::for_each_n(parallel::par.withThreads(ThinLinkThreads), size_t(0),
+                       getNumIndexChunks(Index), [&](size_t C) {
+                         size_t Begin = C * ChunkSize;
+                         size_t End =
+                             std::min(Begin + ChunkSize, Entries.size());
+                         Fn(C, makeArrayRef(Entries).slice(Begin, End - Begin));
+                       });
+}
+
 static void thinLTOResolveWeakForLinkerGUID(
     GlobalValueSummaryList &GVSummaryList, GlobalValue::GUID GUID,
     DenseSet<GlobalValueSummary *> &GlobalInvolvedWithAlias,
@@ -332,10 +388,27 @@ void llvm::thinLTOResolveWeakForLinkerInIndex(
       if (auto AS = dyn_cast<AliasSummary>(S.get()))
         GlobalInvolvedWithAlias.insert(&AS->getAliasee());
 
-  for (auto &I : Index)
-    thinLTOResolveWeakForLinkerGUID(I.second.SummaryList, I.first,
-                                    GlobalInvolvedWithAlias, isPrevailing,
-                                    recordNewLinkage);
+  // Resolve the GUIDs in parallel, buffering the new linkages of each chunk
+  // so that they can be recorded in index order.
+  using NewLinkageTy =
+      std::tuple<StringRef, GlobalValue::GUID, GlobalValue::LinkageTypes>;
+  std::vector<std::vector<NewLinkageTy>> NewLinkages(getNumIndexChunks(Index));
+  forEachIndexChunk(Index, [&](size_t C, ArrayRef<IndexEntryTy *> Entries) {
+    auto recordChunkLinkage = [&](StringRef ModuleIdentifier,
+                                  GlobalValue::GUID GUID,
+                                  GlobalValue::LinkageTypes NewLinkage) {
+      NewLinkages[C].emplace_back(ModuleIdentifier, GUID, NewLinkage);
+    };
+    for (IndexEntryTy *I : Entries)
+      thinLTOResolveWeakForLinkerGUID(I->second.SummaryList, I->first,
+                                      GlobalInvolvedWithAlias, isPrevailing,
+                                      recordChunkLinkage);
+  });
+
+  for (auto &ChunkLinkages : NewLinkages)
+    for (auto &NewLinkage : ChunkLinkages)
+      recordNewLinkage(std::get<0>(NewLinkage), std::get<1>(NewLinkage),
+                       std::get<2>(NewLinkage));
 }
 
 static void thinLTOInternalizeAndPromoteGUID(
@@ -355,8 +428,11 @@ static void thinLTOInternalizeAndPromoteGUID(
 void llvm::thinLTOInternalizeAndPromoteInIndex(
     ModuleSummaryIndex &Index,
     function_ref<bool(StringRef, GlobalValue::GUID)> isExported) {
-  for (auto &I : Index)
-    thinLTOInternalizeAndPromoteGUID(I.second.SummaryList, I.first, isExported);
+  forEachIndexChunk(Index, [&](size_t, ArrayRef<IndexEntryTy *> Entries) {
+    for (IndexEntryTy *I : Entries)
+      thinLTOInternalizeAndPromoteGUID(I->second.SummaryList, I->first,
+                                       isExported);
+  });
 }
 
 // Requires a destructor for std::vector<InputModule>.
@@ -791,7 +867,11 @@ Error LTO::run(AddStreamFn AddStream, NativeObjectCache Cache) {
       return PrevailingType::Unknown;
     return It->second;
   };
-  computeDeadSymbols(ThinLTO.CombinedIndex, GUIDPreservedSymbols, isPrevailing);
+  {
+    ThinLinkPhaseTimer T("deadsymbols", "Compute dead symbols");
+    computeDeadSymbols(ThinLTO.CombinedIndex, GUIDPreservedSymbols,
+                       isPrevailing);
+  }
 
   // Setup output file to emit statistics.
   std::unique_ptr<ToolOutputFile> StatsFile = nullptr;
@@ -1134,8 +1214,12 @@ Error LTO::runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache) {
   // Summary).
   StringMap<GVSummaryMapTy>
       ModuleToDefinedGVSummaries(ThinLTO.ModuleMap.size());
-  ThinLTO.CombinedIndex.collectDefinedGVSummariesPerModule(
-      ModuleToDefinedGVSummaries);
+  {
+    ThinLinkPhaseTimer T("collectsummaries",
+                         "Collect defined summaries per module");
+    ThinLTO.CombinedIndex.collectDefinedGVSummariesPerModule(
+        ModuleToDefinedGVSummaries);
+  }
   // Create entries for any modules that didn't have any GV summaries
   // (either they didn't have any GVs to start with, or we suppressed
   // generation of the summaries because they e.g. had inline assembly
@@ -1156,9 +1240,11 @@ Error LTO::runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache) {
   if (DumpThinCGSCCs)
     ThinLTO.CombinedIndex.dumpSCCs(outs());
 
-  if (Conf.OptLevel > 0)
+  if (Conf.OptLevel > 0) {
+    ThinLinkPhaseTimer T("import", "Compute cross-module imports");
     ComputeCrossModuleImport(ThinLTO.CombinedIndex, ModuleToDefinedGVSummaries,
                              ImportLists, ExportLists);
+  }
 
   // Figure out which symbols need to be internalized. This also needs to happen
   // at -O0 because summary-based DCE is implemented using internalization, and
@@ -1190,19 +1276,25 @@ Error LTO::runThinLTO(AddStreamFn AddStream, NativeObjectCache Cache) {
             ExportList->second.count(GUID)) ||
            ExportedGUIDs.count(GUID);
   };
-  thinLTOInternalizeAndPromoteInIndex(ThinLTO.CombinedIndex, isExported);
+  {
+    ThinLinkPhaseTimer T("internalize", "Internalize and promote");
+    thinLTOInternalizeAndPromoteInIndex(ThinLTO.CombinedIndex, isExported);
+  }
 
   auto isPrevailing = [&](GlobalValue::GUID GUID,
                           const GlobalValueSummary *S) {
-    return ThinLTO.PrevailingModuleForGUID[GUID] == S->modulePath();
+    return ThinLTO.PrevailingModuleForGUID.lookup(GUID) == S->modulePath();
   };
   auto recordNewLinkage = [&](StringRef ModuleIdentifier,
                               GlobalValue::GUID GUID,
                               GlobalValue::LinkageTypes NewLinkage) {
     ResolvedODR[ModuleIdentifier][GUID] = NewLinkage;
   };
-  thinLTOResolveWeakForLinkerInIndex(ThinLTO.CombinedIndex, isPrevailing,
-                                     recordNewLinkage);
+  {
+    ThinLinkPhaseTimer T("resolveweak", "Resolve weak for linker");
+    thinLTOResolveWeakForLinkerInIndex(ThinLTO.CombinedIndex, isPrevailing,
+                                       recordNewLinkage);
+  }
 
   std::unique_ptr<ThinBackendProc> BackendProc =
       ThinLTO.Backend(Conf, ThinLTO.CombinedIndex, ModuleToDefinedGVSummaries,
@@ -24,9 +24,11 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Module.h"
 #include "llvm/IR/ProfileSummary.h"
 #include "llvm/ProfileData/ProfileCommon.h"
 #include "llvm/ProfileData/SampleProf.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/LineIterator.h"
@@ -406,26 +408,103 @@ SampleProfileReaderBinary::readProfile(FunctionSamples &FProfile) {
   return sampleprof_error::success;
 }
 
+std::error_code SampleProfileReaderBinary::readFuncProfile() {
+  auto NumHeadSamples = readNumber<uint64_t>();
+  if (std::error_code EC = NumHeadSamples.getError())
+    return EC;
+
+  auto FName(readStringFromTable());
+  if (std::error_code EC = FName.getError())
+    return EC;
+
+  Profiles[*FName] = FunctionSamples();
+  FunctionSamples &FProfile = Profiles[*FName];
+  FProfile.setName(*FName);
+
+  FProfile.addHeadSamples(*NumHeadSamples);
+
+  return readProfile(FProfile);
+}
+
 std::error_code SampleProfileReaderBinary::read() {
+  if (HasFuncOffsetTable && !UseAllFuncs) {
+    const uint8_t *Start =
+        reinterpret_cast<const uint8_t *>(Buffer->getBufferStart());
+    for (const auto &Name : FuncsToUse) {
+      auto Offset = FuncOffsetTable.find(Name.getKey());
+      if (Offset == FuncOffsetTable.end())
+        continue;
+      Data = Start + Offset->second;
+      if (std::error_code EC = readFuncProfile())
+        return EC;
+    }
+    return sampleprof_error::success;
+  }
+
   while (!at_eof()) {
-    auto NumHeadSamples = readNumber<uint64_t>();
-    if (std::error_code EC = NumHeadSamples.getError())
+    if (std::error_code EC = readFuncProfile())
       return EC;
+  }
 
-    auto FName(readStringFromTable());
-    if (std::error_code EC = FName.getError())
-      return EC;
+  return sampleprof_error::success;
+}
+
+void SampleProfileReaderBinary::collectFuncsToUse(const Module &M) {
+  UseAllFuncs = false;
+  FuncsToUse.clear();
+  // Profiles are keyed by the name without any suffix; see getSamplesFor().
+  for (const Function &F : M)
+    if (!F.isDeclaration())
+      FuncsToUse.insert(F.getName().split('.').first);
+}
 
-    Profiles[*FName] = FunctionSamples();
-    FunctionSamples &FProfile = Profiles[*FName];
-    FProfile.setName(*FName);
+std::error_code SampleProfileReaderBinary::readFuncOffsetTable() {
+  const uint8_t *Start =
+      reinterpret_cast<const uint8_t *>(Buffer->getBufferStart());
+  const uint8_t *BodiesStart = Data;
+  if (End - BodiesStart < 8) {
+    std::error_code EC = sampleprof_error::truncated;
+    reportError(0, EC.message());
+    return EC;
+  }
 
-    FProfile.addHeadSamples(*NumHeadSamples);
+  // The table sits between the last function body and the table offset,
+  // which is stored in the last 8 bytes of the file.
+  const uint8_t *TableEnd = End - 8;
+  uint64_t TableOffset = support::endian::read64le(TableEnd);
+  if (TableOffset < uint64_t(BodiesStart - Start) ||
+      TableOffset > uint64_t(TableEnd - Start)) {
+    std::error_code EC = sampleprof_error::malformed;
+    reportError(0, EC.message());
+    return EC;
+  }
+  const uint8_t *TableStart = Start + TableOffset;
 
-    if (std::error_code EC = readProfile(FProfile))
+  Data = TableStart;
+  End = TableEnd;
+  auto Size = readNumber<uint64_t>();
+  if (std::error_code EC = Size.getError())
+    return EC;
+  FuncOffsetTable.reserve(*Size);
+  for (uint64_t I = 0; I < *Size; ++I) {
+    auto FName(readStringFromTable());
+    if (std::error_code EC = FName.getError())
+      return EC;
+    auto Offset = readNumber<uint64_t>();
+    if (std::error_code EC = Offset.getError())
       return EC;
+    if (*Offset < uint64_t(BodiesStart - Start) || *Offset >= TableOffset) {
+      std::error_code EC = sampleprof_error::malformed;
+      reportError(0, EC.message());
+      return EC;
+    }
+    FuncOffsetTable[*FName] = *Offset;
   }
+  HasFuncOffsetTable = true;
 
+  // Reading all the profiles walks the function bodies up to the table.
+  Data = BodiesStart;
+  End = TableStart;
   return sampleprof_error::success;
 }
 
@@ -444,7 +523,9 @@ std::error_code SampleProfileReaderBinary::readHeader() {
   auto Version = readNumber<uint64_t>();
   if (std::error_code EC = Version.getError())
     return EC;
-  else if (*Version != SPVersion())
+  // Version 103 profiles, which have no function offset table, are still
+  // supported; they are always read in full.
+  else if (*Version != SPVersion() && *Version != 103)
     return sampleprof_error::unsupported_version;
 
   if (std::error_code EC = readSummary())
@@ -462,6 +543,8 @@ std::error_code SampleProfileReaderBinary::readHeader() {
     NameTable.push_back(*Name);
   }
 
+  if (*Version >= 104)
+    return readFuncOffsetTable();
   return sampleprof_error::success;
 }
 
@@ -22,6 +22,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ProfileData/ProfileCommon.h"
 #include "llvm/ProfileData/SampleProf.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/LEB128.h"
@@ -60,7 +61,7 @@ SampleProfileWriter::write(const StringMap<FunctionSamples> &ProfileMap) {
     if (std::error_code EC = write(*I.second))
       return EC;
   }
-  return sampleprof_error::success;
+  return writeFooter();
 }
 
 /// Write samples to a text file.
@@ -147,6 +148,8 @@ void SampleProfileWriterBinary::addNames(const FunctionSamples &S) {
 std::error_code SampleProfileWriterBinary::writeHeader(
     const StringMap<FunctionSamples> &ProfileMap) {
   auto &OS = *OutputStream;
+  FileStart = OS.tell();
+  FuncOffsetTable.clear();
 
   // Write file magic identifier.
   encodeULEB128(SPMagic(), OS);
@@ -243,10 +246,26 @@ std::error_code SampleProfileWriterBinary::writeBody(const FunctionSamples &S) {
 ///
 /// \returns true if the samples were written successfully, false otherwise.
 std::error_code SampleProfileWriterBinary::write(const FunctionSamples &S) {
+  FuncOffsetTable.emplace_back(S.getName(), OutputStream->tell() - FileStart);
   encodeULEB128(S.getHeadSamples(), *OutputStream);
   return writeBody(S);
 }
 
+/// Write the function offset table, followed by its own offset as a fixed
+/// size integer so that the reader can find it from the end of the file.
+std::error_code SampleProfileWriterBinary::writeFooter() {
+  auto &OS = *OutputStream;
+  uint64_t TableOffset = OS.tell() - FileStart;
+  encodeULEB128(FuncOffsetTable.size(), OS);
+  for (const auto &Entry : FuncOffsetTable) {
+    if (std::error_code EC = writeNameIdx(Entry.first))
+      return EC;
+    encodeULEB128(Entry.second, OS);
+  }
+  support::endian::write<uint64_t>(OS, TableOffset, support::little);
+  return sampleprof_error::success;
+}
+
 /// Create a sample profile file writer based on the specified format.
 ///
 /// \param Filename The file to create.
@@ -12,11 +12,13 @@
 
 #if LLVM_ENABLE_THREADS
 
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/Threading.h"
 
 #include <atomic>
-#include <stack>
+#include <memory>
 #include <thread>
+#include <vector>
 
 using namespace llvm;
 
@@ -28,6 +30,13 @@ public:
   virtual ~Executor() = default;
   virtual void add(std::function<void()> func) = 0;
 
+  /// Run one pending task on the calling thread, if there is one. Returns
+  /// false if no task was found.
+  virtual bool runOneTask() { return false; }
+
+  /// Is the calling thread one of this executor's threads?
+  virtual bool isWorkerThread() const { return false; }
+
   static Executor *getDefaultExecutor();
 };
 
@@ -59,59 +68,133 @@ Executor *Executor::getDefaultExecutor() {
 }
 
 #else
-/// An implementation of an Executor that runs closures on a thread pool
-///   in filo order.
+/// An implementation of an Executor that runs closures on a thread pool with
+/// work stealing.
+///
+/// Every worker owns a deque of tasks. Tasks spawned from a worker are pushed
+/// to the back of its own deque and popped from there in lifo order, which
+/// keeps recursive algorithms such as parallel_quick_sort cache friendly. An
+/// idle worker steals from the front of the other deques, i.e. it takes the
+/// oldest and usually largest piece of work. Tasks spawned from threads that
+/// are not workers go to a separate injection queue. Each deque has its own
+/// lock, so workers only contend when they steal.
 class ThreadPoolExecutor : public Executor {
 public:
   explicit ThreadPoolExecutor(unsigned ThreadCount = hardware_concurrency())
       : Done(ThreadCount) {
+    // One queue per worker, plus the injection queue at index ThreadCount.
+    for (unsigned I = 0; I <= ThreadCount; ++I)
+      Queues.emplace_back(new TaskQueue);
+
     // Spawn all but one of the threads in another thread as spawning threads
     // can take a while.
     std::thread([&, ThreadCount] {
-      for (size_t i = 1; i < ThreadCount; ++i) {
-        std::thread([=] { work(); }).detach();
+      for (unsigned I = 1; I < ThreadCount; ++I) {
+        std::thread([=] { work(I); }).detach();
       }
-      work();
+      work(0);
     }).detach();
   }
 
   ~ThreadPoolExecutor() override {
-    std::unique_lock<std::mutex> Lock(Mutex);
+    std::unique_lock<std::mutex> Lock(SleepMutex);
     Stop = true;
     Lock.unlock();
-    Cond.notify_all();
+    SleepCond.notify_all();
     // Wait for ~Latch.
   }
 
   void add(std::function<void()> F) override {
-    std::unique_lock<std::mutex> Lock(Mutex);
-    WorkStack.push(F);
-    Lock.unlock();
-    Cond.notify_one();
+    TaskQueue &Q = CurrentExecutor == this ? *Queues[CurrentWorker]
+                                           : *Queues.back();
+    {
+      std::lock_guard<std::mutex> Lock(Q.Mutex);
+      Q.Tasks.push_back(std::move(F));
+    }
+    ++PendingTasks;
+    {
+      // Taking the lock orders the increment above with the predicate check
+      // of a worker about to sleep, so the notification cannot be lost.
+      std::lock_guard<std::mutex> Lock(SleepMutex);
+    }
+    SleepCond.notify_one();
+  }
+
+  bool runOneTask() override {
+    std::function<void()> Task;
+    unsigned Self = CurrentExecutor == this ? CurrentWorker : Queues.size() - 1;
+    if (!findTask(Self, Task))
+      return false;
+    Task();
+    return true;
   }
 
+  bool isWorkerThread() const override { return CurrentExecutor == this; }
+
 private:
-  void work() {
+  struct TaskQueue {
+    std::mutex Mutex;
+    std::deque<std::function<void()>> Tasks;
+  };
+
+  /// Pop a task from the back of queue \p Self, or steal one from the front
+  /// of any other queue.
+  bool findTask(unsigned Self, std::function<void()> &Task) {
+    if (PendingTasks == 0)
+      return false;
+    unsigned NumQueues = Queues.size();
+    for (unsigned I = 0; I != NumQueues; ++I) {
+      unsigned Index = (Self + I) % NumQueues;
+      TaskQueue &Q = *Queues[Index];
+      std::lock_guard<std::mutex> Lock(Q.Mutex);
+      if (Q.Tasks.empty())
+        continue;
+      if (Index == Self) {
+        Task = std::move(Q.Tasks.back());
+        Q.Tasks.pop_back();
+      } else {
+        Task = std::move(Q.Tasks.front());
+        Q.Tasks.pop_front();
+      }
+      --PendingTasks;
+      return true;
+    }
+    return false;
+  }
+
+  void work(unsigned Index) {
+    CurrentExecutor = this;
+    CurrentWorker = Index;
     while (true) {
-      std::unique_lock<std::mutex> Lock(Mutex);
-      Cond.wait(Lock, [&] { return Stop || !WorkStack.empty(); });
+      std::function<void()> Task;
+      if (findTask(Index, Task)) {
+        Task();
+        continue;
+      }
+      std::unique_lock<std::mutex> Lock(SleepMutex);
+      SleepCond.wait(Lock, [&] { return Stop || PendingTasks != 0; });
       if (Stop)
         break;
-      auto Task = WorkStack.top();
-      WorkStack.pop();
-      Lock.unlock();
-      Task();
     }
     Done.dec();
   }
 
+  /// The executor and worker index of the calling thread, if it is a worker.
+  static LLVM_THREAD_LOCAL ThreadPoolExecutor *CurrentExecutor;
+  static LLVM_THREAD_LOCAL unsigned CurrentWorker;
+
+  std::vector<std::unique_ptr<TaskQueue>> Queues;
+  std::atomic<unsigned> PendingTasks{0};
   std::atomic<bool> Stop{false};
-  std::stack<std::function<void()>> WorkStack;
-  std::mutex Mutex;
-  std::condition_variable Cond;
+  std::mutex SleepMutex;
+  std::condition_variable SleepCond;
   parallel::detail::Latch Done;
 };
 
+LLVM_THREAD_LOCAL ThreadPoolExecutor *ThreadPoolExecutor::CurrentExecutor =
+    nullptr;
+LLVM_THREAD_LOCAL unsigned ThreadPoolExecutor::CurrentWorker = 0;
+
 Executor *Executor::getDefaultExecutor() {
   static ThreadPoolExecutor exec;
   return &exec;
@@ -119,11 +202,57 @@ Executor *Executor::getDefaultExecutor() {
 #endif
 }
 
+parallel::detail::TaskGroup::~TaskGroup() { sync(); }
+
 void parallel::detail::TaskGroup::spawn(std::function<void()> F) {
   L.inc();
-  Executor::getDefaultExecutor()->add([&, F] {
+  if (MaxConcurrency) {
+    // Hand the task to one of the executor tasks already draining this group
+    // if the group is at its limit, otherwise start a new one.
+    std::lock_guard<std::mutex> Lock(PendingMutex);
+    if (Running == MaxConcurrency) {
+      Pending.push_back(std::move(F));
+      return;
+    }
+    ++Running;
+  }
+  Executor::getDefaultExecutor()->add([&, F] { drain(F); });
+}
+
+void parallel::detail::TaskGroup::drain(std::function<void()> F) {
+  while (true) {
     F();
+    if (!MaxConcurrency) {
+      L.dec();
+      return;
+    }
+    std::unique_lock<std::mutex> Lock(PendingMutex);
+    bool Last = Pending.empty();
+    if (Last) {
+      --Running;
+    } else {
+      F = std::move(Pending.front());
+      Pending.pop_front();
+    }
+    Lock.unlock();
+    // The group may be destroyed as soon as the count drops to zero, so only
+    // signal completion once we are done with its state.
     L.dec();
-  });
+    if (Last)
+      return;
+  }
+}
+
+void parallel::detail::TaskGroup::sync() const {
+  Executor *Exec = Executor::getDefaultExecutor();
+  if (!Exec->isWorkerThread()) {
+    L.sync();
+    return;
+  }
+  // Blocking a worker could starve the tasks we are waiting for, e.g. when
+  // every worker is waiting on a nested group. Help out instead.
+  while (!L.isDone())
+    if (!Exec->runOneTask())
+      std::this_thread::yield();
 }
 #endif // LLVM_ENABLE_THREADS
@@ -14,6 +14,7 @@
 #include "llvm/Support/ThreadPool.h"
 
 #include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -25,7 +26,15 @@ using namespace llvm;
 ThreadPool::ThreadPool() : ThreadPool(hardware_concurrency()) {}
 
 ThreadPool::ThreadPool(unsigned ThreadCount)
+    : ThreadPool(ThreadCount, ExecutionMode::OwnThreads) {}
+
+ThreadPool::ThreadPool(unsigned ThreadCount, ExecutionMode Mode)
     : ActiveThreads(0), EnableFlag(true) {
+  if (Mode == ExecutionMode::SharedExecutor) {
+    SharedTasks = llvm::make_unique<parallel::detail::TaskGroup>(ThreadCount);
+    return;
+  }
+
   // Create ThreadCount threads that will loop forever, wait on QueueCondition
   // for tasks to be queued or the Pool to be destroyed.
   Threads.reserve(ThreadCount);
@@ -70,6 +79,10 @@ ThreadPool::ThreadPool(unsigned ThreadCount)
 }
 
 void ThreadPool::wait() {
+  if (SharedTasks) {
+    SharedTasks->sync();
+    return;
+  }
   // Wait for all threads to complete and the queue to be empty
   std::unique_lock<std::mutex> LockGuard(CompletionLock);
   // The order of the checks for ActiveThreads and Tasks.empty() matters because
@@ -80,6 +93,14 @@ void ThreadPool::wait() {
 }
 
 std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
+  if (SharedTasks) {
+    // std::function needs a copyable callable, so share the packaged_task.
+    auto PackagedTask = std::make_shared<PackagedTaskTy>(std::move(Task));
+    auto Future = PackagedTask->get_future();
+    SharedTasks->spawn([PackagedTask] { (*PackagedTask)(); });
+    return Future.share();
+  }
+
   /// Wrap the Task in a packaged_task to return a future object.
   PackagedTaskTy PackagedTask(std::move(Task));
   auto Future = PackagedTask.get_future();
@@ -98,6 +119,11 @@ std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
 
 // The destructor joins all threads, waiting for completion.
 ThreadPool::~ThreadPool() {
+  if (SharedTasks) {
+    // Destroying the group waits for its tasks.
+    SharedTasks.reset();
+    return;
+  }
   {
     std::unique_lock<std::mutex> LockGuard(QueueLock);
     EnableFlag = false;
@@ -111,6 +137,10 @@ ThreadPool::~ThreadPool() {
 
 ThreadPool::ThreadPool() : ThreadPool(0) {}
 
+// Without threads there is nothing to share; tasks run in wait() either way.
+ThreadPool::ThreadPool(unsigned ThreadCount, ExecutionMode Mode)
+    : ThreadPool(ThreadCount) {}
+
 // No threads are launched, issue a warning if ThreadCount is not 0
 ThreadPool::ThreadPool(unsigned ThreadCount)
     : ActiveThreads(0) {
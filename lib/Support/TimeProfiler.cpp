@@ -0,0 +1,220 @@
+//===-- TimeProfiler.cpp - Hierarchical Time Profiler ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+/// \file Hierarchical time profiler implementation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+using namespace llvm;
+using namespace std::chrono;
+
+namespace llvm {
+
+LLVM_THREAD_LOCAL TimeTraceProfiler *TimeTraceProfilerInstance = nullptr;
+
+typedef steady_clock ClockType;
+typedef ClockType::time_point TimePointType;
+typedef ClockType::duration DurationType;
+typedef std::pair<size_t, DurationType> CountAndDurationType;
+typedef std::pair<std::string, CountAndDurationType>
+    NameAndCountAndDurationType;
+
+/// Write \p S to \p OS as a JSON string literal, including the quotes.
+static void writeJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (unsigned char C : S) {
+    switch (C) {
+    case '"':
+      OS << "\\\"";
+      break;
+    case '\\':
+      OS << "\\\\";
+      break;
+    case '\n':
+      OS << "\\n";
+      break;
+    case '\r':
+      OS << "\\r";
+      break;
+    case '\t':
+      OS << "\\t";
+      break;
+    default:
+      if (C < 0x20)
+        OS << format("\\u%04x", C);
+      else
+        OS << C;
+      break;
+    }
+  }
+  OS << '"';
+}
+
+namespace {
+struct Entry {
+  TimePointType Start;
+  DurationType Duration;
+  std::string Name;
+  std::string Detail;
+
+  Entry(TimePointType S, DurationType D, std::string N, std::string Dt)
+      : Start(S), Duration(D), Name(std::move(N)), Detail(std::move(Dt)) {}
+};
+} // end anonymous namespace
+
+struct TimeTraceProfiler {
+  TimeTraceProfiler(unsigned TimeTraceGranularity, StringRef ProcName)
+      : StartTime(ClockType::now()), ProcName(ProcName),
+        TimeTraceGranularity(TimeTraceGranularity) {}
+
+  void begin(std::string Name, llvm::function_ref<std::string()> Detail) {
+    Stack.emplace_back(ClockType::now(), DurationType{}, std::move(Name),
+                       Detail());
+  }
+
+  void end() {
+    // A scope that was opened before the profiler was initialized may close
+    // while it is active; there is nothing to record for it.
+    if (Stack.empty())
+      return;
+    Entry &E = Stack.back();
+    E.Duration = ClockType::now() - E.Start;
+
+    // Only include sections longer than TimeTraceGranularity microseconds.
+    if (duration_cast<microseconds>(E.Duration).count() >=
+        TimeTraceGranularity)
+      Entries.emplace_back(E);
+
+    // Track total time taken by each "name", but only the topmost levels of
+    // them; e.g. if a pass manager runs a nested pass manager of the same
+    // name, we only want to add the outermost one. "topmost" happens to be
+    // the ones that don't have any currently open entries above itself.
+    if (std::find_if(++Stack.rbegin(), Stack.rend(), [&](const Entry &Val) {
+          return Val.Name == E.Name;
+        }) == Stack.rend()) {
+      auto &CountAndTotal = CountAndTotalPerName[E.Name];
+      CountAndTotal.first++;
+      CountAndTotal.second += E.Duration;
+    }
+
+    Stack.pop_back();
+  }
+
+  void write(raw_ostream &OS) {
+    assert(Stack.empty() &&
+           "All profiler sections should be ended when calling write");
+    const unsigned Pid = 1;
+    bool First = true;
+    auto writeEvent = [&](StringRef Name, int64_t Tid, int64_t StartUs,
+                          int64_t DurUs, StringRef ArgKey, StringRef ArgVal) {
+      OS << (First ? "\n" : ",\n");
+      First = false;
+      OS << "{\"pid\":" << Pid << ",\"tid\":" << Tid
+         << ",\"ph\":\"X\",\"ts\":" << StartUs << ",\"dur\":" << DurUs
+         << ",\"name\":";
+      writeJSONString(OS, Name);
+      OS << ",\"args\":{";
+      writeJSONString(OS, ArgKey);
+      OS << ':';
+      writeJSONString(OS, ArgVal);
+      OS << "}}";
+    };
+
+    OS << "{\"traceEvents\":[";
+
+    // Emit all events for the main flame graph.
+    for (const Entry &E : Entries) {
+      auto StartUs = duration_cast<microseconds>(E.Start - StartTime).count();
+      auto DurUs = duration_cast<microseconds>(E.Duration).count();
+      writeEvent(E.Name, 0, StartUs, DurUs, "detail", E.Detail);
+    }
+
+    // Emit totals by section name as additional "thread" events, sorted from
+    // longest one.
+    std::vector<NameAndCountAndDurationType> SortedTotals;
+    SortedTotals.reserve(CountAndTotalPerName.size());
+    for (const auto &Total : CountAndTotalPerName)
+      SortedTotals.emplace_back(Total.getKey(), Total.getValue());
+
+    std::sort(SortedTotals.begin(), SortedTotals.end(),
+              [](const NameAndCountAndDurationType &A,
+                 const NameAndCountAndDurationType &B) {
+                return A.second.second > B.second.second;
+              });
+    int64_t Tid = 1;
+    for (const auto &Total : SortedTotals) {
+      auto DurUs = duration_cast<microseconds>(Total.second.second).count();
+      writeEvent("Total " + Total.first, Tid++, 0, DurUs, "count",
+                 std::to_string(Total.second.first));
+    }
+
+    // Emit metadata event with process name.
+    OS << (First ? "\n" : ",\n");
+    OS << "{\"cat\":\"\",\"pid\":" << Pid
+       << ",\"tid\":0,\"ts\":0,\"ph\":\"M\",\"name\":\"process_name\","
+          "\"args\":{\"name\":";
+    writeJSONString(OS, ProcName);
+    OS << "}}\n]}\n";
+  }
+
+  std::vector<Entry> Stack;
+  std::vector<Entry> Entries;
+  StringMap<CountAndDurationType> CountAndTotalPerName;
+  const TimePointType StartTime;
+  const std::string ProcName;
+
+  // Minimum time granularity (in microseconds)
+  const unsigned TimeTraceGranularity;
+};
+
+void timeTraceProfilerInitialize(unsigned TimeTraceGranularity,
+                                 StringRef ProcName) {
+  assert(TimeTraceProfilerInstance == nullptr &&
+         "Profiler should not be initialized");
+  TimeTraceProfilerInstance =
+      new TimeTraceProfiler(TimeTraceGranularity, ProcName);
+}
+
+void timeTraceProfilerCleanup() {
+  delete TimeTraceProfilerInstance;
+  TimeTraceProfilerInstance = nullptr;
+}
+
+void timeTraceProfilerWrite(raw_ostream &OS) {
+  assert(TimeTraceProfilerInstance != nullptr &&
+         "Profiler object can't be null");
+  TimeTraceProfilerInstance->write(OS);
+}
+
+void timeTraceProfilerBegin(StringRef Name, StringRef Detail) {
+  if (TimeTraceProfilerInstance != nullptr)
+    TimeTraceProfilerInstance->begin(Name, [&]() { return Detail; });
+}
+
+void timeTraceProfilerBegin(StringRef Name,
+                            llvm::function_ref<std::string()> Detail) {
+  if (TimeTraceProfilerInstance != nullptr)
+    TimeTraceProfilerInstance->begin(Name, Detail);
+}
+
+void timeTraceProfilerEnd() {
+  if (TimeTraceProfilerInstance != nullptr)
+    TimeTraceProfilerInstance->end();
+}
+
+} // namespace llvm
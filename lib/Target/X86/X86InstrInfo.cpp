@@ -38,6 +38,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetOptions.h"
+#include <mutex>
 
 using namespace llvm;
 
@@ -8970,7 +8971,10 @@ MachineInstr *X86InstrInfo::foldMemoryOperandImpl(
         return nullptr;
     }
 
-    // Create a constant-pool entry.
+    // Create a constant-pool entry. Machine function passes may be running on
+    // other functions of the module, so hold the lock that guards the
+    // LLVMContext while creating and comparing the constants.
+    std::lock_guard<std::mutex> Lock(MF.getMMI().getIRMutex());
     MachineConstantPool &MCP = *MF.getConstantPool();
     Type *Ty;
     unsigned Opc = LoadMI.getOpcode();
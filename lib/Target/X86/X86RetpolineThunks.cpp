@@ -25,6 +25,7 @@
 #include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/CodeGen/MachineInstrBuilder.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
 #include "llvm/CodeGen/Passes.h"
 #include "llvm/CodeGen/TargetPassConfig.h"
 #include "llvm/IR/IRBuilder.h"
@@ -223,6 +224,12 @@ void X86RetpolineThunks::createThunkFunction(Module &M, StringRef Name) {
 
   // Insert EntryMBB into MF. It's not in the module until we do this.
   MF.insert(MF.end(), EntryMBB);
+
+  // The thunk reaches the remaining machine passes without going through
+  // instruction selection if those run apart from it, see
+  // createParallelMachinePassesPass(). Freeze the reserved registers as
+  // instruction selection would.
+  MF.getRegInfo().freezeReservedRegs(MF);
 }
 
 void X86RetpolineThunks::insertRegReturnAddrClobber(MachineBasicBlock &MBB,
@@ -38,6 +38,7 @@
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/CodeGen.h"
 #include "llvm/Support/CommandLine.h"
@@ -383,6 +384,19 @@ INITIALIZE_PASS_DEPENDENCY(ReachingDefAnalysis)
 INITIALIZE_PASS_END(X86ExecutionDomainFix, "x86-execution-domain-fix",
   "X86 Execution Domain Fix", false, false)
 
+bool X86TargetMachine::canRunMachineFunctionPassesConcurrently(
+    const Module &M) const {
+  // The retpoline thunks are added to the module by a machine function pass.
+  for (const Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    const X86Subtarget *STI = getSubtargetImpl(F);
+    if (STI->useRetpoline() && !STI->useRetpolineExternalThunk())
+      return false;
+  }
+  return LLVMTargetMachine::canRunMachineFunctionPassesConcurrently(M);
+}
+
 TargetPassConfig *X86TargetMachine::createPassConfig(PassManagerBase &PM) {
   return new X86PassConfig(*this, PM);
 }
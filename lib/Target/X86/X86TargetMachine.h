@@ -57,6 +57,8 @@ public:
   bool isMachineVerifierClean() const override {
     return false;
   }
+
+  bool canRunMachineFunctionPassesConcurrently(const Module &M) const override;
 };
 
 } // end namespace llvm
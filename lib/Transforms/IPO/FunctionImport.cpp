@@ -42,6 +42,7 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/Internalize.h"
@@ -120,6 +121,15 @@ static cl::opt<bool> EnableImportMetadata(
                                   ),
     cl::Hidden, cl::desc("Enable import metadata like 'thinlto_src_module'"));
 
+namespace llvm {
+/// Maximum number of tasks of each thin link phase that run at once. Shared
+/// with lib/LTO, which parallelizes the index-wide phases.
+cl::opt<unsigned> ThinLinkThreads(
+    "thin-link-threads", cl::init(0), cl::Hidden, cl::value_desc("N"),
+    cl::desc("Run at most N tasks of each thin link phase at once "
+             "(default 0: as many as there are threads)"));
+} // end namespace llvm
+
 /// Summary file to use for function importing when using -function-import from
 /// the command line.
 static cl::opt<std::string>
@@ -243,10 +253,18 @@ updateValueInfoForIndirectCalls(const ModuleSummaryIndex &Index, ValueInfo VI) {
   return Index.getValueInfo(GUID);
 }
 
+/// Export lists of the symbols that the imports of one module need exported
+/// from the other modules, in the order in which they were first found. See
+/// ComputeCrossModuleImport().
+using OrderedExportListsTy = StringMap<SetVector<GlobalValue::GUID>>;
+
+/// Number of imports so far, for -import-cutoff.
+static int ImportCount = 0;
+
+template <class ExportListsTy>
 static void computeImportForReferencedGlobals(
     const FunctionSummary &Summary, const GVSummaryMapTy &DefinedGVSummaries,
-    FunctionImporter::ImportMapTy &ImportList,
-    StringMap<FunctionImporter::ExportSetTy> *ExportLists) {
+    FunctionImporter::ImportMapTy &ImportList, ExportListsTy *ExportLists) {
   for (auto &VI : Summary.refs()) {
     if (DefinedGVSummaries.count(VI.getGUID())) {
       LLVM_DEBUG(
@@ -273,15 +291,14 @@ static void computeImportForReferencedGlobals(
 /// Compute the list of functions to import for a given caller. Mark these
 /// imported functions and the symbols they reference in their source module as
 /// exported from their source module.
+template <class ExportListsTy>
 static void computeImportForFunction(
     const FunctionSummary &Summary, const ModuleSummaryIndex &Index,
     const unsigned Threshold, const GVSummaryMapTy &DefinedGVSummaries,
     SmallVectorImpl<EdgeInfo> &Worklist,
-    FunctionImporter::ImportMapTy &ImportList,
-    StringMap<FunctionImporter::ExportSetTy> *ExportLists = nullptr) {
+    FunctionImporter::ImportMapTy &ImportList, ExportListsTy *ExportLists) {
   computeImportForReferencedGlobals(Summary, DefinedGVSummaries, ImportList,
                                     ExportLists);
-  static int ImportCount = 0;
   for (auto &Edge : Summary.calls()) {
     ValueInfo VI = Edge.first;
     LLVM_DEBUG(dbgs() << " edge -> " << VI.getGUID()
@@ -356,7 +373,10 @@ static void computeImportForFunction(
     // Mark this function as imported in this module, with the current Threshold
     ProcessedThreshold = AdjThreshold;
 
-    ImportCount++;
+    // Only -import-cutoff needs the count, and it forces a serial import
+    // computation, so don't race on it otherwise.
+    if (ImportCutoff >= 0)
+      ImportCount++;
 
     // Make exports in the source module.
     if (ExportLists) {
@@ -388,10 +408,11 @@ static void computeImportForFunction(
 /// Given the list of globals defined in a module, compute the list of imports
 /// as well as the list of "exports", i.e. the list of symbols referenced from
 /// another module (that may require promotion).
+template <class ExportListsTy = StringMap<FunctionImporter::ExportSetTy>>
 static void ComputeImportForModule(
     const GVSummaryMapTy &DefinedGVSummaries, const ModuleSummaryIndex &Index,
     FunctionImporter::ImportMapTy &ImportList,
-    StringMap<FunctionImporter::ExportSetTy> *ExportLists = nullptr) {
+    ExportListsTy *ExportLists = nullptr) {
   // Worklist contains the list of function imported in this module, for which
   // we will analyse the callees and may import further down the callgraph.
   SmallVector<EdgeInfo, 128> Worklist;
@@ -468,21 +489,63 @@ void llvm::ComputeCrossModuleImport(
     const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
     StringMap<FunctionImporter::ImportMapTy> &ImportLists,
     StringMap<FunctionImporter::ExportSetTy> &ExportLists) {
+  // -import-cutoff counts imports across all the modules, and debug output
+  // must not be interleaved, so both need the modules processed one by one.
+  bool Serial = ImportCutoff >= 0;
+  LLVM_DEBUG(Serial = true);
+
   // For each module that has function defined, compute the import/export lists.
-  for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries) {
-    auto &ImportList = ImportLists[DefinedGVSummaries.first()];
-    LLVM_DEBUG(dbgs() << "Computing import for Module '"
-                      << DefinedGVSummaries.first() << "'\n");
-    ComputeImportForModule(DefinedGVSummaries.second, Index, ImportList,
-                           &ExportLists);
+  if (Serial) {
+    for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries) {
+      auto &ImportList = ImportLists[DefinedGVSummaries.first()];
+      LLVM_DEBUG(dbgs() << "Computing import for Module '"
+                        << DefinedGVSummaries.first() << "'\n");
+      ComputeImportForModule(DefinedGVSummaries.second, Index, ImportList,
+                             &ExportLists);
+    }
+  } else {
+    // The import list of each module only depends on the index, so the
+    // modules are processed in parallel. What they export to each other is
+    // collected per module, in the order it was found, and merged in module
+    // order afterwards: the export sets then see the same sequence of
+    // insertions as in a serial computation, which keeps even their
+    // iteration order (and thus the ThinLTO cache keys) identical.
+    std::vector<const StringMapEntry<GVSummaryMapTy> *> Modules;
+    std::vector<FunctionImporter::ImportMapTy *> ModuleImportLists;
+    Modules.reserve(ModuleToDefinedGVSummaries.size());
+    ModuleImportLists.reserve(ModuleToDefinedGVSummaries.size());
+    for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries) {
+      Modules.push_back(&DefinedGVSummaries);
+      ModuleImportLists.push_back(&ImportLists[DefinedGVSummaries.first()]);
+    }
+
+    std::vector<OrderedExportListsTy> ModuleExportLists(Modules.size());
+    parallel::for_each_n(parallel::par.withThreads(ThinLinkThreads), size_t(0),
+                         Modules.size(), [&](size_t I) {
+                           ComputeImportForModule(Modules[I]->second, Index,
+                                                  *ModuleImportLists[I],
+                                                  &ModuleExportLists[I]);
+                         });
+
+    for (OrderedExportListsTy &ModuleExports : ModuleExportLists)
+      for (auto &ELI : ModuleExports) {
+        auto &ExportList = ExportLists[ELI.first()];
+        for (GlobalValue::GUID GUID : ELI.second)
+          ExportList.insert(GUID);
+      }
   }
 
   // When computing imports we added all GUIDs referenced by anything
   // imported from the module to its ExportList. Now we prune each ExportList
   // of any not defined in that module. This is more efficient than checking
   // while computing imports because some of the summary lists may be long
-  // due to linkonce (comdat) copies.
-  for (auto &ELI : ExportLists) {
+  // due to linkonce (comdat) copies. Each list is pruned independently.
+  std::vector<StringMapEntry<FunctionImporter::ExportSetTy> *> ExportEntries;
+  ExportEntries.reserve(ExportLists.size());
+  for (auto &ELI : ExportLists)
+    ExportEntries.push_back(&ELI);
+  auto PruneExportList = [&](size_t I) {
+    auto &ELI = *ExportEntries[I];
     const auto &DefinedGVSummaries =
         ModuleToDefinedGVSummaries.lookup(ELI.first());
     for (auto EI = ELI.second.begin(); EI != ELI.second.end();) {
@@ -491,7 +554,13 @@ void llvm::ComputeCrossModuleImport(
       else
         ++EI;
     }
-  }
+  };
+  if (Serial)
+    parallel::for_each_n(parallel::seq, size_t(0), ExportEntries.size(),
+                         PruneExportList);
+  else
+    parallel::for_each_n(parallel::par.withThreads(ThinLinkThreads), size_t(0),
+                         ExportEntries.size(), PruneExportList);
 
 #ifndef NDEBUG
   LLVM_DEBUG(dbgs() << "Import/Export lists for " << ImportLists.size()
@@ -0,0 +1,91 @@
+; Decoding function blocks on other threads must give the same module as
+; decoding them in order.
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-dis < %t.bc > %t.serial.ll
+; RUN: llvm-dis -bitcode-materialize-threads=1 < %t.bc > %t.1.ll
+; RUN: llvm-dis -bitcode-materialize-threads=4 < %t.bc > %t.4.ll
+; RUN: diff %t.serial.ll %t.1.ll
+; RUN: diff %t.serial.ll %t.4.ll
+; RUN: FileCheck %s < %t.4.ll
+
+; RUN: llvm-as -preserve-bc-uselistorder < %s > %t.uselist.bc
+; RUN: llvm-dis -preserve-ll-uselistorder < %t.uselist.bc > %t.uselist.serial.ll
+; RUN: llvm-dis -preserve-ll-uselistorder -bitcode-materialize-threads=2 \
+; RUN:   < %t.uselist.bc > %t.uselist.2.ll
+; RUN: diff %t.uselist.serial.ll %t.uselist.2.ll
+
+@g = global i32 7
+@table = global [2 x i8*] [i8* blockaddress(@jump, %a), i8* blockaddress(@jump, %b)]
+
+; CHECK-LABEL: define i32 @first(i32 %x)
+; CHECK: br i1 %c, label %then, label %else, !prof !
+; CHECK: call i32 @jump(i32 %x), !dbg !
+define i32 @first(i32 %x) !dbg !4 {
+entry:
+  %v = load i32, i32* @g, !tbaa !10
+  %c = icmp eq i32 %v, %x
+  br i1 %c, label %then, label %else, !prof !14
+
+then:
+  %r = call i32 @jump(i32 %x), !dbg !15
+  ret i32 %r
+
+else:
+  %s = add i32 %v, 42, !dbg !15
+  ret i32 %s
+}
+
+; CHECK-LABEL: define i32 @jump(i32 %i)
+; CHECK: indirectbr i8* %dest, [label %a, label %b]
+define i32 @jump(i32 %i) {
+entry:
+  %p = getelementptr [2 x i8*], [2 x i8*]* @table, i32 0, i32 %i
+  %dest = load i8*, i8** %p
+  indirectbr i8* %dest, [label %a, label %b]
+
+a:
+  ret i32 1
+
+b:
+  ret i32 2
+}
+
+; CHECK-LABEL: define i32 @last(i32 %n)
+; CHECK: switch i32 %n, label %done
+; CHECK: phi i32
+define i32 @last(i32 %n) {
+entry:
+  switch i32 %n, label %done [
+    i32 0, label %zero
+    i32 1, label %one
+  ]
+
+zero:
+  br label %done
+
+one:
+  %f = call i32 @first(i32 %n)
+  br label %done
+
+done:
+  %res = phi i32 [ 3, %entry ], [ 4, %zero ], [ %f, %one ]
+  ret i32 %res
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: true, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "t.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = distinct !DISubprogram(name: "first", scope: !1, file: !1, line: 1, type: !5, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: true, unit: !0, retainedNodes: !2)
+!5 = !DISubroutineType(types: !6)
+!6 = !{!7, !7}
+!7 = !DIBasicType(name: "int", size: 32, encoding: DW_ATE_signed)
+!10 = !{!11, !11, i64 0}
+!11 = !{!"int", !12, i64 0}
+!12 = !{!"omnipotent char", !13, i64 0}
+!13 = !{!"Simple C/C++ TBAA"}
+!14 = !{!"branch_weights", i32 1, i32 9}
+!15 = !DILocation(line: 2, column: 3, scope: !4)
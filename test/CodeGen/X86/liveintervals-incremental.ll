@@ -0,0 +1,65 @@
+; REQUIRES: asserts
+; RUN: llc -mtriple=x86_64-- -O2 -stats < %s -o /dev/null 2>&1 | FileCheck %s
+; RUN: llc -mtriple=x86_64-- -O2 -early-live-intervals -stats < %s -o /dev/null 2>&1 | FileCheck %s --check-prefix=EARLY
+
+; Live intervals are computed once per function. With -early-live-intervals
+; they are computed before PHI elimination and the two-address pass, which
+; update them in place instead of having them recomputed.
+
+; CHECK: 3 regalloc - Number of times live intervals were computed
+; CHECK-NOT: regalloc - Number of moved instructions updated in place
+; EARLY: 3 regalloc - Number of times live intervals were computed
+; EARLY: {{[1-9][0-9]*}} regalloc - Number of moved instructions updated in place
+
+define i32 @loop(i32 %n, i32 %a, i32 %b) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ %a, %entry ], [ %s.next, %loop ]
+  %t = phi i32 [ %b, %entry ], [ %t.next, %loop ]
+  %s.next = add i32 %s, %t
+  %t.next = sub i32 %t, %i
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  %r = mul i32 %s.next, %t.next
+  ret i32 %r
+}
+
+define i64 @straight(i64 %x, i64 %y, i64 %z) {
+  %a = add i64 %x, %y
+  %b = xor i64 %a, %z
+  %c = shl i64 %b, 3
+  %d = or i64 %c, %a
+  ret i64 %d
+}
+
+; The two-address pass sinks each xor below the compare that still reads its
+; source instead of copying the source, and updates the live intervals of
+; the moved instruction when they already exist.
+define i8 @sink(i8* %p) {
+entry:
+  %q = getelementptr inbounds i8, i8* %p, i64 1
+  %a = load i8, i8* %p
+  %b = load i8, i8* %q
+  %na = xor i8 %a, -1
+  %nb = xor i8 %b, -1
+  %c = icmp ult i8 %b, %a
+  br i1 %c, label %then, label %else
+
+then:
+  %s1 = sub i8 %na, %nb
+  br label %exit
+
+else:
+  %s2 = sub i8 %nb, %na
+  br label %exit
+
+exit:
+  %r = phi i8 [ %s1, %then ], [ %s2, %else ]
+  ret i8 %r
+}
@@ -0,0 +1,139 @@
+; Check that running the machine function passes on several threads produces
+; the same output as running them on one.
+;
+; REQUIRES: asserts
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu %s -o %t.s
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -machine-function-threads=4 %s \
+; RUN:   -o %t.threads.s
+; RUN: cmp %t.s %t.threads.s
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -filetype=obj %s -o %t.o
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -filetype=obj \
+; RUN:   -machine-function-threads=4 %s -o %t.threads.o
+; RUN: cmp %t.o %t.threads.o
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -machine-function-threads=4 \
+; RUN:   -stats %s -o /dev/null 2>&1 | FileCheck %s --check-prefix=THREADS
+
+; THREADS: 6 parallel-machine-passes - Number of functions compiled on worker threads
+; THREADS: 4 parallel-machine-passes - Number of machine function pass pipelines built
+
+; The retpoline thunks are added to the module by a machine function pass, so
+; llc keeps the machine function passes of such a module in the main pipeline.
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -mattr=+retpoline %s -o %t.s
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -mattr=+retpoline \
+; RUN:   -machine-function-threads=4 %s -o %t.threads.s
+; RUN: cmp %t.s %t.threads.s
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -mattr=+retpoline \
+; RUN:   -machine-function-threads=4 -stats %s -o /dev/null 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=SERIAL
+
+; SERIAL-NOT: parallel-machine-passes
+
+@table = internal global [4 x i32] [i32 1, i32 2, i32 3, i32 4]
+
+define i32 @sum(i32* %p, i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %idx = sext i32 %i to i64
+  %addr = getelementptr inbounds i32, i32* %p, i64 %idx
+  %v = load i32, i32* %addr
+  %acc.next = add i32 %acc, %v
+  %i.next = add nsw i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  ret i32 %r
+}
+
+define double @poly(double %x) {
+  %a = fmul double %x, 3.250000e+00
+  %b = fadd double %a, 1.500000e+00
+  %c = fmul double %b, %x
+  %d = fadd double %c, -7.125000e+00
+  ret double %d
+}
+
+define i32 @dispatch(i32 %k, i32 %x) {
+entry:
+  switch i32 %k, label %default [
+    i32 0, label %c0
+    i32 1, label %c1
+    i32 2, label %c2
+    i32 3, label %c3
+    i32 4, label %c4
+  ]
+
+c0:
+  %r0 = add i32 %x, 11
+  br label %exit
+c1:
+  %r1 = mul i32 %x, 13
+  br label %exit
+c2:
+  %r2 = sub i32 %x, 17
+  br label %exit
+c3:
+  %r3 = shl i32 %x, 3
+  br label %exit
+c4:
+  %r4 = xor i32 %x, 255
+  br label %exit
+default:
+  br label %exit
+
+exit:
+  %r = phi i32 [ %r0, %c0 ], [ %r1, %c1 ], [ %r2, %c2 ], [ %r3, %c3 ],
+               [ %r4, %c4 ], [ 0, %default ]
+  ret i32 %r
+}
+
+declare void @use(i8*)
+declare void @llvm.lifetime.start.p0i8(i64, i8* nocapture)
+declare void @llvm.lifetime.end.p0i8(i64, i8* nocapture)
+
+define void @buffers(i1 %c) sspstrong {
+entry:
+  %a = alloca [64 x i8]
+  %b = alloca [64 x i8]
+  %pa = getelementptr inbounds [64 x i8], [64 x i8]* %a, i64 0, i64 0
+  %pb = getelementptr inbounds [64 x i8], [64 x i8]* %b, i64 0, i64 0
+  br i1 %c, label %left, label %right
+
+left:
+  call void @llvm.lifetime.start.p0i8(i64 64, i8* %pa)
+  call void @use(i8* %pa)
+  call void @llvm.lifetime.end.p0i8(i64 64, i8* %pa)
+  br label %exit
+
+right:
+  call void @llvm.lifetime.start.p0i8(i64 64, i8* %pb)
+  call void @use(i8* %pb)
+  call void @llvm.lifetime.end.p0i8(i64 64, i8* %pb)
+  br label %exit
+
+exit:
+  ret void
+}
+
+define <4 x float> @vectors(<4 x float> %x, <4 x float> %y) {
+  %m = fmul <4 x float> %x, <float 1.0, float 2.0, float 3.0, float 4.0>
+  %s = fadd <4 x float> %m, %y
+  %z = fcmp olt <4 x float> %s, zeroinitializer
+  %r = select <4 x i1> %z, <4 x float> zeroinitializer, <4 x float> %s
+  ret <4 x float> %r
+}
+
+define i32 @indirect(i32 (i32)* %f, i32 %k) {
+  %idx = and i32 %k, 3
+  %ext = zext i32 %idx to i64
+  %addr = getelementptr inbounds [4 x i32], [4 x i32]* @table, i64 0, i64 %ext
+  %v = load i32, i32* %addr
+  %r = call i32 %f(i32 %v)
+  ret i32 %r
+}
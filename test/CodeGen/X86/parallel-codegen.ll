@@ -0,0 +1,47 @@
+; Check that llc -j splits the module and writes one assembly file per
+; partition, which together define every function.
+;
+; RUN: rm -f %t.0 %t.1
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -j2 %s -o %t
+; RUN: cat %t.0 %t.1 | FileCheck %s
+; RUN: not llc -mtriple=x86_64-unknown-linux-gnu -j2 %s -o - 2>&1 \
+; RUN:   | FileCheck %s --check-prefix=NO-OUTPUT
+
+; CHECK-DAG: {{^}}foo:
+; CHECK-DAG: {{^}}bar:
+; CHECK-DAG: {{^}}baz:
+; CHECK-DAG: {{^}}helper:
+; CHECK-DAG: {{^}}counter:
+
+; Locals are not externalized to split the module.
+; RUN: cat %t.0 %t.1 | FileCheck %s --check-prefix=LOCAL
+; LOCAL-NOT: .globl{{.*}}helper
+; LOCAL-NOT: .globl{{.*}}counter
+; LOCAL-NOT: .hidden
+
+; NO-OUTPUT: -j must be specified together with -o
+
+define i32 @foo(i32 %x) {
+  %r = call i32 @bar(i32 %x)
+  ret i32 %r
+}
+
+define i32 @bar(i32 %x) {
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @baz(i32 %x) {
+  %r = mul i32 %x, 3
+  %s = call i32 @helper(i32 %r)
+  ret i32 %s
+}
+
+@counter = internal global i32 1
+
+define internal i32 @helper(i32 %x) {
+  %c = load i32, i32* @counter
+  %r = add i32 %c, %x
+  store i32 %r, i32* @counter
+  ret i32 %r
+}
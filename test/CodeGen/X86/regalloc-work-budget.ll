@@ -0,0 +1,117 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -verify-machineinstrs \
+; RUN:   -regalloc-work-budget=1 -pass-remarks-analysis=regalloc 2>&1 \
+; RUN:   | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -verify-machineinstrs \
+; RUN:   -pass-remarks-analysis=regalloc 2>&1 | FileCheck %s --check-prefix=NOBUDGET
+
+; Once the work budget runs out the greedy allocator gives up region
+; splitting, then all splitting, then eviction, and says so in a remark. The
+; result is still correct code.
+
+; CHECK: remark: <unknown>:0:0: register allocation work budget exhausted after {{[0-9]+}} units, disabling region splitting
+; CHECK: remark: <unknown>:0:0: register allocation work budget exhausted after {{[0-9]+}} units, disabling live range splitting
+; CHECK: remark: <unknown>:0:0: register allocation work budget exhausted after {{[0-9]+}} units, disabling eviction
+; CHECK-NOT: work budget
+; CHECK-LABEL: pressure:
+; CHECK: callq g
+; CHECK: retq
+
+; NOBUDGET-NOT: work budget
+; NOBUDGET-LABEL: pressure:
+
+declare void @g()
+
+define void @pressure(i32* %p, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %a0 = getelementptr i32, i32* %p, i32 0
+  %v0 = load volatile i32, i32* %a0
+  %a1 = getelementptr i32, i32* %p, i32 1
+  %v1 = load volatile i32, i32* %a1
+  %a2 = getelementptr i32, i32* %p, i32 2
+  %v2 = load volatile i32, i32* %a2
+  %a3 = getelementptr i32, i32* %p, i32 3
+  %v3 = load volatile i32, i32* %a3
+  %a4 = getelementptr i32, i32* %p, i32 4
+  %v4 = load volatile i32, i32* %a4
+  %a5 = getelementptr i32, i32* %p, i32 5
+  %v5 = load volatile i32, i32* %a5
+  %a6 = getelementptr i32, i32* %p, i32 6
+  %v6 = load volatile i32, i32* %a6
+  %a7 = getelementptr i32, i32* %p, i32 7
+  %v7 = load volatile i32, i32* %a7
+  %a8 = getelementptr i32, i32* %p, i32 8
+  %v8 = load volatile i32, i32* %a8
+  %a9 = getelementptr i32, i32* %p, i32 9
+  %v9 = load volatile i32, i32* %a9
+  %a10 = getelementptr i32, i32* %p, i32 10
+  %v10 = load volatile i32, i32* %a10
+  %a11 = getelementptr i32, i32* %p, i32 11
+  %v11 = load volatile i32, i32* %a11
+  %a12 = getelementptr i32, i32* %p, i32 12
+  %v12 = load volatile i32, i32* %a12
+  %a13 = getelementptr i32, i32* %p, i32 13
+  %v13 = load volatile i32, i32* %a13
+  %a14 = getelementptr i32, i32* %p, i32 14
+  %v14 = load volatile i32, i32* %a14
+  %a15 = getelementptr i32, i32* %p, i32 15
+  %v15 = load volatile i32, i32* %a15
+  %a16 = getelementptr i32, i32* %p, i32 16
+  %v16 = load volatile i32, i32* %a16
+  %a17 = getelementptr i32, i32* %p, i32 17
+  %v17 = load volatile i32, i32* %a17
+  %a18 = getelementptr i32, i32* %p, i32 18
+  %v18 = load volatile i32, i32* %a18
+  %a19 = getelementptr i32, i32* %p, i32 19
+  %v19 = load volatile i32, i32* %a19
+  call void @g()
+  %w0 = add i32 %v0, %i
+  store volatile i32 %w0, i32* %a0
+  %w1 = add i32 %v1, %i
+  store volatile i32 %w1, i32* %a1
+  %w2 = add i32 %v2, %i
+  store volatile i32 %w2, i32* %a2
+  %w3 = add i32 %v3, %i
+  store volatile i32 %w3, i32* %a3
+  %w4 = add i32 %v4, %i
+  store volatile i32 %w4, i32* %a4
+  %w5 = add i32 %v5, %i
+  store volatile i32 %w5, i32* %a5
+  %w6 = add i32 %v6, %i
+  store volatile i32 %w6, i32* %a6
+  %w7 = add i32 %v7, %i
+  store volatile i32 %w7, i32* %a7
+  %w8 = add i32 %v8, %i
+  store volatile i32 %w8, i32* %a8
+  %w9 = add i32 %v9, %i
+  store volatile i32 %w9, i32* %a9
+  %w10 = add i32 %v10, %i
+  store volatile i32 %w10, i32* %a10
+  %w11 = add i32 %v11, %i
+  store volatile i32 %w11, i32* %a11
+  %w12 = add i32 %v12, %i
+  store volatile i32 %w12, i32* %a12
+  %w13 = add i32 %v13, %i
+  store volatile i32 %w13, i32* %a13
+  %w14 = add i32 %v14, %i
+  store volatile i32 %w14, i32* %a14
+  %w15 = add i32 %v15, %i
+  store volatile i32 %w15, i32* %a15
+  %w16 = add i32 %v16, %i
+  store volatile i32 %w16, i32* %a16
+  %w17 = add i32 %v17, %i
+  store volatile i32 %w17, i32* %a17
+  %w18 = add i32 %v18, %i
+  store volatile i32 %w18, i32* %a18
+  %w19 = add i32 %v19, %i
+  store volatile i32 %w19, i32* %a19
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,25 @@
+; REQUIRES: asserts
+; RUN: llc -mtriple=x86_64-- -stats < %s -o /dev/null 2>&1 | FileCheck %s
+
+; The DAG of every block is cleared for the next one, and nodes asked for
+; twice are answered by CSE.
+
+; CHECK: {{[0-9]+}} selectiondag - Number of node requests answered by CSE
+; CHECK: {{[0-9]+}} selectiondag - Number of nodes added to the DAG
+; CHECK: {{[0-9]+}} selectiondag - Number of nodes released by clearing the DAG
+
+define i32 @f(i32 %a, i32 %b, i1 %c) {
+entry:
+  %x = add i32 %a, %b
+  %y = add i32 %a, %b
+  %z = mul i32 %x, %y
+  br i1 %c, label %then, label %exit
+
+then:
+  %w = add i32 %z, %a
+  br label %exit
+
+exit:
+  %r = phi i32 [ %z, %entry ], [ %w, %then ]
+  ret i32 %r
+}
@@ -0,0 +1,15 @@
+; RUN: llc -mtriple=x86_64-unknown-unknown -time-trace \
+; RUN:     -time-trace-granularity=0 -time-trace-file=%t.json < %s -o /dev/null
+; RUN: FileCheck %s < %t.json
+
+; CHECK: {"traceEvents":[
+; CHECK-DAG: "name":"X86 DAG->DAG Instruction Selection","args":{"detail":"foo"}
+; CHECK-DAG: "name":"Instruction Selection","args":{"detail":"foo"}
+; CHECK-DAG: "name":"AsmPrinter Finalization"
+; CHECK-DAG: "name":"Compile Module","args":{"detail":"-"}
+; CHECK-DAG: "name":"process_name"
+
+define i32 @foo(i32 %x) {
+  %a = add i32 %x, 1
+  ret i32 %a
+}
@@ -0,0 +1,42 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-memory-pool %s | FileCheck %s
+;
+; Each function is compiled into its own object with its own memory manager.
+; With the memory pool those managers take their pages from shared slabs
+; instead of mapping them one by one, and the code and strings of every
+; object must still be intact.
+;
+; CHECK: foo
+; CHECK: bar
+; CHECK: baz
+
+@str.foo = private unnamed_addr constant [4 x i8] c"foo\00"
+@str.bar = private unnamed_addr constant [4 x i8] c"bar\00"
+@str.baz = private unnamed_addr constant [4 x i8] c"baz\00"
+
+declare i32 @puts(i8*)
+
+define void @baz() {
+entry:
+  %0 = call i32 @puts(i8* getelementptr inbounds ([4 x i8], [4 x i8]* @str.baz, i64 0, i64 0))
+  ret void
+}
+
+define void @bar() {
+entry:
+  %0 = call i32 @puts(i8* getelementptr inbounds ([4 x i8], [4 x i8]* @str.bar, i64 0, i64 0))
+  call void @baz()
+  ret void
+}
+
+define void @foo() {
+entry:
+  %0 = call i32 @puts(i8* getelementptr inbounds ([4 x i8], [4 x i8]* @str.foo, i64 0, i64 0))
+  call void @bar()
+  ret void
+}
+
+define i32 @main(i32 %argc, i8** %argv) {
+entry:
+  call void @foo()
+  ret i32 0
+}
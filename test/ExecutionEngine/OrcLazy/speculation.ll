@@ -0,0 +1,67 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-speculate-depth=2 \
+; RUN:   -orc-lazy-speculate-threads=2 %s | FileCheck %s
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-speculate-depth=2 \
+; RUN:   -orc-lazy-speculate-threads=2 -stats %s 2>&1 >/dev/null \
+; RUN:   | FileCheck -check-prefix=STATS %s
+; REQUIRES: asserts
+;
+; Speculative compilation of the callees must not change what the program
+; does, including for the cold callee that is never speculated on.
+;
+; CHECK: foo
+; CHECK: bar
+; CHECK: baz
+; CHECK-NOT: qux
+;
+; The calls to foo and bar race with their speculative compiles, but qux is
+; never called, so it is always compiled speculatively.
+;
+; STATS: {{[1-9][0-9]*}} lli - Number of functions compiled speculatively
+
+@str.foo = private unnamed_addr constant [4 x i8] c"foo\00"
+@str.bar = private unnamed_addr constant [4 x i8] c"bar\00"
+@str.baz = private unnamed_addr constant [4 x i8] c"baz\00"
+
+declare i32 @puts(i8*)
+
+define void @baz() cold {
+entry:
+  %0 = call i32 @puts(i8* getelementptr inbounds ([4 x i8], [4 x i8]* @str.baz, i64 0, i64 0))
+  ret void
+}
+
+define void @bar() {
+entry:
+  %0 = call i32 @puts(i8* getelementptr inbounds ([4 x i8], [4 x i8]* @str.bar, i64 0, i64 0))
+  call void @baz()
+  ret void
+}
+
+define void @foo() {
+entry:
+  %0 = call i32 @puts(i8* getelementptr inbounds ([4 x i8], [4 x i8]* @str.foo, i64 0, i64 0))
+  call void @bar()
+  ret void
+}
+
+@str.qux = private unnamed_addr constant [4 x i8] c"qux\00"
+
+define void @qux() {
+entry:
+  %0 = call i32 @puts(i8* getelementptr inbounds ([4 x i8], [4 x i8]* @str.qux, i64 0, i64 0))
+  ret void
+}
+
+define i32 @main(i32 %argc, i8** %argv) {
+entry:
+  call void @foo()
+  %never = icmp sgt i32 %argc, 1000
+  br i1 %never, label %call.qux, label %exit
+
+call.qux:
+  call void @qux()
+  br label %exit
+
+exit:
+  ret i32 0
+}
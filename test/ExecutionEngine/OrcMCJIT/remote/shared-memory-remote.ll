@@ -0,0 +1,30 @@
+; RUN: %lli -jit-kind=orc-mcjit -remote-mcjit -remote-shared-memory \
+; RUN:   -mcjit-remote-process=lli-child-target%exeext %s > /dev/null
+; XFAIL: mingw32,win32
+; UNSUPPORTED: powerpc64-unknown-linux-gnu
+
+; Code, read-only data and writable data all live in memory shared with the
+; child process. main returns 0 only if all three arrived intact.
+
+@count = global i32 42, align 4
+@table = private unnamed_addr constant [4 x i32] [i32 1, i32 2, i32 3, i32 4], align 16
+
+define i32 @sum() nounwind {
+entry:
+  %a = load i32, i32* getelementptr inbounds ([4 x i32], [4 x i32]* @table, i64 0, i64 0)
+  %b = load i32, i32* getelementptr inbounds ([4 x i32], [4 x i32]* @table, i64 0, i64 3)
+  %s = add i32 %a, %b
+  ret i32 %s
+}
+
+define i32 @main() nounwind {
+entry:
+  %c = load i32, i32* @count, align 4
+  %inc = add i32 %c, 1
+  store i32 %inc, i32* @count, align 4
+  %s = call i32 @sum()
+  %c2 = load i32, i32* @count, align 4
+  %t = add i32 %s, %c2
+  %r = sub i32 %t, 48
+  ret i32 %r
+}
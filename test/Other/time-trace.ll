@@ -0,0 +1,29 @@
+; Check that -time-trace writes a Chrome trace event file with one event per
+; pass and IR unit, for both pass managers.
+;
+; RUN: opt -time-trace -time-trace-granularity=0 -time-trace-file=%t.legacy.json \
+; RUN:     -instcombine -disable-output %s
+; RUN: FileCheck %s --check-prefix=LEGACY < %t.legacy.json
+; RUN: opt -time-trace -time-trace-granularity=0 -time-trace-file=%t.new.json \
+; RUN:     -passes=instcombine -disable-output %s
+; RUN: FileCheck %s --check-prefix=NEW < %t.new.json
+
+; LEGACY: {"traceEvents":[
+; LEGACY-DAG: "name":"Combine redundant instructions","args":{"detail":"foo"}
+; LEGACY-DAG: "name":"Total Combine redundant instructions","args":{"count":"2"}
+; LEGACY-DAG: "name":"process_name"
+
+; NEW: {"traceEvents":[
+; NEW-DAG: "name":"InstCombinePass","args":{"detail":"foo"}
+; NEW-DAG: "name":"InstCombinePass","args":{"detail":"bar"}
+; NEW-DAG: "name":"process_name"
+
+define i32 @foo(i32 %x) {
+  %a = add i32 %x, 0
+  ret i32 %a
+}
+
+define i32 @bar(i32 %x) {
+  %a = mul i32 %x, 1
+  ret i32 %a
+}
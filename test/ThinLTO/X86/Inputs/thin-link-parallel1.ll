@@ -0,0 +1,22 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@internal_counter = internal global i32 0
+
+define i32 @f(i32 %x) {
+entry:
+  %c = load i32, i32* @internal_counter
+  %n = add i32 %c, %x
+  store i32 %n, i32* @internal_counter
+  %r = call i32 @g(i32 %n)
+  %s = call i32 @common(i32 %r)
+  ret i32 %s
+}
+
+define linkonce_odr i32 @common(i32 %x) {
+entry:
+  %r = mul i32 %x, 3
+  ret i32 %r
+}
+
+declare i32 @g(i32)
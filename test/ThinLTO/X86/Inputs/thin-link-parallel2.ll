@@ -0,0 +1,21 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @g(i32 %x) {
+entry:
+  %h = call i32 @h(i32 %x)
+  %r = call i32 @common(i32 %h)
+  ret i32 %r
+}
+
+define internal i32 @h(i32 %x) {
+entry:
+  %r = xor i32 %x, 5
+  ret i32 %r
+}
+
+define linkonce_odr i32 @common(i32 %x) {
+entry:
+  %r = mul i32 %x, 3
+  ret i32 %r
+}
@@ -0,0 +1,54 @@
+; Test the summary index image form of the combined and distributed indexes.
+
+; RUN: opt -module-summary %s -o %t1.bc
+; RUN: opt -module-summary %p/Inputs/distributed_import.ll -o %t2.bc
+
+; Perform the thin link and write the distributed indexes, both as bitcode and
+; as images.
+; RUN: llvm-lto -thinlto-action=thinlink -o %t.index.bc %t1.bc %t2.bc
+; RUN: llvm-lto -thinlto-action=thinlink -thinlto-index-image \
+; RUN:     -o %t.index.img %t1.bc %t2.bc
+; RUN: llvm-lto -thinlto-action=distributedindexes -thinlto-index %t.index.bc \
+; RUN:     %t1.bc %t2.bc
+; RUN: mv %t1.bc.thinlto.bc %t1.bc.thinlto.bc.orig
+; RUN: mv %t2.bc.thinlto.bc %t2.bc.thinlto.bc.orig
+; RUN: llvm-lto -thinlto-action=distributedindexes -thinlto-index-image \
+; RUN:     -thinlto-index %t.index.img %t1.bc %t2.bc
+
+; The images hold the same summaries as the bitcode indexes.
+; RUN: llvm-lto -thinlto-index-stats %t.index.bc | FileCheck %s --check-prefix=STATS
+; RUN: llvm-lto -thinlto-index-stats %t.index.img | FileCheck %s --check-prefix=STATS
+; STATS: contains 5 nodes (3 functions, 1 alias, 1 globals) and 3 edges (1 refs and 2 calls)
+
+; The distributed backends import the same functions from both forms.
+; RUN: opt -function-import -import-all-index -enable-import-metadata \
+; RUN:     -summary-file %t1.bc.thinlto.bc.orig %t1.bc -o %t1.orig.out
+; RUN: opt -function-import -import-all-index -enable-import-metadata \
+; RUN:     -summary-file %t1.bc.thinlto.bc %t1.bc -o %t1.out
+; RUN: llvm-dis -o - %t1.out | FileCheck %s --check-prefix=IMPORT
+; RUN: cmp %t1.orig.out %t1.out
+; RUN: opt -function-import -import-all-index \
+; RUN:     -summary-file %t2.bc.thinlto.bc %t2.bc -o %t2.out
+; RUN: llvm-dis -o - %t2.out | FileCheck %s --check-prefix=EXPORT
+
+; IMPORT: define available_externally i32 @g() !thinlto_src_module
+; IMPORT: define available_externally void @analias() !thinlto_src_module
+; EXPORT: @G.llvm.
+
+; A malformed image is diagnosed.
+; RUN: head -c 40 %t.index.img > %t.truncated.img
+; RUN: not llvm-lto -thinlto-index-stats %t.truncated.img 2>&1 | FileCheck %s --check-prefix=ERROR
+; ERROR: Invalid summary index image: missing header
+
+target triple = "x86_64-unknown-linux-gnu"
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+declare i32 @g(...)
+declare void @analias(...)
+
+define void @f() {
+entry:
+  call i32 (...) @g()
+  call void (...) @analias()
+  ret void
+}
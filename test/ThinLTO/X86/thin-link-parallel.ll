@@ -0,0 +1,86 @@
+; Check that the thin link gives the same result whether its phases run on one
+; thread or on several: the import and export decisions end up in the
+; distributed index and import files, and in the objects of the backends.
+
+; RUN: opt -module-summary %s -o %t1.bc
+; RUN: opt -module-summary %p/Inputs/thin-link-parallel1.ll -o %t2.bc
+; RUN: opt -module-summary %p/Inputs/thin-link-parallel2.ll -o %t3.bc
+
+; RUN: rm -f %t1.bc.thinlto.bc %t2.bc.thinlto.bc %t3.bc.thinlto.bc
+; RUN: llvm-lto2 run %t1.bc %t2.bc %t3.bc -o %t.dist \
+; RUN:     -thinlto-distributed-indexes -thin-link-threads=1 \
+; RUN:     -r=%t1.bc,main,px -r=%t1.bc,f, -r=%t1.bc,g, \
+; RUN:     -r=%t2.bc,f,px -r=%t2.bc,g, -r=%t2.bc,common,px \
+; RUN:     -r=%t3.bc,g,px -r=%t3.bc,common,
+; RUN: cp %t1.bc.thinlto.bc %t1.serial.thinlto.bc
+; RUN: cp %t2.bc.thinlto.bc %t2.serial.thinlto.bc
+; RUN: cp %t3.bc.thinlto.bc %t3.serial.thinlto.bc
+; RUN: cp %t1.bc.imports %t1.serial.imports
+; RUN: cp %t2.bc.imports %t2.serial.imports
+; RUN: cp %t3.bc.imports %t3.serial.imports
+
+; Split the combined index into tasks of a single GUID so that the index-wide
+; phases are spread over several tasks too.
+; RUN: rm -f %t1.bc.thinlto.bc %t2.bc.thinlto.bc %t3.bc.thinlto.bc
+; RUN: llvm-lto2 run %t1.bc %t2.bc %t3.bc -o %t.dist \
+; RUN:     -thinlto-distributed-indexes -thin-link-threads=4 \
+; RUN:     -thin-link-guid-chunk-size=1 \
+; RUN:     -r=%t1.bc,main,px -r=%t1.bc,f, -r=%t1.bc,g, \
+; RUN:     -r=%t2.bc,f,px -r=%t2.bc,g, -r=%t2.bc,common,px \
+; RUN:     -r=%t3.bc,g,px -r=%t3.bc,common,
+; RUN: cmp %t1.bc.thinlto.bc %t1.serial.thinlto.bc
+; RUN: cmp %t2.bc.thinlto.bc %t2.serial.thinlto.bc
+; RUN: cmp %t3.bc.thinlto.bc %t3.serial.thinlto.bc
+; RUN: cmp %t1.bc.imports %t1.serial.imports
+; RUN: cmp %t2.bc.imports %t2.serial.imports
+; RUN: cmp %t3.bc.imports %t3.serial.imports
+
+; The first module imports from both others.
+; RUN: FileCheck %s --check-prefix=IMPORTS < %t1.bc.imports
+; IMPORTS-DAG: {{.*}}2.bc
+; IMPORTS-DAG: {{.*}}3.bc
+
+; Run the backends after a serial and a parallel thin link, and time the
+; phases of the latter.
+; RUN: llvm-lto2 run %t1.bc %t2.bc %t3.bc -o %t.serial \
+; RUN:     -thin-link-threads=1 \
+; RUN:     -r=%t1.bc,main,px -r=%t1.bc,f, -r=%t1.bc,g, \
+; RUN:     -r=%t2.bc,f,px -r=%t2.bc,g, -r=%t2.bc,common,px \
+; RUN:     -r=%t3.bc,g,px -r=%t3.bc,common,
+; RUN: llvm-lto2 run %t1.bc %t2.bc %t3.bc -o %t.parallel -save-temps \
+; RUN:     -thin-link-threads=4 -thin-link-guid-chunk-size=1 -time-passes \
+; RUN:     -r=%t1.bc,main,px -r=%t1.bc,f, -r=%t1.bc,g, \
+; RUN:     -r=%t2.bc,f,px -r=%t2.bc,g, -r=%t2.bc,common,px \
+; RUN:     -r=%t3.bc,g,px -r=%t3.bc,common, 2>&1 | FileCheck %s --check-prefix=TIME
+; RUN: cmp %t.serial.1 %t.parallel.1
+; RUN: cmp %t.serial.2 %t.parallel.2
+; RUN: cmp %t.serial.3 %t.parallel.3
+
+; The parallel thin link exported the internal global used by the imported @f,
+; and the first module imported @f, @g and the local @h behind @g.
+; RUN: llvm-dis %t.parallel.2.1.promote.bc -o - | FileCheck %s --check-prefix=EXPORTS
+; EXPORTS: @internal_counter.llvm.0 = hidden global i32 0
+; RUN: llvm-dis %t.parallel.1.3.import.bc -o - | FileCheck %s --check-prefix=IMPORTED
+; IMPORTED-DAG: define available_externally i32 @f(
+; IMPORTED-DAG: define available_externally i32 @g(
+; IMPORTED-DAG: define available_externally hidden i32 @h.llvm.0(
+
+; TIME: Thin link
+; TIME-DAG: Compute dead symbols
+; TIME-DAG: Collect defined summaries per module
+; TIME-DAG: Compute cross-module imports
+; TIME-DAG: Internalize and promote
+; TIME-DAG: Resolve weak for linker
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @main() {
+entry:
+  %a = call i32 @f(i32 1)
+  %b = call i32 @g(i32 %a)
+  ret i32 %b
+}
+
+declare i32 @f(i32)
+declare i32 @g(i32)
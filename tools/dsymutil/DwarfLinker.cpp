@@ -585,9 +585,20 @@ static bool inFunctionScope(CompileUnit &U, unsigned Idx) {
   }
   return false;
 }
+
+/// Warnings reported on the current thread while this is set are collected
+/// here as (warning, context) pairs instead of being printed. This lets the
+/// objects of a link be prepared concurrently while their diagnostics are
+/// still emitted in object order.
+LLVM_THREAD_LOCAL std::vector<std::pair<std::string, std::string>>
+    *BufferedWarnings = nullptr;
 } // namespace
 
 void warn(Twine Warning, Twine Context) {
+  if (BufferedWarnings) {
+    BufferedWarnings->emplace_back(Warning.str(), Context.str());
+    return;
+  }
   WithColor::warning() << Warning + "\n";
   if (!Context.isTriviallyEmpty())
     WithColor::note() << Twine("while processing ") + Context + "\n";
@@ -1560,6 +1571,10 @@ private:
     RangesTy Ranges;
     UnitListTy CompileUnits;
 
+    /// Warnings reported by DwarfLinker::prepareObject() when it ran on a
+    /// worker thread, waiting to be printed in object order.
+    std::vector<std::pair<std::string, std::string>> PendingWarnings;
+
     LinkContext(const DebugMap &Map, DwarfLinker &Linker, DebugMapObject &DMO,
                 bool Verbose = false)
         : DMO(DMO), BinHolder(Verbose), RelocMgr(Linker) {
@@ -1580,6 +1595,12 @@ private:
     }
   };
 
+  /// Do the parts of the link of \p Context that only touch that object:
+  /// find the relocations against debug map entries, extract the DIEs of
+  /// every compile unit and parse their line tables. This does not depend on
+  /// the other objects of the link, so it can run on a worker thread.
+  void prepareObject(LinkContext &Context);
+
   /// Called at the start of a debug object link.
   void startDebugObject(LinkContext &Context);
 
@@ -2272,6 +2293,36 @@ static bool dieNeedsChildrenToBeMeaningful(uint32_t Tag) {
   llvm_unreachable("Invalid Tag");
 }
 
+/// Report the problems found while parsing a line table the same way
+/// DWARFDebugLine::warn() does, but through warn() so that they can be
+/// buffered.
+static void warnLineTableError(Error Err) {
+  handleAllErrors(std::move(Err),
+                  [](ErrorInfoBase &Info) { warn(Info.message()); });
+}
+
+void DwarfLinker::prepareObject(LinkContext &Context) {
+  if (!Context.ObjectFile || !Context.DwarfContext)
+    return;
+
+  // Look for relocations that correspond to debug map entries.
+  if (LLVM_LIKELY(!Options.Update) &&
+      !Context.RelocMgr.findValidRelocsInDebugInfo(*Context.ObjectFile,
+                                                   Context.DMO))
+    return;
+
+  for (const auto &CU : Context.DwarfContext->compile_units()) {
+    if (!CU->getUnitDIE(false))
+      continue;
+    // Parsing the line table caches it in the DWARFContext, where both
+    // analyzeContextInfo() and patchLineTableForUnit() will find it.
+    auto LineTable =
+        Context.DwarfContext->getLineTableForUnit(CU.get(), warnLineTableError);
+    if (!LineTable)
+      warnLineTableError(LineTable.takeError());
+  }
+}
+
 void DwarfLinker::startDebugObject(LinkContext &Context) {
   // Iterate over the debug map entries and put all the ones that are
   // functions (because they have a size) into the Ranges map. This map is
@@ -3598,16 +3649,19 @@ void DwarfLinker::patchLineTableForUnit(CompileUnit &Unit,
   if (auto *OutputDIE = Unit.getOutputUnitDIE())
     patchStmtList(*OutputDIE, DIEInteger(Streamer->getLineSectionSize()));
 
-  // Parse the original line info for the unit.
-  DWARFDebugLine::LineTable LineTable;
-  uint32_t StmtOffset = *StmtList;
-  DWARFDataExtractor LineExtractor(
-      OrigDwarf.getDWARFObj(), OrigDwarf.getDWARFObj().getLineSection(),
-      OrigDwarf.isLittleEndian(), Unit.getOrigUnit().getAddressByteSize());
-
-  Error Err = LineTable.parse(LineExtractor, &StmtOffset, OrigDwarf,
-                              &Unit.getOrigUnit());
-  DWARFDebugLine::warn(std::move(Err));
+  // Get the original line info for the unit. It has already been parsed,
+  // and any problem reported, by prepareObject(); a table that failed to
+  // parse is still cached with whatever could be read from it.
+  DWARFDebugLine::LineTable EmptyLineTable;
+  auto ExpectedLineTable = OrigDwarf.getLineTableForUnit(
+      &Unit.getOrigUnit(), [](Error Err) { consumeError(std::move(Err)); });
+  const DWARFDebugLine::LineTable *CachedLineTable = nullptr;
+  if (ExpectedLineTable)
+    CachedLineTable = *ExpectedLineTable;
+  else
+    consumeError(ExpectedLineTable.takeError());
+  const DWARFDebugLine::LineTable &LineTable =
+      CachedLineTable ? *CachedLineTable : EmptyLineTable;
 
   // This vector is the output line table.
   std::vector<DWARFDebugLine::Row> NewRows;
@@ -3630,7 +3684,7 @@ void DwarfLinker::patchLineTableForUnit(CompileUnit &Unit,
 
   // Iterate over the object file line info and extract the sequences
   // that correspond to linked functions.
-  for (auto &Row : LineTable.Rows) {
+  for (DWARFDebugLine::Row Row : LineTable.Rows) {
     // Check whether we stepped out of the range. The range is
     // half-open, but consider accept the end address of the range if
     // it is marked as end_sequence in the input (because in that
@@ -4230,7 +4284,30 @@ bool DwarfLinker::link(const DebugMap &Map) {
   // ODR Contexts for the link.
   DeclContextTree ODRContexts;
 
-  for (LinkContext &LinkContext : ObjectContexts) {
+  // The per-object preparation (relocation scanning, DIE extraction and line
+  // table parsing) is independent for each object, so when we are allowed
+  // to use threads it runs ahead of the loop below on a thread pool. The
+  // loop consumes the objects in order, which keeps the unit IDs, the ODR
+  // decisions and the string pool, and therefore the output, identical to a
+  // serial link.
+  std::unique_ptr<ThreadPool> PreparePool;
+  std::vector<std::shared_future<void>> Prepared;
+  if (Options.Threads > 1) {
+    PreparePool = llvm::make_unique<ThreadPool>(Options.Threads);
+    Prepared.reserve(NumObjects);
+    for (LinkContext &LinkContext : ObjectContexts)
+      Prepared.push_back(PreparePool->async([&]() {
+        BufferedWarnings = &LinkContext.PendingWarnings;
+        prepareObject(LinkContext);
+        BufferedWarnings = nullptr;
+      }));
+  }
+
+  for (unsigned I = 0; I != NumObjects; ++I) {
+    LinkContext &LinkContext = ObjectContexts[I];
+    if (PreparePool)
+      Prepared[I].wait();
+
     if (Options.Verbose)
       outs() << "DEBUG MAP OBJECT: " << LinkContext.DMO.getObjectFilename()
              << "\n";
@@ -4272,11 +4349,15 @@ bool DwarfLinker::link(const DebugMap &Map) {
     if (!LinkContext.ObjectFile)
       continue;
 
-    // Look for relocations that correspond to debug map entries.
+    if (PreparePool) {
+      for (const auto &Warning : LinkContext.PendingWarnings)
+        warn(Warning.first, Warning.second.empty() ? Twine() : Warning.second);
+      LinkContext.PendingWarnings.clear();
+    } else {
+      prepareObject(LinkContext);
+    }
 
-    if (LLVM_LIKELY(!Options.Update) &&
-        !LinkContext.RelocMgr.findValidRelocsInDebugInfo(
-            *LinkContext.ObjectFile, LinkContext.DMO)) {
+    if (LLVM_LIKELY(!Options.Update) && !LinkContext.RelocMgr.hasValidRelocs()) {
       if (Options.Verbose)
         outs() << "No valid relocations found. Skipping.\n";
 
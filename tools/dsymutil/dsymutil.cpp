@@ -98,7 +98,8 @@ static alias UpdateA("u", desc("Alias for --update"), aliasopt(Update));
 static opt<unsigned> NumThreads(
     "num-threads",
     desc("Specifies the maximum number (n) of simultaneous threads to use\n"
-         "when linking multiple architectures."),
+         "when linking multiple architectures and when reading the debug\n"
+         "info of the object files."),
     value_desc("n"), init(0), cat(DsymCategory));
 static alias NumThreadsA("j", desc("Alias for --num-threads"),
                          aliasopt(NumThreads));
@@ -323,8 +324,8 @@ static Expected<LinkOptions> getOptions() {
         inconvertibleErrorCode());
   }
 
-  if (NumThreads == 0)
-    Options.Threads = llvm::thread::hardware_concurrency();
+  Options.Threads =
+      NumThreads == 0 ? llvm::thread::hardware_concurrency() : NumThreads;
   if (DumpDebugMap || Verbose)
     Options.Threads = 1;
 
@@ -14,6 +14,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/CodeGen/CommandFlags.inc"
@@ -22,6 +23,7 @@
 #include "llvm/CodeGen/MIRParser/MIRParser.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/CodeGen/TargetPassConfig.h"
 #include "llvm/CodeGen/TargetSubtargetInfo.h"
 #include "llvm/IR/AutoUpgrade.h"
@@ -47,9 +49,11 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/Utils/Cloning.h"
+#include <list>
 #include <memory>
 using namespace llvm;
 
@@ -147,6 +151,34 @@ static cl::opt<std::string>
                     cl::desc("YAML output filename for pass remarks"),
                     cl::value_desc("filename"));
 
+static cl::opt<unsigned>
+    Parallelism("j", cl::Prefix, cl::init(1),
+                cl::desc("Number of code generation threads. With more than "
+                         "one, the module is split into that many partitions "
+                         "written to <output>.<N>"));
+
+static cl::opt<unsigned> MachineFunctionThreads(
+    "machine-function-threads", cl::Hidden, cl::init(1),
+    cl::desc("Number of threads to run the machine function passes on, if "
+             "the module allows it"));
+
+static cl::opt<bool> TimeTrace(
+    "time-trace",
+    cl::desc("Record a hierarchical time trace of the compilation in Chrome "
+             "trace event format"));
+
+static cl::opt<unsigned> TimeTraceGranularity(
+    "time-trace-granularity",
+    cl::desc(
+        "Minimum time granularity (in microseconds) traced by time profiler"),
+    cl::init(500), cl::Hidden);
+
+static cl::opt<std::string>
+    TimeTraceFile("time-trace-file",
+                  cl::desc("Output filename for the time trace (default: "
+                           "<output>.time-trace.json)"),
+                  cl::value_desc("filename"), cl::Hidden);
+
 namespace {
 static ManagedStatic<std::vector<std::string>> RunPassNames;
 
@@ -170,6 +202,7 @@ static cl::opt<RunPassOption, true, cl::parser<std::string>> RunPass(
     cl::value_desc("pass-name"), cl::ZeroOrMore, cl::location(RunPassOpt));
 
 static int compileModule(char **, LLVMContext &);
+static int writeTimeTrace();
 
 static std::unique_ptr<ToolOutputFile> GetOutputStream(const char *TargetName,
                                                        Triple::OSType OS,
@@ -343,17 +376,45 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  if (TimeTrace)
+    timeTraceProfilerInitialize(TimeTraceGranularity, argv[0]);
+
   // Compile the module TimeCompilations times to give better compile time
   // metrics.
-  for (unsigned I = TimeCompilations; I; --I)
+  for (unsigned I = TimeCompilations; I; --I) {
+    TimeTraceScope TimeScope("Compile Module", InputFilename);
     if (int RetVal = compileModule(argv, Context))
       return RetVal;
+  }
+
+  if (TimeTrace) {
+    if (int RetVal = writeTimeTrace())
+      return RetVal;
+  }
 
   if (YamlFile)
     YamlFile->keep();
   return 0;
 }
 
+static int writeTimeTrace() {
+  std::string TraceFilename = TimeTraceFile;
+  if (TraceFilename.empty())
+    TraceFilename = OutputFilename == "-" ? std::string("time-trace.json")
+                                          : OutputFilename + ".time-trace.json";
+
+  std::error_code EC;
+  ToolOutputFile TraceOut(TraceFilename, EC, sys::fs::F_Text);
+  if (EC) {
+    errs() << EC.message() << '\n';
+    return 1;
+  }
+  timeTraceProfilerWrite(TraceOut.os());
+  timeTraceProfilerCleanup();
+  TraceOut.keep();
+  return 0;
+}
+
 static bool addPass(PassManagerBase &PM, const char *argv0,
                     StringRef PassName, TargetPassConfig &TPC) {
   if (PassName == "none")
@@ -380,6 +441,51 @@ static bool addPass(PassManagerBase &PM, const char *argv0,
   return false;
 }
 
+/// Split \p M into -j partitions and generate code for them concurrently, each
+/// partition in its own LLVMContext and with its own TargetMachine.
+///
+/// Locals are kept in the partition of their users instead of being
+/// externalized, so the partitions define the same set of symbols with the
+/// same linkage as a serial compile, and the split only depends on the module.
+static int compileModuleInParallel(const char *argv0, std::unique_ptr<Module> M,
+                                   const Target &TheTarget,
+                                   const Triple &TheTriple,
+                                   const std::string &CPUStr,
+                                   const std::string &FeaturesStr,
+                                   const TargetOptions &Options,
+                                   CodeGenOpt::Level OLvl) {
+  std::list<ToolOutputFile> OSs;
+  std::vector<raw_pwrite_stream *> OSPtrs;
+  for (unsigned I = 0; I != Parallelism; ++I) {
+    std::string PartFilename = OutputFilename + "." + utostr(I);
+    std::error_code EC;
+    OSs.emplace_back(PartFilename, EC, sys::fs::F_None);
+    if (EC) {
+      errs() << argv0 << ": error opening the file '" << PartFilename
+             << "': " << EC.message() << '\n';
+      return 1;
+    }
+    OSPtrs.push_back(&OSs.back().os());
+  }
+
+  // Read the command line options once, on this thread; the factory is
+  // called concurrently from the code generation threads.
+  Optional<Reloc::Model> RM = getRelocModel();
+  Optional<CodeModel::Model> CM = getCodeModel();
+  auto TMFactory = [&]() {
+    return std::unique_ptr<TargetMachine>(TheTarget.createTargetMachine(
+        TheTriple.getTriple(), CPUStr, FeaturesStr, Options, RM, CM, OLvl));
+  };
+
+  cl::PrintOptionValues();
+  splitCodeGen(std::move(M), OSPtrs, {}, TMFactory, FileType,
+               /*PreserveLocals=*/true);
+
+  for (ToolOutputFile &OS : OSs)
+    OS.keep();
+  return 0;
+}
+
 static int compileModule(char **argv, LLVMContext &Context) {
   // Load the module to be compiled...
   SMDiagnostic Err;
@@ -463,10 +569,26 @@ static int compileModule(char **argv, LLVMContext &Context) {
   if (FloatABIForCalls != FloatABI::Default)
     Options.FloatABIType = FloatABIForCalls;
 
-  // Figure out where we are going to send the output.
-  std::unique_ptr<ToolOutputFile> Out =
-      GetOutputStream(TheTarget->getName(), TheTriple.getOS(), argv[0]);
-  if (!Out) return 1;
+  if (Parallelism > 1) {
+    if (OutputFilename.empty() || OutputFilename == "-") {
+      errs() << argv[0] << ": -j must be specified together with -o\n";
+      return 1;
+    }
+    if (MIR || !RunPassNames->empty() || CompileTwice ||
+        !SplitDwarfOutputFile.empty()) {
+      errs() << argv[0] << ": -j cannot be used with .mir input, -run-pass, "
+             << "-compile-twice or -split-dwarf-output\n";
+      return 1;
+    }
+  }
+
+  // Figure out where we are going to send the output. With -j the partitions
+  // are opened by compileModuleInParallel instead.
+  std::unique_ptr<ToolOutputFile> Out;
+  if (Parallelism <= 1) {
+    Out = GetOutputStream(TheTarget->getName(), TheTriple.getOS(), argv[0]);
+    if (!Out) return 1;
+  }
 
   std::unique_ptr<ToolOutputFile> DwoOut;
   if (!SplitDwarfOutputFile.empty()) {
@@ -514,6 +636,11 @@ static int compileModule(char **argv, LLVMContext &Context) {
     errs() << argv[0]
              << ": warning: ignoring -mc-relax-all because filetype != obj";
 
+  if (Parallelism > 1)
+    return compileModuleInParallel(argv[0], std::move(M), *TheTarget,
+                                   TheTriple, CPUStr, FeaturesStr, Options,
+                                   OLvl);
+
   {
     raw_pwrite_stream *OS = &Out->os();
 
@@ -532,6 +659,12 @@ static int compileModule(char **argv, LLVMContext &Context) {
     LLVMTargetMachine &LLVMTM = static_cast<LLVMTargetMachine&>(*Target);
     MachineModuleInfo *MMI = new MachineModuleInfo(&LLVMTM);
 
+    // Only use more threads for the machine function passes where that does
+    // not change the output.
+    if (MachineFunctionThreads > 1 && !MIR &&
+        LLVMTM.canRunMachineFunctionPassesConcurrently(*M))
+      Target->Options.MachineFunctionThreads = MachineFunctionThreads;
+
     // Construct a custom pass pipeline that starts after instruction
     // selection.
     if (!RunPassNames->empty()) {
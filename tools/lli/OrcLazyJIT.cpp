@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "OrcLazyJIT.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/Support/CodeGen.h"
@@ -22,6 +23,11 @@
 
 using namespace llvm;
 
+#define DEBUG_TYPE "lli"
+
+STATISTIC(NumSpeculativelyCompiled,
+          "Number of functions compiled speculatively");
+
 namespace {
 
 enum class DumpKind {
@@ -51,6 +57,22 @@ static cl::opt<bool> OrcInlineStubs("orc-lazy-inline-stubs",
                                     cl::desc("Try to inline stubs"),
                                     cl::init(true), cl::Hidden);
 
+static cl::opt<unsigned> OrcSpeculateDepth(
+    "orc-lazy-speculate-depth",
+    cl::desc("Speculatively compile the callees of compiled functions, up to "
+             "this many calls away (0 disables speculation)"),
+    cl::init(0), cl::Hidden);
+
+static cl::opt<unsigned> OrcSpeculateThreads(
+    "orc-lazy-speculate-threads",
+    cl::desc("Number of threads used for speculative compilation"),
+    cl::init(1), cl::Hidden);
+
+static cl::opt<bool> OrcMemoryPool(
+    "orc-lazy-memory-pool",
+    cl::desc("Allocate JIT'd code and data from a shared pool of pages"),
+    cl::init(false), cl::Hidden);
+
 OrcLazyJIT::TransformFtor OrcLazyJIT::createDebugDumper() {
   switch (OrcDumpKind) {
   case DumpKind::NoDump:
@@ -145,6 +167,12 @@ int llvm::runOrcLazyJIT(std::vector<std::unique_ptr<Module>> Ms,
                std::move(IndirectStubsMgrBuilder),
                OrcInlineStubs);
 
+  if (OrcSpeculateDepth)
+    J.enableSpeculation(OrcSpeculateThreads, OrcSpeculateDepth);
+
+  if (OrcMemoryPool)
+    J.enableMemoryPool();
+
   // Add the module, look up main and run it.
   for (auto &M : Ms)
     cantFail(J.addModule(std::move(M)));
@@ -155,7 +183,12 @@ int llvm::runOrcLazyJIT(std::vector<std::unique_ptr<Module>> Ms,
     for (auto &Arg : Args)
       ArgV.push_back(Arg.c_str());
     auto Main = fromTargetAddress<MainFnPtr>(cantFail(MainSym.getAddress()));
-    return Main(ArgV.size(), (const char**)ArgV.data());
+    int Result = Main(ArgV.size(), (const char**)ArgV.data());
+    // Pending speculative compiles are dropped when the JIT is destroyed, so
+    // only wait for them when they are going to be counted.
+    if (OrcSpeculateDepth && AreStatisticsEnabled())
+      NumSpeculativelyCompiled = J.finishSpeculation();
+    return Result;
   } else if (auto Err = MainSym.takeError())
     logAllUnhandledErrors(std::move(Err), llvm::errs(), "");
   else
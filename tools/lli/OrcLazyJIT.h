@@ -27,6 +27,7 @@
 #include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
 #include "llvm/ExecutionEngine/Orc/LambdaResolver.h"
 #include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/PooledSectionMemoryManager.h"
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/IR/DataLayout.h"
@@ -70,9 +71,15 @@ public:
                              "Missing resolver for module K");
                       auto Resolver = std::move(ResolverI->second);
                       Resolvers.erase(ResolverI);
-                      return ObjLayerT::Resources{
-                          std::make_shared<SectionMemoryManager>(),
-                          std::move(Resolver)};
+                      std::shared_ptr<RuntimeDyld::MemoryManager> MemMgr;
+                      if (MemPool)
+                        MemMgr =
+                            std::make_shared<PooledSectionMemoryManager>(
+                                MemPool);
+                      else
+                        MemMgr = std::make_shared<SectionMemoryManager>();
+                      return ObjLayerT::Resources{std::move(MemMgr),
+                                                  std::move(Resolver)};
                     }),
         CompileLayer(ObjectLayer, orc::SimpleCompiler(*this->TM)),
         IRDumpLayer(CompileLayer, createDebugDumper()),
@@ -199,6 +206,24 @@ public:
     return Error::success();
   }
 
+  /// Compile likely callees on \p NumThreads background threads, up to
+  /// \p Depth calls away from each function that gets compiled.
+  void enableSpeculation(unsigned NumThreads, unsigned Depth) {
+    CODLayer.enableSpeculation(NumThreads, Depth);
+  }
+
+  /// Wait for the speculative compiles still in flight and return the number
+  /// of functions compiled speculatively.
+  unsigned finishSpeculation() {
+    CODLayer.waitForSpeculation();
+    return CODLayer.getNumSpeculativelyCompiled();
+  }
+
+  /// Allocate the memory for JIT'd objects from a shared pool of pages, so
+  /// that the many small objects built by the lazy JIT are carved out of a
+  /// few slabs instead of each mapping pages of its own.
+  void enableMemoryPool() { MemPool = std::make_shared<JITMemoryPool>(); }
+
   JITSymbol findSymbol(const std::string &Name) {
     return CODLayer.findSymbol(mangle(Name), true);
   }
@@ -233,6 +258,7 @@ private:
   std::unique_ptr<TargetMachine> TM;
   DataLayout DL;
   SectionMemoryManager CCMgrMemMgr;
+  std::shared_ptr<JITMemoryPool> MemPool;
 
   std::unique_ptr<CompileCallbackMgr> CCMgr;
   ObjLayerT ObjectLayer;
@@ -113,6 +113,14 @@ namespace {
                          "\n\tremote execution will be simulated in-process."),
                 cl::value_desc("filename"), cl::init(""));
 
+  // Write the code for the remote process into memory that both processes
+  // map, instead of sending it through the pipes.
+  cl::opt<bool> RemoteSharedMemory(
+      "remote-shared-memory",
+      cl::desc("Place code for remote MCJIT execution in memory shared with "
+               "the child process."),
+      cl::init(false));
+
   // Determine optimization level.
   cl::opt<char>
   OptLevel("O",
@@ -615,6 +623,9 @@ int main(int argc, char **argv, char * const *envp) {
     typedef orc::remote::OrcRemoteTargetClient MyRemote;
     auto R = ExitOnErr(MyRemote::Create(*C, ExitOnErr));
 
+    if (RemoteSharedMemory)
+      ExitOnErr(R->enableSharedMemory());
+
     // Create a remote memory manager.
     auto RemoteMM = ExitOnErr(R->createRemoteMemoryManager());
 
@@ -28,6 +28,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
+#include "llvm/IR/ModuleSummaryIndexImage.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/LTO/legacy/LTOCodeGenerator.h"
@@ -139,6 +140,11 @@ static cl::opt<std::string>
                  cl::desc("Provide the index produced by a ThinLink, required "
                           "to perform the promotion and/or importing."));
 
+static cl::opt<bool> ThinLTOIndexImage(
+    "thinlto-index-image", cl::init(false),
+    cl::desc("Write the combined and distributed indexes as mappable summary "
+             "index images instead of bitcode."));
+
 static cl::opt<std::string> ThinLTOPrefixReplace(
     "thinlto-prefix-replace",
     cl::desc("Control where files for distributed backends are "
@@ -323,13 +329,48 @@ getLocalLTOModule(StringRef Path, std::unique_ptr<MemoryBuffer> &Buffer,
 void printIndexStats() {
   for (auto &Filename : InputFilenames) {
     ExitOnError ExitOnErr("llvm-lto: error loading file '" + Filename + "': ");
+    unsigned Calls = 0, Refs = 0, Functions = 0, Alias = 0, Globals = 0;
+    auto printStats = [&]() {
+      outs() << "Index " << Filename << " contains "
+             << (Alias + Globals + Functions) << " nodes (" << Functions
+             << " functions, " << Alias << " alias, " << Globals
+             << " globals) and " << (Calls + Refs) << " edges (" << Refs
+             << " refs and " << Calls << " calls)\n";
+    };
+
+    // Summary index images are queried in place.
+    std::unique_ptr<MemoryBuffer> MB =
+        ExitOnErr(errorOrToExpected(MemoryBuffer::getFile(Filename)));
+    if (ModuleSummaryIndexImage::isImage(MB->getBuffer())) {
+      ModuleSummaryIndexImage Image =
+          ExitOnErr(ModuleSummaryIndexImage::create(*MB));
+      for (auto &Value : Image.values()) {
+        for (auto &Summary : Image.getSummaries(Value)) {
+          Refs += Summary.refs().size();
+          Calls += Summary.calls().size();
+          switch (Summary.getSummaryKind()) {
+          case GlobalValueSummary::FunctionKind:
+            Functions++;
+            break;
+          case GlobalValueSummary::AliasKind:
+            Alias++;
+            break;
+          case GlobalValueSummary::GlobalVarKind:
+            Globals++;
+            break;
+          }
+        }
+      }
+      printStats();
+      continue;
+    }
+
     std::unique_ptr<ModuleSummaryIndex> Index =
-        ExitOnErr(getModuleSummaryIndexForFile(Filename));
+        ExitOnErr(getModuleSummaryIndex(*MB));
     // Skip files without a module summary.
     if (!Index)
       report_fatal_error(Filename + " does not contain an index");
 
-    unsigned Calls = 0, Refs = 0, Functions = 0, Alias = 0, Globals = 0;
     for (auto &Summaries : *Index) {
       for (auto &Summary : Summaries.second.SummaryList) {
         Refs += Summary->refs().size();
@@ -342,11 +383,7 @@ void printIndexStats() {
           Globals++;
       }
     }
-    outs() << "Index " << Filename << " contains "
-           << (Alias + Globals + Functions) << " nodes (" << Functions
-           << " functions, " << Alias << " alias, " << Globals
-           << " globals) and " << (Calls + Refs) << " edges (" << Refs
-           << " refs and " << Calls << " calls)\n";
+    printStats();
   }
 }
 
@@ -464,6 +501,25 @@ static std::unique_ptr<Module> loadModule(StringRef Filename,
   return M;
 }
 
+/// Write \p Index to \p Filename, as bitcode or, with -thinlto-index-image, as
+/// a summary index image.
+static void writeIndexToFile(
+    const ModuleSummaryIndex &Index, StringRef Filename,
+    const std::map<std::string, GVSummaryMapTy> *ModuleToSummariesForIndex =
+        nullptr) {
+  std::error_code EC;
+  raw_fd_ostream OS(Filename, EC, sys::fs::OpenFlags::F_None);
+  error(EC, "error opening the file '" + Filename + "'");
+  if (!ThinLTOIndexImage) {
+    WriteIndexToFile(Index, OS, ModuleToSummariesForIndex);
+    return;
+  }
+  ExitOnError ExitOnErr(
+      ("llvm-lto: error writing file '" + Filename + "': ").str());
+  ExitOnErr(
+      writeModuleSummaryIndexImage(Index, OS, ModuleToSummariesForIndex));
+}
+
 static void writeModuleToFile(Module &TheModule, StringRef Filename) {
   std::error_code EC;
   raw_fd_ostream OS(Filename, EC, sys::fs::OpenFlags::F_None);
@@ -535,10 +591,7 @@ private:
     auto CombinedIndex = ThinGenerator.linkCombinedIndex();
     if (!CombinedIndex)
       report_fatal_error("ThinLink didn't create an index");
-    std::error_code EC;
-    raw_fd_ostream OS(OutputFilename, EC, sys::fs::OpenFlags::F_None);
-    error(EC, "error opening the file '" + OutputFilename + "'");
-    WriteIndexToFile(*CombinedIndex, OS);
+    writeIndexToFile(*CombinedIndex, OutputFilename);
   }
 
   /// Load the combined index from disk, then compute and generate
@@ -568,10 +621,7 @@ private:
         OutputName = Filename + ".thinlto.bc";
       }
       OutputName = getThinLTOOutputFile(OutputName, OldPrefix, NewPrefix);
-      std::error_code EC;
-      raw_fd_ostream OS(OutputName, EC, sys::fs::OpenFlags::F_None);
-      error(EC, "error opening the file '" + OutputName + "'");
-      WriteIndexToFile(*Index, OS, &ModuleToSummariesForIndex);
+      writeIndexToFile(*Index, OutputName, &ModuleToSummariesForIndex);
     }
   }
 
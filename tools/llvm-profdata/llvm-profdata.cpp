@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/LLVMContext.h"
@@ -27,6 +28,7 @@
 #include "llvm/Support/InitLLVM.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Signals.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
@@ -126,16 +128,21 @@ typedef SmallVector<WeightedFile, 5> WeightedFileVector;
 /// Keep track of merged data and reported errors.
 struct WriterContext {
   std::mutex Lock;
-  InstrProfWriter Writer;
+  std::unique_ptr<InstrProfWriter> Writer;
   Error Err;
   std::string ErrWhence;
   std::mutex &ErrLock;
   SmallSet<instrprof_error, 4> &WriterErrorCodes;
+  bool IsSparse;
+
+  /// Indexed profiles holding the records this context spilled to disk.
+  std::vector<std::string> SpilledRuns;
 
   WriterContext(bool IsSparse, std::mutex &ErrLock,
                 SmallSet<instrprof_error, 4> &WriterErrorCodes)
-      : Lock(), Writer(IsSparse), Err(Error::success()), ErrWhence(""),
-        ErrLock(ErrLock), WriterErrorCodes(WriterErrorCodes) {}
+      : Lock(), Writer(llvm::make_unique<InstrProfWriter>(IsSparse)),
+        Err(Error::success()), ErrWhence(""), ErrLock(ErrLock),
+        WriterErrorCodes(WriterErrorCodes), IsSparse(IsSparse) {}
 };
 
 /// Determine whether an error is fatal for profile merging.
@@ -178,7 +185,7 @@ static void loadInput(const WeightedFile &Input, WriterContext *WC) {
 
   auto Reader = std::move(ReaderOrErr.get());
   bool IsIRProfile = Reader->isIRLevelProfile();
-  if (WC->Writer.setIsIRLevelProfile(IsIRProfile)) {
+  if (WC->Writer->setIsIRLevelProfile(IsIRProfile)) {
     WC->Err = make_error<StringError>(
         "Merge IR generated profile with Clang generated profile.",
         std::error_code());
@@ -188,7 +195,7 @@ static void loadInput(const WeightedFile &Input, WriterContext *WC) {
   for (auto &I : *Reader) {
     const StringRef FuncName = I.Name;
     bool Reported = false;
-    WC->Writer.addRecord(std::move(I), Input.Weight, [&](Error E) {
+    WC->Writer->addRecord(std::move(I), Input.Weight, [&](Error E) {
       if (Reported) {
         consumeError(std::move(E));
         return;
@@ -211,6 +218,29 @@ static void loadInput(const WeightedFile &Input, WriterContext *WC) {
   }
 }
 
+/// Write the records accumulated in \p WC to a temporary indexed profile and
+/// start over with an empty writer, so that the memory used by a merge thread
+/// stays bounded. The spilled runs are merged back at the end.
+static void spillWriterContext(WriterContext *WC) {
+  if (WC->Err)
+    return;
+
+  int FD;
+  SmallString<128> Path;
+  if (std::error_code EC =
+          sys::fs::createTemporaryFile("llvm-profdata", "profdata", FD, Path))
+    exitWithErrorCode(EC, "cannot create a temporary file");
+  sys::RemoveFileOnSignal(Path);
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    WC->Writer->write(OS);
+    if (OS.has_error())
+      exitWithError("cannot write a temporary file", Path.str());
+  }
+  WC->SpilledRuns.push_back(Path.str());
+  WC->Writer = llvm::make_unique<InstrProfWriter>(WC->IsSparse);
+}
+
 /// Merge the \p Src writer context into \p Dst.
 static void mergeWriterContexts(WriterContext *Dst, WriterContext *Src) {
   // If we've already seen a hard error, continuing with the merge would
@@ -219,7 +249,7 @@ static void mergeWriterContexts(WriterContext *Dst, WriterContext *Src) {
     return;
 
   bool Reported = false;
-  Dst->Writer.mergeRecordsFromWriter(std::move(Src->Writer), [&](Error E) {
+  Dst->Writer->mergeRecordsFromWriter(std::move(*Src->Writer), [&](Error E) {
     if (Reported) {
       consumeError(std::move(E));
       return;
@@ -232,7 +262,7 @@ static void mergeWriterContexts(WriterContext *Dst, WriterContext *Src) {
 static void mergeInstrProfile(const WeightedFileVector &Inputs,
                               StringRef OutputFilename,
                               ProfileFormat OutputFormat, bool OutputSparse,
-                              unsigned NumThreads) {
+                              unsigned NumThreads, unsigned SpillThreshold) {
   if (OutputFilename.compare("-") == 0)
     exitWithError("Cannot write indexed profdata format to stdout.");
 
@@ -264,11 +294,29 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
   } else {
     ThreadPool Pool(NumThreads);
 
-    // Load the inputs in parallel (N/NumThreads serial steps).
-    unsigned Ctx = 0;
+    // Load the inputs in parallel. Each input goes to whichever context is
+    // free when its task starts, so that a few large inputs don't hold up the
+    // ones queued behind them. There are as many contexts as threads, so one
+    // is always available.
+    std::mutex FreeContextsLock;
+    std::vector<WriterContext *> FreeContexts;
+    for (auto &WC : Contexts)
+      FreeContexts.push_back(WC.get());
     for (const auto &Input : Inputs) {
-      Pool.async(loadInput, Input, Contexts[Ctx].get());
-      Ctx = (Ctx + 1) % NumThreads;
+      Pool.async([&, Input]() {
+        WriterContext *WC;
+        {
+          std::lock_guard<std::mutex> Guard(FreeContextsLock);
+          assert(!FreeContexts.empty() && "More tasks than contexts");
+          WC = FreeContexts.back();
+          FreeContexts.pop_back();
+        }
+        loadInput(Input, WC);
+        if (SpillThreshold && WC->Writer->getNumFunctions() >= SpillThreshold)
+          spillWriterContext(WC);
+        std::lock_guard<std::mutex> Guard(FreeContextsLock);
+        FreeContexts.push_back(WC);
+      });
     }
     Pool.wait();
 
@@ -291,6 +339,16 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
     } while (Mid > 0);
   }
 
+  // Merge back the runs that were spilled to disk. This happens on a single
+  // writer, which is the only one that ever holds every record.
+  for (std::unique_ptr<WriterContext> &WC : Contexts) {
+    for (const std::string &Run : WC->SpilledRuns) {
+      loadInput({Run, 1}, Contexts[0].get());
+      sys::fs::remove(Run);
+      sys::DontRemoveFileOnSignal(Run);
+    }
+  }
+
   // Handle deferred hard errors encountered during merging.
   for (std::unique_ptr<WriterContext> &WC : Contexts) {
     if (!WC->Err)
@@ -306,7 +364,7 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
            WC->ErrWhence);
   }
 
-  InstrProfWriter &Writer = Contexts[0]->Writer;
+  InstrProfWriter &Writer = *Contexts[0]->Writer;
   if (OutputFormat == PF_Text) {
     if (Error E = Writer.writeText(Output))
       exitWithError(std::move(E));
@@ -476,6 +534,10 @@ static int merge_main(int argc, const char *argv[]) {
       cl::desc("Number of merge threads to use (default: autodetect)"));
   cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
                         cl::aliasopt(NumThreads));
+  cl::opt<unsigned> SpillThreshold(
+      "spill-threshold", cl::init(0),
+      cl::desc("Number of functions a merge thread may hold in memory before "
+               "spilling them to a temporary file (default: never spill)"));
 
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
 
@@ -502,7 +564,7 @@ static int merge_main(int argc, const char *argv[]) {
 
   if (ProfileKind == instr)
     mergeInstrProfile(WeightedInputs, OutputFilename, OutputFormat,
-                      OutputSparse, NumThreads);
+                      OutputSparse, NumThreads, SpillThreshold);
   else
     mergeSampleProfile(WeightedInputs, OutputFilename, OutputFormat);
 
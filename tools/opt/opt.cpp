@@ -15,6 +15,7 @@
 #include "BreakpointPrinter.h"
 #include "NewPMDriver.h"
 #include "PassPrinters.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
@@ -28,6 +29,7 @@
 #include "llvm/Config/llvm-config.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/IRPrintingPasses.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
@@ -48,6 +50,7 @@
 #include "llvm/Support/SystemUtils.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/YAMLTraits.h"
 #include "llvm/Target/TargetMachine.h"
@@ -241,6 +244,12 @@ static cl::opt<bool> DiscardValueNames(
     cl::desc("Discard names from Value (other than GlobalValue)."),
     cl::init(false), cl::Hidden);
 
+static cl::opt<bool> UseIRArena(
+    "ir-arena",
+    cl::desc("Allocate instructions and basic blocks from an arena that is "
+             "freed with the module."),
+    cl::init(false), cl::Hidden);
+
 static cl::opt<bool> Coroutines(
   "enable-coroutines",
   cl::desc("Enable coroutine passes."),
@@ -261,6 +270,23 @@ static cl::opt<std::string>
                     cl::desc("YAML output filename for pass remarks"),
                     cl::value_desc("filename"));
 
+static cl::opt<bool> TimeTrace(
+    "time-trace",
+    cl::desc("Record a hierarchical time trace of the pass pipeline in "
+             "Chrome trace event format"));
+
+static cl::opt<unsigned> TimeTraceGranularity(
+    "time-trace-granularity",
+    cl::desc(
+        "Minimum time granularity (in microseconds) traced by time profiler"),
+    cl::init(500), cl::Hidden);
+
+static cl::opt<std::string>
+    TimeTraceFile("time-trace-file",
+                  cl::desc("Output filename for the time trace (default: "
+                           "<output>.time-trace.json)"),
+                  cl::value_desc("filename"), cl::Hidden);
+
 class OptCustomPassManager : public legacy::PassManager {
 public:
   using super = legacy::PassManager;
@@ -392,6 +418,25 @@ static TargetMachine* GetTargetMachine(Triple TheTriple, StringRef CPUStr,
                                         getCodeModel(), GetCodeGenOptLevel());
 }
 
+static bool writeTimeTrace() {
+  std::string TraceFilename = TimeTraceFile;
+  if (TraceFilename.empty())
+    TraceFilename = OutputFilename.empty() || OutputFilename == "-"
+                        ? std::string("time-trace.json")
+                        : OutputFilename + ".time-trace.json";
+
+  std::error_code EC;
+  ToolOutputFile TraceOut(TraceFilename, EC, sys::fs::F_Text);
+  if (EC) {
+    errs() << EC.message() << '\n';
+    return false;
+  }
+  timeTraceProfilerWrite(TraceOut.os());
+  timeTraceProfilerCleanup();
+  TraceOut.keep();
+  return true;
+}
+
 #ifdef LINK_POLLY_INTO_TOOLS
 namespace polly {
 void initializePollyPasses(llvm::PassRegistry &Registry);
@@ -461,6 +506,9 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  if (TimeTrace)
+    timeTraceProfilerInitialize(TimeTraceGranularity, argv[0]);
+
   SMDiagnostic Err;
 
   Context.setDiscardValueNames(DiscardValueNames);
@@ -486,6 +534,14 @@ int main(int argc, char **argv) {
         llvm::make_unique<yaml::Output>(OptRemarkFile->os()));
   }
 
+  // The arena is declared before the module so that it outlives it.
+  std::unique_ptr<IRArena> Arena;
+  Optional<IRArena::Scope> ArenaScope;
+  if (UseIRArena) {
+    Arena = llvm::make_unique<IRArena>();
+    ArenaScope.emplace(*Arena);
+  }
+
   // Load the input module...
   std::unique_ptr<Module> M =
       parseIRFile(InputFilename, Err, Context, !NoVerify, ClDataLayout);
@@ -581,13 +637,14 @@ int main(int argc, char **argv) {
     // The user has asked to use the new pass manager and provided a pipeline
     // string. Hand off the rest of the functionality to the new code for that
     // layer.
-    return runPassPipeline(argv[0], *M, TM.get(), Out.get(), ThinLinkOut.get(),
-                           OptRemarkFile.get(), PassPipeline, OK, VK,
-                           PreserveAssemblyUseListOrder,
-                           PreserveBitcodeUseListOrder, EmitSummaryIndex,
-                           EmitModuleHash, EnableDebugify)
-               ? 0
-               : 1;
+    bool Success = runPassPipeline(
+        argv[0], *M, TM.get(), Out.get(), ThinLinkOut.get(),
+        OptRemarkFile.get(), PassPipeline, OK, VK, PreserveAssemblyUseListOrder,
+        PreserveBitcodeUseListOrder, EmitSummaryIndex, EmitModuleHash,
+        EnableDebugify);
+    if (TimeTrace && !writeTimeTrace())
+      return 1;
+    return Success ? 0 : 1;
   }
 
   // Create a PassManager to hold and optimize the collection of passes we are
@@ -825,6 +882,9 @@ int main(int argc, char **argv) {
     Out->os() << BOS->str();
   }
 
+  if (TimeTrace && !writeTimeTrace())
+    return 1;
+
   // Declare success.
   if (!NoOutput || PrintBreakpoints)
     Out->keep();
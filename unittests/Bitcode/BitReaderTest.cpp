@@ -12,6 +12,9 @@
 #include "llvm/AsmParser/Parser.h"
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
@@ -191,4 +194,75 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddrInFunctionAfter) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+
+static const char *FunctionWithDebugInfo =
+    "define i32 @f(i32 %x) !dbg !4 {\n"
+    "  %c = icmp eq i32 %x, 0, !dbg !8\n"
+    "  call void @llvm.dbg.value(metadata i32 %x, metadata !10, "
+    "metadata !DIExpression()), !dbg !9\n"
+    "  br i1 %c, label %a, label %b, !dbg !9, !prof !11\n"
+    "a:\n"
+    "  ret i32 1, !dbg !8\n"
+    "b:\n"
+    "  ret i32 %x, !dbg !9\n"
+    "}\n"
+    "declare void @llvm.dbg.value(metadata, metadata, metadata)\n"
+    "!llvm.dbg.cu = !{!0}\n"
+    "!llvm.module.flags = !{!3}\n"
+    "!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, "
+    "emissionKind: FullDebug)\n"
+    "!1 = !DIFile(filename: \"t.c\", directory: \"/\")\n"
+    "!3 = !{i32 2, !\"Debug Info Version\", i32 3}\n"
+    "!4 = distinct !DISubprogram(name: \"f\", scope: !1, file: !1, line: 1, "
+    "isDefinition: true, unit: !0)\n"
+    "!5 = distinct !DISubprogram(name: \"g\", scope: !1, file: !1, line: 5, "
+    "isDefinition: true, unit: !0)\n"
+    "!6 = distinct !DILexicalBlock(scope: !5, file: !1, line: 6)\n"
+    "!7 = !DILocation(line: 2, scope: !4)\n"
+    "!8 = !DILocation(line: 7, scope: !6, inlinedAt: !7)\n"
+    "!9 = !DILocation(line: 3, scope: !4)\n"
+    "!10 = !DILocalVariable(name: \"x\", arg: 1, scope: !4, file: !1)\n"
+    "!11 = !{!\"branch_weights\", i32 1, i32 9}\n";
+
+// Tests that function-level metadata referred to by debug locations and
+// attachments is loaded when materializing the function.
+TEST(BitReaderTest, MaterializeFunctionMetadata) {
+  SmallString<1024> Mem;
+  LLVMContext Context;
+  std::unique_ptr<Module> M =
+      getLazyModuleFromAssembly(Context, Mem, FunctionWithDebugInfo);
+  EXPECT_FALSE(M->getFunction("f")->materialize());
+  EXPECT_FALSE(verifyModule(*M, &dbgs()));
+
+  Instruction &Cmp = *inst_begin(M->getFunction("f"));
+  ASSERT_TRUE(Cmp.getDebugLoc());
+  EXPECT_EQ(7U, Cmp.getDebugLoc().getLine());
+  ASSERT_TRUE(Cmp.getDebugLoc().getInlinedAt());
+  EXPECT_EQ(2U, Cmp.getDebugLoc().getInlinedAt()->getLine());
+  auto *DVI = cast<DbgValueInst>(Cmp.getNextNode());
+  EXPECT_EQ("x", DVI->getVariable()->getName());
+  EXPECT_NE(nullptr, DVI->getNextNode()->getMetadata(LLVMContext::MD_prof));
+}
+
+// Tests that functions of a lazily loaded module whose debug info has been
+// stripped are read without their debug locations, but keep their other
+// metadata.
+TEST(BitReaderTest, MaterializeFunctionsWithoutDebugInfo) {
+  SmallString<1024> Mem;
+  LLVMContext Context;
+  std::unique_ptr<Module> M =
+      getLazyModuleFromAssembly(Context, Mem, FunctionWithDebugInfo);
+  EXPECT_TRUE(StripDebugInfo(*M));
+  EXPECT_FALSE(M->materializeAll());
+  EXPECT_FALSE(verifyModule(*M, &dbgs()));
+
+  for (Instruction &I : instructions(M->getFunction("f"))) {
+    EXPECT_FALSE(I.getDebugLoc());
+    EXPECT_FALSE(isa<DbgInfoIntrinsic>(I));
+  }
+  Instruction &Br = *std::next(inst_begin(M->getFunction("f")));
+  EXPECT_NE(nullptr, Br.getMetadata(LLVMContext::MD_prof));
+  EXPECT_EQ(nullptr, M->getFunction("f")->getSubprogram());
+}
+
 } // end namespace
@@ -0,0 +1,169 @@
+//===- llvm/unittest/Bitcode/BitcodeWriterTest.cpp - Tests for BitWriter --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+std::unique_ptr<Module> parseAssembly(LLVMContext &Context,
+                                      const char *Assembly) {
+  SMDiagnostic Error;
+  std::unique_ptr<Module> M = parseAssemblyString(Assembly, Error, Context);
+
+  std::string ErrMsg;
+  raw_string_ostream OS(ErrMsg);
+  Error.print("", OS);
+
+  // A failure here means that the test itself is buggy.
+  if (!M)
+    report_fatal_error(OS.str().c_str());
+
+  return M;
+}
+
+static std::string writeModule(const Module &M,
+                               BitcodeIncrementalState *State = nullptr) {
+  std::string Buffer;
+  raw_string_ostream OS(Buffer);
+  WriteBitcodeToFile(M, OS, /*ShouldPreserveUseListOrder=*/false,
+                     /*Index=*/nullptr, /*GenerateHash=*/false,
+                     /*ModHash=*/nullptr, State);
+  return OS.str();
+}
+
+static void setReturnValue(Module &M, StringRef Name, int32_t Value) {
+  Function *F = M.getFunction(Name);
+  auto *Ret = cast<ReturnInst>(F->getEntryBlock().getTerminator());
+  Ret->setOperand(0, ConstantInt::get(Type::getInt32Ty(M.getContext()),
+                                      Value));
+}
+
+static int64_t readReturnValue(LLVMContext &Context, StringRef Bitcode,
+                               StringRef Name) {
+  std::unique_ptr<Module> M = cantFail(
+      parseBitcodeFile(MemoryBufferRef(Bitcode, "test"), Context));
+  EXPECT_FALSE(verifyModule(*M, &dbgs()));
+  auto *Ret = cast<ReturnInst>(
+      M->getFunction(Name)->getEntryBlock().getTerminator());
+  return cast<ConstantInt>(Ret->getReturnValue())->getSExtValue();
+}
+
+const char *ThreeFunctions = "@x = global i32 0\n"
+                             "define i32 @f() {\n"
+                             "  %v = load i32, i32* @x\n"
+                             "  ret i32 1\n"
+                             "}\n"
+                             "define i32 @g(i32 %a) {\n"
+                             "entry:\n"
+                             "  %b = add i32 %a, 7\n"
+                             "  ret i32 2\n"
+                             "}\n"
+                             "define i32 @h() {\n"
+                             "  %r = call i32 @g(i32 3)\n"
+                             "  ret i32 3\n"
+                             "}\n";
+
+TEST(BitcodeWriterTest, IncrementalReusesUnchangedFunctions) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = parseAssembly(Context, ThreeFunctions);
+
+  BitcodeIncrementalState State;
+  std::string First = writeModule(*M, &State);
+  EXPECT_EQ(0U, State.getNumFunctionsReused());
+  EXPECT_EQ(3U, State.getNumFunctionsEncoded());
+  EXPECT_EQ(writeModule(*M), First);
+
+  // Nothing changed: every block is copied.
+  std::string Second = writeModule(*M, &State);
+  EXPECT_EQ(3U, State.getNumFunctionsReused());
+  EXPECT_EQ(0U, State.getNumFunctionsEncoded());
+  EXPECT_EQ(First, Second);
+
+  // Change the body of one function. Only that one is encoded again, and the
+  // result is the same as a full write.
+  setReturnValue(*M, "g", 42);
+  std::string Third = writeModule(*M, &State);
+  EXPECT_EQ(2U, State.getNumFunctionsReused());
+  EXPECT_EQ(1U, State.getNumFunctionsEncoded());
+  EXPECT_EQ(writeModule(*M), Third);
+  EXPECT_EQ(42, readReturnValue(Context, Third, "g"));
+  EXPECT_EQ(1, readReturnValue(Context, Third, "f"));
+  EXPECT_EQ(3, readReturnValue(Context, Third, "h"));
+}
+
+TEST(BitcodeWriterTest, IncrementalModuleLevelChangeEncodesAll) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = parseAssembly(Context, ThreeFunctions);
+
+  BitcodeIncrementalState State;
+  writeModule(*M, &State);
+
+  // A new global shifts the numbering of values the functions refer to.
+  new GlobalVariable(*M, Type::getInt32Ty(Context), false,
+                     GlobalValue::ExternalLinkage,
+                     ConstantInt::get(Type::getInt32Ty(Context), 5), "y");
+  std::string Bitcode = writeModule(*M, &State);
+  EXPECT_EQ(0U, State.getNumFunctionsReused());
+  EXPECT_EQ(3U, State.getNumFunctionsEncoded());
+  EXPECT_EQ(writeModule(*M), Bitcode);
+
+  // So does removing a function, since later globals are renumbered.
+  M->getFunction("f")->eraseFromParent();
+  Bitcode = writeModule(*M, &State);
+  EXPECT_EQ(0U, State.getNumFunctionsReused());
+  EXPECT_EQ(2U, State.getNumFunctionsEncoded());
+  EXPECT_EQ(writeModule(*M), Bitcode);
+
+  EXPECT_EQ(Bitcode, writeModule(*M, &State));
+  EXPECT_EQ(2U, State.getNumFunctionsReused());
+}
+
+TEST(BitcodeWriterTest, IncrementalWithCustomKeys) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = parseAssembly(Context, ThreeFunctions);
+
+  // A client that tracks edits itself keys functions by a version number.
+  StringMap<unsigned> Versions;
+  BitcodeIncrementalState State([&](const Function &F) {
+    return std::to_string(Versions[F.getName()]);
+  });
+  writeModule(*M, &State);
+
+  setReturnValue(*M, "f", 10);
+  ++Versions["f"];
+  std::string Bitcode = writeModule(*M, &State);
+  EXPECT_EQ(2U, State.getNumFunctionsReused());
+  EXPECT_EQ(1U, State.getNumFunctionsEncoded());
+  EXPECT_EQ(writeModule(*M), Bitcode);
+  EXPECT_EQ(10, readReturnValue(Context, Bitcode, "f"));
+
+  // Use-list order is not preserved by copied blocks, so it disables reuse.
+  std::string Buffer;
+  raw_string_ostream OS(Buffer);
+  WriteBitcodeToFile(*M, OS, /*ShouldPreserveUseListOrder=*/true, nullptr,
+                     false, nullptr, &State);
+  EXPECT_EQ(0U, State.getNumFunctionsReused());
+}
+
+} // end anonymous namespace
@@ -16,6 +16,7 @@
 #include "llvm/ADT/Triple.h"
 #include "llvm/BinaryFormat/Dwarf.h"
 #include "llvm/CodeGen/AsmPrinter.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/DebugInfo/DWARF/DWARFCompileUnit.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
 #include "llvm/DebugInfo/DWARF/DWARFDie.h"
@@ -33,6 +34,7 @@
 #include "llvm/Testing/Support/Error.h"
 #include "gtest/gtest.h"
 #include <string>
+#include <thread>
 
 using namespace llvm;
 using namespace dwarf;
@@ -2986,4 +2988,70 @@ TEST(DWARFDebugInfo, TestDWARFDieRangeInfoIntersects) {
   AssertRangesDontIntersect(Ranges, {{0x40, 0x41}});
 }
 
+#if LLVM_ENABLE_THREADS
+TEST(DWARFDebugInfo, TestConcurrentUnitExtraction) {
+  Triple Triple = getHostTripleForAddrSize(sizeof(void *));
+  if (!isConfigurationSupported(Triple))
+    return;
+
+  // Several threads extract the same units of one context at once. Each
+  // grabs the unit DIE before the rest of the unit is extracted, so this also
+  // checks that the unit DIE stays usable when the unit is extracted fully.
+  const unsigned NumCUs = 16;
+  auto ExpectedDG = dwarfgen::Generator::create(Triple, 4);
+  ASSERT_THAT_EXPECTED(ExpectedDG, Succeeded());
+  dwarfgen::Generator *DG = ExpectedDG.get().get();
+  for (unsigned I = 0; I < NumCUs; ++I) {
+    dwarfgen::CompileUnit &CU = DG->addCompileUnit();
+    dwarfgen::DIE CUDie = CU.getUnitDIE();
+    CUDie.addAttribute(DW_AT_name, DW_FORM_strp, "cu" + std::to_string(I));
+    dwarfgen::DIE SubprogramDie = CUDie.addChild(DW_TAG_subprogram);
+    SubprogramDie.addAttribute(DW_AT_name, DW_FORM_strp,
+                               "f" + std::to_string(I));
+    SubprogramDie.addAttribute(DW_AT_low_pc, DW_FORM_addr, 0x1000U * (I + 1));
+    SubprogramDie.addAttribute(DW_AT_high_pc, DW_FORM_data4, 0x100U);
+  }
+
+  MemoryBufferRef FileBuffer(DG->generate(), "dwarf");
+  auto Obj = object::ObjectFile::createObjectFile(FileBuffer);
+  ASSERT_TRUE((bool)Obj);
+  std::unique_ptr<DWARFContext> DwarfContext = DWARFContext::create(**Obj);
+
+  std::vector<std::string> Errors[4];
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T < 4; ++T) {
+    Threads.emplace_back([&, T] {
+      auto Fail = [&](const Twine &Msg) { Errors[T].push_back(Msg.str()); };
+      for (unsigned J = 0; J < NumCUs; ++J) {
+        // Visit the units in a different order on each thread.
+        unsigned I = (J + T * 5) % NumCUs;
+        uint64_t Address = 0x1000U * (I + 1) + 0x10;
+        DWARFCompileUnit *U = DwarfContext->getCompileUnitForAddress(Address);
+        if (!U || U != DwarfContext->getCompileUnitAtIndex(I)) {
+          Fail("wrong unit for address");
+          continue;
+        }
+        DWARFDie UnitDie = U->getUnitDIE();
+        DWARFDie Subprogram = U->getSubroutineForAddress(Address);
+        if (!Subprogram ||
+            Subprogram.getName(DINameKind::ShortName) !=
+                StringRef("f" + std::to_string(I)))
+          Fail("wrong subprogram");
+        if (Subprogram.getParent() != U->getUnitDIE(false))
+          Fail("wrong parent");
+        if (UnitDie.getFirstChild() != Subprogram)
+          Fail("wrong first child");
+        if (dwarf::toString(UnitDie.find(DW_AT_name), "") !=
+            "cu" + std::to_string(I))
+          Fail("unit DIE no longer valid");
+      }
+    });
+  }
+  for (std::thread &T : Threads)
+    T.join();
+  for (const auto &ThreadErrors : Errors)
+    EXPECT_TRUE(ThreadErrors.empty()) << ThreadErrors.front();
+}
+#endif
+
 } // end anonymous namespace
@@ -10,8 +10,10 @@
 #include "OrcTestCommon.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/Support/ThreadPool.h"
 #include "gtest/gtest.h"
 
+#include <atomic>
 #include <set>
 #include <thread>
 
@@ -678,4 +680,137 @@ TEST(CoreAPIsTest, TestLookupWithThreadedMaterialization) {
 #endif
 }
 
+TEST(CoreAPIsTest, TestLookupWithThreadPoolMaterialization) {
+#if LLVM_ENABLE_THREADS
+  constexpr unsigned NumSymbols = 16;
+  constexpr unsigned NumLookupThreads = 4;
+
+  ExecutionSession ES(std::make_shared<SymbolStringPool>());
+  ThreadPool Pool(4);
+  ES.setDispatchMaterializationToThreadPool(Pool);
+
+  auto &V = ES.createVSO("V");
+  std::vector<SymbolStringPtr> Names;
+  for (unsigned I = 0; I < NumSymbols; ++I)
+    Names.push_back(ES.getSymbolStringPool().intern("sym" + std::to_string(I)));
+
+  // Every unit but the first looks up the symbol of the previous one while it
+  // materializes, as a linker resolving an external symbol would. With fewer
+  // pool threads than units, the pool threads blocked in these lookups have
+  // to run the units queued behind them.
+  std::atomic<unsigned> NumMaterialized(0);
+  for (unsigned I = 0; I < NumSymbols; ++I) {
+    auto Name = Names[I];
+    SymbolStringPtr Dependency = I ? Names[I - 1] : SymbolStringPtr();
+    cantFail(V.define(llvm::make_unique<SimpleMaterializationUnit>(
+        SymbolFlagsMap({{Name, JITSymbolFlags::Exported}}),
+        [&, I, Name, Dependency](MaterializationResponsibility R) {
+          if (I != 0)
+            cantFail(lookup({&V}, Dependency));
+          ++NumMaterialized;
+          R.resolve({{Name, JITEvaluatedSymbol(0x1000 + I,
+                                               JITSymbolFlags::Exported)}});
+          R.finalize();
+        })));
+  }
+
+  // Look the symbols up from several threads at once.
+  std::vector<std::thread> LookupThreads;
+  std::vector<SymbolMap> Results(NumLookupThreads);
+  for (unsigned T = 0; T < NumLookupThreads; ++T)
+    LookupThreads.emplace_back([&, T]() {
+      SymbolNameSet LookupNames;
+      for (unsigned I = T; I < NumSymbols; I += NumLookupThreads)
+        LookupNames.insert(Names[I]);
+      Results[T] = cantFail(lookup({&V}, std::move(LookupNames)));
+    });
+  for (auto &T : LookupThreads)
+    T.join();
+  Pool.wait();
+
+  EXPECT_EQ(NumMaterialized, NumSymbols)
+      << "Every unit should be materialized exactly once";
+  for (unsigned T = 0; T < NumLookupThreads; ++T)
+    for (unsigned I = T; I < NumSymbols; I += NumLookupThreads)
+      EXPECT_EQ(Results[T][Names[I]].getAddress(), 0x1000U + I)
+          << "lookup returned an incorrect address";
+#endif
+}
+
+TEST(CoreAPIsTest, TestBulkLookupOfReadySymbols) {
+  constexpr unsigned NumSymbols = 4096;
+
+  ExecutionSession ES(std::make_shared<SymbolStringPool>());
+  auto &V1 = ES.createVSO("V1");
+  auto &V2 = ES.createVSO("V2");
+
+  std::vector<std::string> Strings;
+  for (unsigned I = 0; I < NumSymbols; ++I)
+    Strings.push_back("sym" + std::to_string(I));
+  std::vector<SymbolStringPtr> Names;
+  ES.getSymbolStringPool().intern(Strings, std::back_inserter(Names));
+  ASSERT_EQ(Names.size(), NumSymbols);
+
+  // Split the symbols between two VSOs so that the lookup has to carry the
+  // unresolved names from one to the next.
+  SymbolMap Defs1, Defs2;
+  for (unsigned I = 0; I < NumSymbols; ++I)
+    (I % 2 ? Defs2 : Defs1)[Names[I]] =
+        JITEvaluatedSymbol(0x1000 + I, JITSymbolFlags::Exported);
+  cantFail(V1.define(absoluteSymbols(std::move(Defs1))));
+  cantFail(V2.define(absoluteSymbols(std::move(Defs2))));
+
+  // Force the absolute symbols to materialize.
+  cantFail(lookup({&V1, &V2}, SymbolNameSet(Names.begin(), Names.end())));
+
+  auto Result =
+      cantFail(lookup({&V1, &V2}, SymbolNameSet(Names.begin(), Names.end())));
+  EXPECT_EQ(Result.size(), NumSymbols) << "Expected every symbol to resolve";
+  for (unsigned I = 0; I < NumSymbols; ++I)
+    EXPECT_EQ(Result[Names[I]].getAddress(), 0x1000U + I)
+        << "lookup returned an incorrect address";
+
+  // A name that is missing fails the whole lookup, even if the rest are
+  // ready.
+  SymbolNameSet WithMissing({Names[0], ES.getSymbolStringPool().intern("x")});
+  auto Missing = lookup({&V1, &V2}, std::move(WithMissing));
+  EXPECT_FALSE(!!Missing) << "Expected lookup of a missing symbol to fail";
+  consumeError(Missing.takeError());
+}
+
+TEST(CoreAPIsTest, TestLookupReadySymbolIsShadowedByLazyOne) {
+  constexpr JITTargetAddress FakeFooAddr1 = 0xdeadbeef;
+  constexpr JITTargetAddress FakeFooAddr2 = 0xcafef00d;
+  constexpr JITTargetAddress FakeBarAddr = 0xbadf00d;
+
+  ExecutionSession ES(std::make_shared<SymbolStringPool>());
+  auto Foo = ES.getSymbolStringPool().intern("foo");
+  auto Bar = ES.getSymbolStringPool().intern("bar");
+
+  auto &V1 = ES.createVSO("V1");
+  auto &V2 = ES.createVSO("V2");
+
+  // Foo is lazy in V1 and ready in V2. Bar is ready in V2 only.
+  bool FooMaterialized = false;
+  cantFail(V1.define(llvm::make_unique<SimpleMaterializationUnit>(
+      SymbolFlagsMap({{Foo, JITSymbolFlags::Exported}}),
+      [&](MaterializationResponsibility R) {
+        R.resolve({{Foo, JITEvaluatedSymbol(FakeFooAddr1,
+                                            JITSymbolFlags::Exported)}});
+        R.finalize();
+        FooMaterialized = true;
+      })));
+  cantFail(V2.define(absoluteSymbols(
+      {{Foo, JITEvaluatedSymbol(FakeFooAddr2, JITSymbolFlags::Exported)},
+       {Bar, JITEvaluatedSymbol(FakeBarAddr, JITSymbolFlags::Exported)}})));
+  cantFail(lookup({&V2}, {Foo, Bar}));
+
+  auto Result = cantFail(lookup({&V1, &V2}, {Foo, Bar}));
+  EXPECT_TRUE(FooMaterialized) << "Foo in V1 should have been materialized";
+  EXPECT_EQ(Result[Foo].getAddress(), FakeFooAddr1)
+      << "Foo should resolve to the definition in the first VSO";
+  EXPECT_EQ(Result[Bar].getAddress(), FakeBarAddr)
+      << "lookup returned an incorrect address for bar";
+}
+
 } // namespace
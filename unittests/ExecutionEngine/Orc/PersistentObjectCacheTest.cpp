@@ -0,0 +1,109 @@
+//===- PersistentObjectCacheTest.cpp - Unit tests for the object cache ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/PersistentObjectCache.h"
+#include "OrcTestCommon.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+class PersistentObjectCacheTest : public testing::Test,
+                                  public OrcExecutionTest {
+protected:
+  std::unique_ptr<Module> createModule(int32_t RetVal) {
+    ModuleBuilder MB(Context, TM->getTargetTriple().str(), "dummy");
+    MB.getModule()->setDataLayout(TM->createDataLayout());
+    Function *Foo = MB.createFunctionDecl<int32_t(void)>("foo");
+    BasicBlock *Entry = BasicBlock::Create(Context, "entry", Foo);
+    IRBuilder<> Builder(Entry);
+    Builder.CreateRet(
+        ConstantInt::getSigned(IntegerType::get(Context, 32), RetVal));
+    return MB.takeModule();
+  }
+};
+
+TEST_F(PersistentObjectCacheTest, HitAfterCompile) {
+  if (!TM)
+    return;
+
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("orc-object-cache", CacheDir));
+
+  auto M1 = createModule(42);
+  std::unique_ptr<MemoryBuffer> Obj1;
+  {
+    auto Cache = cantFail(PersistentObjectCache::Create(CacheDir, *TM));
+    SimpleCompiler Compile(*TM, Cache.get());
+    Obj1 = Compile(*M1);
+    ASSERT_TRUE(!!Obj1) << "Compilation failed";
+    EXPECT_EQ(Cache->getNumHits(), 0U);
+    EXPECT_EQ(Cache->getNumMisses(), 1U);
+  }
+
+  // A new cache on the same directory, as after a restart, returns the stored
+  // object for an identical module.
+  auto Cache = cantFail(PersistentObjectCache::Create(CacheDir, *TM));
+  SimpleCompiler Compile(*TM, Cache.get());
+  auto Obj2 = Compile(*createModule(42));
+  ASSERT_TRUE(!!Obj2);
+  EXPECT_EQ(Cache->getNumHits(), 1U);
+  EXPECT_EQ(Obj1->getBuffer(), Obj2->getBuffer());
+
+  // A different module misses.
+  EXPECT_NE(Cache->getKey(*M1), Cache->getKey(*createModule(7)));
+  Compile(*createModule(7));
+  EXPECT_EQ(Cache->getNumHits(), 1U);
+  EXPECT_EQ(Cache->getNumMisses(), 1U);
+
+  // So does the same module compiled with different options.
+  TM->Options.FunctionSections = !TM->Options.FunctionSections;
+  auto OtherCache = cantFail(PersistentObjectCache::Create(CacheDir, *TM));
+  EXPECT_NE(Cache->getKey(*M1), OtherCache->getKey(*M1));
+  EXPECT_EQ(OtherCache->getObject(M1.get()), nullptr);
+
+  sys::fs::remove_directories(CacheDir);
+}
+
+TEST_F(PersistentObjectCacheTest, HitDropsPendingKey) {
+  if (!TM)
+    return;
+
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("orc-object-cache", CacheDir));
+
+  auto Cache = cantFail(PersistentObjectCache::Create(CacheDir, *TM));
+  SimpleCompiler Compile(*TM, Cache.get());
+  auto Obj = Compile(*createModule(42));
+  ASSERT_TRUE(!!Obj) << "Compilation failed";
+
+  // M misses and is never compiled, then changes into a module that hits.
+  auto M = createModule(7);
+  EXPECT_EQ(Cache->getObject(M.get()), nullptr);
+  auto &Ret = M->getFunction("foo")->getEntryBlock().back();
+  Ret.setOperand(0, ConstantInt::getSigned(IntegerType::get(Context, 32), 42));
+  EXPECT_NE(Cache->getObject(M.get()), nullptr);
+
+  // The key computed for the first miss must not be used to store an object
+  // for M now.
+  Ret.setOperand(0, ConstantInt::getSigned(IntegerType::get(Context, 32), 9));
+  Cache->notifyObjectCompiled(M.get(), Obj->getMemBufferRef());
+  EXPECT_EQ(Cache->getObject(createModule(7).get()), nullptr);
+  EXPECT_NE(Cache->getObject(createModule(9).get()), nullptr);
+
+  sys::fs::remove_directories(CacheDir);
+}
+
+} // end anonymous namespace
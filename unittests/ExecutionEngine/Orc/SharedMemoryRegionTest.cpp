@@ -0,0 +1,51 @@
+//===- SharedMemoryRegionTest.cpp - Unit tests for shared memory regions --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/SharedMemoryRegion.h"
+#include "llvm/Support/Process.h"
+#include "gtest/gtest.h"
+#include <cstring>
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+TEST(SharedMemoryRegionTest, WritesAreVisibleThroughBothMappings) {
+  if (!SharedMemoryRegion::isSupported())
+    return;
+
+  auto Created = SharedMemoryRegion::create(100);
+  ASSERT_TRUE(!!Created) << toString(Created.takeError());
+  EXPECT_EQ(Created->size() % sys::Process::getPageSize(), 0U);
+  EXPECT_GE(Created->size(), 100U);
+
+  auto Opened = SharedMemoryRegion::open(Created->getName(), Created->size());
+  ASSERT_TRUE(!!Opened) << toString(Opened.takeError());
+  EXPECT_NE(Created->base(), Opened->base());
+
+  // The mappings stay valid once the name is gone.
+  std::string Name = Created->getName();
+  EXPECT_FALSE(errorToBool(Opened->unlink()));
+  auto Reopened = SharedMemoryRegion::open(Name, Created->size());
+  EXPECT_FALSE(!!Reopened) << "Region still reachable by name after unlink";
+  if (!Reopened)
+    consumeError(Reopened.takeError());
+
+  std::strcpy(static_cast<char *>(Opened->base()), "hello");
+  EXPECT_STREQ(static_cast<char *>(Created->base()), "hello");
+
+  // Making one mapping read-only and executable leaves the other writable.
+  EXPECT_FALSE(sys::Memory::protectMappedMemory(
+      Created->getMemoryBlock(), sys::Memory::MF_READ | sys::Memory::MF_EXEC));
+  std::strcpy(static_cast<char *>(Opened->base()), "world");
+  EXPECT_STREQ(static_cast<char *>(Created->base()), "world");
+}
+
+} // end anonymous namespace
@@ -0,0 +1,221 @@
+//===- PooledSectionMemoryManagerTest.cpp - Pooled memory manager tests ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/PooledSectionMemoryManager.h"
+#include "llvm/Config/llvm-config.h"
+#include "gtest/gtest.h"
+
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+class CountingMemoryMapper final : public SectionMemoryManager::MemoryMapper {
+public:
+  sys::MemoryBlock
+  allocateMappedMemory(SectionMemoryManager::AllocationPurpose Purpose,
+                       size_t NumBytes, const sys::MemoryBlock *const NearBlock,
+                       unsigned Flags, std::error_code &EC) override {
+    ++NumMaps;
+    return sys::Memory::allocateMappedMemory(NumBytes, NearBlock, Flags, EC);
+  }
+
+  std::error_code protectMappedMemory(const sys::MemoryBlock &Block,
+                                      unsigned Flags) override {
+    ++NumProtects;
+    return sys::Memory::protectMappedMemory(Block, Flags);
+  }
+
+  std::error_code releaseMappedMemory(sys::MemoryBlock &M) override {
+    ++NumReleases;
+    return sys::Memory::releaseMappedMemory(M);
+  }
+
+  unsigned NumMaps = 0;
+  unsigned NumProtects = 0;
+  unsigned NumReleases = 0;
+};
+
+TEST(PooledSectionMemoryManagerTest, PacksSectionsAndBatchesProtection) {
+  CountingMemoryMapper MM;
+  auto Pool = std::make_shared<JITMemoryPool>(&MM);
+  PooledSectionMemoryManager MemMgr(Pool);
+
+  // Sections of two small "objects" share one page per purpose.
+  uint8_t *Code1 = MemMgr.allocateCodeSection(100, 0, 1, "");
+  uint8_t *Data1 = MemMgr.allocateDataSection(100, 0, 2, "", true);
+  uint8_t *Code2 = MemMgr.allocateCodeSection(100, 32, 3, "");
+  uint8_t *Data2 = MemMgr.allocateDataSection(100, 0, 4, "", true);
+  uint8_t *RW = MemMgr.allocateDataSection(100, 0, 5, "", false);
+  ASSERT_NE(nullptr, Code1);
+  ASSERT_NE(nullptr, Code2);
+  ASSERT_NE(nullptr, Data1);
+  ASSERT_NE(nullptr, Data2);
+  ASSERT_NE(nullptr, RW);
+
+  size_t PageSize = Pool->getPageSize();
+  auto PageOf = [&](uint8_t *P) {
+    return reinterpret_cast<uintptr_t>(P) / PageSize;
+  };
+  EXPECT_EQ(PageOf(Code1), PageOf(Code2));
+  EXPECT_EQ(PageOf(Data1), PageOf(Data2));
+  EXPECT_NE(PageOf(Code1), PageOf(Data1));
+  EXPECT_NE(PageOf(Code1), PageOf(RW));
+  EXPECT_EQ(0U, reinterpret_cast<uintptr_t>(Code2) % 32);
+
+  for (unsigned I = 0; I < 100; ++I) {
+    Code1[I] = 1;
+    Code2[I] = 2;
+    Data1[I] = 3;
+    Data2[I] = 4;
+  }
+  for (unsigned I = 0; I < 100; ++I) {
+    EXPECT_EQ(1, Code1[I]);
+    EXPECT_EQ(2, Code2[I]);
+    EXPECT_EQ(3, Data1[I]);
+    EXPECT_EQ(4, Data2[I]);
+  }
+
+  // One protection call for the code page and one for the read-only data
+  // page, not one per section.
+  std::string Error;
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+  EXPECT_EQ(2U, MM.NumProtects);
+
+  // Finalized pages are not written to again.
+  uint8_t *Code3 = MemMgr.allocateCodeSection(100, 0, 6, "");
+  ASSERT_NE(nullptr, Code3);
+  EXPECT_NE(PageOf(Code1), PageOf(Code3));
+  Code3[0] = 5;
+
+  // Read-write data keeps packing across finalizations.
+  uint8_t *RW2 = MemMgr.allocateDataSection(100, 0, 7, "", false);
+  EXPECT_EQ(PageOf(RW), PageOf(RW2));
+}
+
+TEST(PooledSectionMemoryManagerTest, RecyclesMemoryOfDestroyedManagers) {
+  CountingMemoryMapper MM;
+  auto Pool = std::make_shared<JITMemoryPool>(&MM, 64 * 1024);
+
+  uint8_t *FirstCode;
+  {
+    PooledSectionMemoryManager MemMgr(Pool);
+    FirstCode = MemMgr.allocateCodeSection(256, 0, 1, "");
+    ASSERT_NE(nullptr, FirstCode);
+    EXPECT_FALSE(MemMgr.finalizeMemory());
+    EXPECT_NE(0U, Pool->getStatistics().BytesInUse);
+  }
+  EXPECT_EQ(0U, Pool->getStatistics().BytesInUse);
+
+  // The pages of the destroyed manager are reused, and are writable again.
+  PooledSectionMemoryManager MemMgr(Pool);
+  uint8_t *Code = MemMgr.allocateCodeSection(256, 0, 1, "");
+  ASSERT_EQ(FirstCode, Code);
+  for (unsigned I = 0; I < 256; ++I)
+    Code[I] = 0xc3;
+  EXPECT_FALSE(MemMgr.finalizeMemory());
+  EXPECT_EQ(1U, MM.NumMaps);
+
+  JITMemoryPool::Statistics Stats = Pool->getStatistics();
+  EXPECT_EQ(1U, Stats.NumSlabs);
+  EXPECT_EQ(Stats.NumMapCalls, MM.NumMaps);
+  EXPECT_EQ(Stats.NumProtectCalls, MM.NumProtects);
+  EXPECT_NE(0U, Stats.BytesReleased);
+}
+
+TEST(PooledSectionMemoryManagerTest, LargeAllocations) {
+  auto Pool = std::make_shared<JITMemoryPool>(nullptr, 64 * 1024);
+  PooledSectionMemoryManager MemMgr(Pool);
+
+  // Allocations larger than a slab get a slab of their own.
+  uint8_t *Code = MemMgr.allocateCodeSection(0x100000, 0, 1, "");
+  uint8_t *Data = MemMgr.allocateDataSection(0x100000, 0, 2, "", false);
+  ASSERT_NE(nullptr, Code);
+  ASSERT_NE(nullptr, Data);
+  for (unsigned I = 0; I < 0x100000; ++I) {
+    Code[I] = 1;
+    Data[I] = 2;
+  }
+  for (unsigned I = 0; I < 0x100000; ++I) {
+    EXPECT_EQ(1, Code[I]);
+    EXPECT_EQ(2, Data[I]);
+  }
+  EXPECT_FALSE(MemMgr.finalizeMemory());
+  EXPECT_EQ(2U, Pool->getStatistics().NumSlabs);
+}
+
+TEST(PooledSectionMemoryManagerTest, StressManyManagers) {
+  constexpr unsigned NumManagers = 512;
+  CountingMemoryMapper MM;
+  auto Pool = std::make_shared<JITMemoryPool>(&MM);
+
+  // Load and remove many small objects, keeping a window of them alive.
+  std::vector<std::unique_ptr<PooledSectionMemoryManager>> Live;
+  for (unsigned I = 0; I < NumManagers; ++I) {
+    auto MemMgr = llvm::make_unique<PooledSectionMemoryManager>(Pool);
+    uint8_t *Code = MemMgr->allocateCodeSection(64 + I % 512, 16, 1, "");
+    uint8_t *Data = MemMgr->allocateDataSection(32 + I % 128, 8, 2, "", true);
+    ASSERT_NE(nullptr, Code);
+    ASSERT_NE(nullptr, Data);
+    Code[0] = 0xc3;
+    Data[0] = 1;
+    ASSERT_FALSE(MemMgr->finalizeMemory());
+    Live.push_back(std::move(MemMgr));
+    if (Live.size() > 16)
+      Live.erase(Live.begin());
+  }
+  Live.clear();
+
+  JITMemoryPool::Statistics Stats = Pool->getStatistics();
+  EXPECT_EQ(0U, Stats.BytesInUse);
+  EXPECT_LE(Stats.PeakBytesInUse, 17 * 2 * Pool->getPageSize());
+  // One slab for code and one for read-only data serve every manager.
+  EXPECT_EQ(2U, MM.NumMaps);
+
+  Pool->releaseFreeSlabs();
+  EXPECT_EQ(0U, Pool->getStatistics().NumSlabs);
+  EXPECT_EQ(2U, MM.NumReleases);
+}
+
+TEST(PooledSectionMemoryManagerTest, ConcurrentManagers) {
+#if LLVM_ENABLE_THREADS
+  constexpr unsigned NumThreads = 4;
+  constexpr unsigned NumManagersPerThread = 128;
+  auto Pool = std::make_shared<JITMemoryPool>();
+
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T < NumThreads; ++T)
+    Threads.emplace_back([&, T]() {
+      for (unsigned I = 0; I < NumManagersPerThread; ++I) {
+        PooledSectionMemoryManager MemMgr(Pool);
+        uint8_t *Code = MemMgr.allocateCodeSection(128, 0, 1, "");
+        uint8_t *Data = MemMgr.allocateDataSection(128, 0, 2, "", false);
+        if (!Code || !Data)
+          return;
+        for (unsigned J = 0; J < 128; ++J) {
+          Code[J] = T;
+          Data[J] = T + 1;
+        }
+        for (unsigned J = 0; J < 128; ++J) {
+          EXPECT_EQ(T, Code[J]);
+          EXPECT_EQ(T + 1, Data[J]);
+        }
+        EXPECT_FALSE(MemMgr.finalizeMemory());
+      }
+    });
+  for (auto &T : Threads)
+    T.join();
+
+  EXPECT_EQ(0U, Pool->getStatistics().BytesInUse);
+#endif
+}
+
+} // end anonymous namespace
@@ -0,0 +1,165 @@
+//===- llvm/unittest/IR/IRArenaTest.cpp - IRArena unit tests --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/IRArena.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+const char *ModuleString =
+    "declare void @g(i32)\n"
+    "define i32 @f(i32 %a, i32 %n) {\n"
+    "entry:\n"
+    "  switch i32 %a, label %exit [ i32 0, label %loop\n"
+    "                               i32 1, label %loop ]\n"
+    "loop:\n"
+    "  %i = phi i32 [ 0, %entry ], [ 0, %entry ], [ %i.next, %loop ]\n"
+    "  %i.next = add i32 %i, 1\n"
+    "  call void @g(i32 %i) [ \"deopt\"(i32 %a) ]\n"
+    "  %c = icmp slt i32 %i.next, %n\n"
+    "  br i1 %c, label %loop, label %exit\n"
+    "exit:\n"
+    "  %r = phi i32 [ %a, %entry ], [ %i.next, %loop ]\n"
+    "  ret i32 %r\n"
+    "}\n";
+
+std::unique_ptr<Module> parseModule(LLVMContext &Context) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(ModuleString, Err, Context);
+  if (!M)
+    Err.print("IRArenaTest", errs());
+  return M;
+}
+
+std::string printModule(const Module &M) {
+  std::string Str;
+  raw_string_ostream OS(Str);
+  M.print(OS, nullptr);
+  return OS.str();
+}
+
+TEST(IRArenaTest, ParseAndModify) {
+  LLVMContext Context;
+  std::unique_ptr<Module> Expected = parseModule(Context);
+  ASSERT_TRUE(Expected);
+
+  IRArena Arena;
+  std::unique_ptr<Module> M;
+  {
+    IRArena::Scope S(Arena);
+    EXPECT_EQ(&Arena, IRArena::getActive());
+    M = parseModule(Context);
+    ASSERT_TRUE(M);
+  }
+  EXPECT_EQ(nullptr, IRArena::getActive());
+
+  // Every block and instruction is allocated from the arena.
+  Function *F = M->getFunction("f");
+  size_t NumAllocations = F->size() + F->getInstructionCount();
+  EXPECT_EQ(NumAllocations, Arena.getNumAllocations());
+  EXPECT_LE(Arena.getBytesAllocated(), Arena.getTotalMemory());
+  EXPECT_EQ(printModule(*Expected), printModule(*M));
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+
+  // Arena and heap allocated instructions can be mixed, and deleting arena
+  // instructions unlinks them from their operands' use lists.
+  Instruction *Add = nullptr;
+  for (Instruction &I : instructions(*F))
+    if (I.getOpcode() == Instruction::Add)
+      Add = &I;
+  ASSERT_NE(nullptr, Add);
+  Value *I = Add->getOperand(0);
+  unsigned NumUses = I->getNumUses();
+  auto *Sub = BinaryOperator::CreateSub(I, ConstantInt::get(I->getType(), -1),
+                                        "i.next", Add);
+  WeakVH WeakAdd(Add);
+  Add->replaceAllUsesWith(Sub);
+  Add->eraseFromParent();
+  EXPECT_EQ(nullptr, static_cast<Value *>(WeakAdd));
+  EXPECT_EQ(NumUses, I->getNumUses());
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+  EXPECT_EQ(NumAllocations, Arena.getNumAllocations());
+
+  M.reset();
+  Expected.reset();
+}
+
+TEST(IRArenaTest, ModuleOwnsArena) {
+  LLVMContext Context;
+  auto Arena = llvm::make_unique<IRArena>();
+  IRArena *A = Arena.get();
+  std::unique_ptr<Module> M;
+  {
+    IRArena::Scope S(*A);
+    M = llvm::make_unique<Module>("M", Context);
+    FunctionType *FTy = FunctionType::get(Type::getInt32Ty(Context), false);
+    Function *F = Function::Create(FTy, Function::ExternalLinkage, "f", M.get());
+    BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+    BasicBlock *Exit = BasicBlock::Create(Context, "exit", F);
+    IRBuilder<> B(Entry);
+    B.CreateBr(Exit);
+    B.SetInsertPoint(Exit);
+    PHINode *PN = B.CreatePHI(B.getInt32Ty(), 1);
+    PN->addIncoming(B.getInt32(1), Entry);
+    B.CreateRet(PN);
+  }
+  M->setIRArena(std::move(Arena));
+  EXPECT_EQ(A, M->getIRArena());
+  EXPECT_EQ(5U, A->getNumAllocations());
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+
+  // Constants belong to the context and are not taken from the arena.
+  {
+    IRArena::Scope S(*A);
+    ConstantInt::get(Type::getInt32Ty(Context), 12345);
+  }
+  EXPECT_EQ(5U, A->getNumAllocations());
+  M.reset();
+}
+
+TEST(IRArenaTest, NestedScopes) {
+  LLVMContext Context;
+  IRArena Outer, Inner;
+  Value *Zero = ConstantInt::get(Type::getInt32Ty(Context), 0);
+  Instruction *I1, *I2, *I3;
+  {
+    IRArena::Scope S1(Outer);
+    I1 = BinaryOperator::CreateAdd(Zero, Zero);
+    {
+      IRArena::Scope S2(Inner);
+      EXPECT_EQ(&Inner, IRArena::getActive());
+      I2 = BinaryOperator::CreateAdd(Zero, Zero);
+    }
+    EXPECT_EQ(&Outer, IRArena::getActive());
+    I3 = BinaryOperator::CreateAdd(Zero, Zero);
+  }
+  EXPECT_EQ(2U, Outer.getNumAllocations());
+  EXPECT_EQ(1U, Inner.getNumAllocations());
+  EXPECT_EQ(6U, Zero->getNumUses());
+
+  I1->deleteValue();
+  I2->deleteValue();
+  I3->deleteValue();
+  EXPECT_EQ(0U, Zero->getNumUses());
+}
+
+} // end anonymous namespace
@@ -15,7 +15,9 @@
 #include "llvm/Support/Parallel.h"
 #include "gtest/gtest.h"
 #include <array>
+#include <atomic>
 #include <random>
+#include <thread>
 
 uint32_t array[1024 * 1024];
 
@@ -50,4 +52,31 @@ TEST(Parallel, parallel_for) {
   ASSERT_EQ(range[2049], 1u);
 }
 
+TEST(Parallel, nested) {
+  // Every outer task waits for an inner parallel loop. The workers waiting on
+  // the inner groups have to run pending tasks instead of blocking, or this
+  // would deadlock once all of them are waiting.
+  std::atomic<unsigned> Count{0};
+  for_each_n(parallel::par, 0, 64, [&](size_t) {
+    for_each_n(parallel::par, 0, 64, [&](size_t) { ++Count; });
+  });
+  ASSERT_EQ(64u * 64u, Count);
+}
+
+TEST(Parallel, thread_count) {
+  std::atomic<unsigned> Running{0};
+  std::atomic<unsigned> MaxRunning{0};
+  for_each_n(parallel::par.withThreads(2), 0, 2048, [&](size_t) {
+    unsigned R = ++Running;
+    unsigned M = MaxRunning;
+    while (R > M && !MaxRunning.compare_exchange_weak(M, R))
+      ;
+    std::this_thread::yield();
+    --Running;
+  });
+  // The calling thread runs the last chunk itself, next to at most two tasks
+  // of the group.
+  ASSERT_LE(MaxRunning, 3u);
+}
+
 #endif
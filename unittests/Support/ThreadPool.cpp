@@ -164,3 +164,25 @@ TEST_F(ThreadPoolTest, PoolDestruction) {
   }
   ASSERT_EQ(5, checked_in);
 }
+
+TEST_F(ThreadPoolTest, SharedExecutor) {
+  CHECK_UNSUPPORTED();
+  std::atomic_int checked_in{0};
+  {
+    ThreadPool Pool(2, ThreadPool::ExecutionMode::SharedExecutor);
+    for (size_t i = 0; i < 5; ++i) {
+      Pool.async([this, &checked_in] {
+        waitForMainThread();
+        ++checked_in;
+      });
+    }
+    ASSERT_EQ(0, checked_in);
+    setMainThreadReady();
+    Pool.wait();
+    ASSERT_EQ(5, checked_in);
+
+    // The pool can be reused after wait(), and is waited for on destruction.
+    Pool.async([&checked_in] { ++checked_in; });
+  }
+  ASSERT_EQ(6, checked_in);
+}
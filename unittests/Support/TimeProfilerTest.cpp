@@ -0,0 +1,71 @@
+//===- unittests/TimeProfilerTest.cpp - Time trace profiler tests ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(TimeProfiler, Disabled) {
+  ASSERT_FALSE(timeTraceProfilerEnabled());
+  bool DetailComputed = false;
+  {
+    TimeTraceScope Scope("Pass", [&]() {
+      DetailComputed = true;
+      return std::string("foo");
+    });
+  }
+  // The detail callback must not run when the profiler is off.
+  EXPECT_FALSE(DetailComputed);
+}
+
+TEST(TimeProfiler, Write) {
+  timeTraceProfilerInitialize(/*TimeTraceGranularity=*/0, "test");
+  ASSERT_TRUE(timeTraceProfilerEnabled());
+  {
+    TimeTraceScope Outer("Outer Pass", "module.ll");
+    TimeTraceScope Inner("Inner \"Pass\"", [] { return std::string("f\n"); });
+  }
+
+  std::string Trace;
+  raw_string_ostream OS(Trace);
+  timeTraceProfilerWrite(OS);
+  timeTraceProfilerCleanup();
+  OS.flush();
+
+  EXPECT_FALSE(timeTraceProfilerEnabled());
+  EXPECT_EQ(0u, Trace.find("{\"traceEvents\":["));
+  EXPECT_NE(std::string::npos, Trace.find("\"name\":\"Outer Pass\""));
+  EXPECT_NE(std::string::npos,
+            Trace.find("\"args\":{\"detail\":\"module.ll\"}"));
+  EXPECT_NE(std::string::npos, Trace.find("\"name\":\"Inner \\\"Pass\\\"\""));
+  EXPECT_NE(std::string::npos, Trace.find("\"args\":{\"detail\":\"f\\n\"}"));
+  EXPECT_NE(std::string::npos, Trace.find("\"name\":\"Total Outer Pass\""));
+  EXPECT_NE(std::string::npos, Trace.find("\"args\":{\"name\":\"test\"}"));
+}
+
+TEST(TimeProfiler, Granularity) {
+  // A granularity that no scope will reach keeps only the totals.
+  timeTraceProfilerInitialize(/*TimeTraceGranularity=*/~0u, "test");
+  { TimeTraceScope Scope("Short", "x"); }
+
+  std::string Trace;
+  raw_string_ostream OS(Trace);
+  timeTraceProfilerWrite(OS);
+  timeTraceProfilerCleanup();
+  OS.flush();
+
+  EXPECT_EQ(std::string::npos, Trace.find("\"name\":\"Short\""));
+  EXPECT_NE(std::string::npos, Trace.find("\"name\":\"Total Short\""));
+}
+
+} // end anonymous namespace